@@ -0,0 +1,71 @@
+// ActiveSetSolver.hxx
+// Mac Radigan
+//
+// Description:  This class is a primal active-set solver for the
+//               bound-constrained Markowitz problem,
+//
+//                 minimize:    w'*S*w
+//                 subject to:  w'*mu = mu_opt
+//                              w'*1v = 1
+//                              lower <= w <= upper
+//
+//               which covers long-only (lower=0) portfolios and 
+//               per-name position limits.
+//
+//               The working set of active bounds is kept between
+//               solves.  When the target return or the data window
+//               changes only slightly, the next solve starts from 
+//               the previous working set and typically converges 
+//               in a few iterations (warm start).
+//
+// See Also:     J. Nocedal and S. J. Wright, Numerical Optimization,
+//               Springer, 2006 (section 16.5, active-set methods)
+//
+
+#include "quant.hxx"
+#include <armadillo>
+#include <vector>
+
+#ifndef ACTIVESETSOLVER_HXX
+#define ACTIVESETSOLVER_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+class ActiveSetSolver 
+{
+  private:
+    enum { FREE=0, AT_LOWER=1, AT_UPPER=2 };
+    static const int    MAX_ITERATIONS;
+    static const double TOLERANCE;
+    // bound used in place of an infinite bound to find a feasible point
+    static const double PHASE1_BOUND;
+    mat s;                          // (N x N) covariance
+    vec mu;                         // (N x 1) mean returns
+    vec lower;                      // (N x 1) lower bounds (may be -inf)
+    vec upper;                      // (N x 1) upper bounds (may be +inf)
+    vec x;                          // last solution
+    std::vector<int> state;         // working set (FREE, AT_LOWER, AT_UPPER)
+    bool warm;                      // the working set is from a previous solve
+    int iterations;                 // iterations of the last solve
+    bool feasible(double target, vec& x0) const;
+    bool solveEqp(double target, vec& xw) const;
+    bool step(const vec& xk, vec& p, vec& nu) const;
+  protected:
+  public:
+    ActiveSetSolver(); 
+    ~ActiveSetSolver(); 
+    // set the problem data;  the working set of the previous solve
+    // is kept (as a warm start) if the dimension is unchanged
+    void setProblem(const mat& s, const mat& mu, const vec& lower, const vec& upper); 
+    // minimum-variance weights (N x 1) for a daily target return;
+    // throws if the target is not attainable within the bounds
+    vec solve(double target); 
+    inline void reset() { warm=false; }
+    inline int getIterations() const { return iterations; }
+};
+
+NS_QUANT_END
+
+#endif
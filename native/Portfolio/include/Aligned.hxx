@@ -0,0 +1,65 @@
+// Aligned.hxx
+// Mac Radigan
+//
+// Description:  This is a standard allocator for cache-aligned
+//               columns.  Every allocation starts on a cache line
+//               and is padded to a whole number of cache lines, so
+//               vector kernels may use aligned loads at the start of
+//               a column, and two columns never share a cache line.
+//
+
+#include "quant.hxx"
+#include <vector>
+#include <new>
+#include <utility>
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifndef ALIGNED_HXX
+#define ALIGNED_HXX
+
+NS_QUANT_BEGIN
+
+const size_t CACHE_LINE = 64;  // bytes
+
+template<typename T, size_t Alignment=CACHE_LINE>
+class AlignedAllocator
+{
+  public:
+    typedef T              value_type;
+    typedef T*             pointer;
+    typedef const T*       const_pointer;
+    typedef T&             reference;
+    typedef const T&       const_reference;
+    typedef size_t         size_type;
+    typedef ptrdiff_t      difference_type;
+    template<typename U> struct rebind { typedef AlignedAllocator<U,Alignment> other; };
+    AlignedAllocator() {}
+    template<typename U> AlignedAllocator(const AlignedAllocator<U,Alignment>&) {}
+    inline T* allocate(size_t n, const void* hint=0)
+    {
+      // pad to a whole number of cache lines
+      size_t bytes = (n*sizeof(T)+Alignment-1) & ~(Alignment-1);
+      void* p = NULL;
+      if(0==n) return NULL;
+      if(0!=posix_memalign(&p, Alignment, bytes)) throw std::bad_alloc();
+      return static_cast<T*>(p);
+    }
+    inline void deallocate(T* p, size_t n) { free(p); }
+    inline size_t max_size() const { return size_t(-1)/sizeof(T); }
+    template<typename U, typename... Args>
+    inline void construct(U* p, Args&&... args)
+    {
+      ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+    template<typename U> inline void destroy(U* p) { p->~U(); }
+};
+
+template<typename T, typename U, size_t A>
+inline bool operator==(const AlignedAllocator<T,A>&, const AlignedAllocator<U,A>&) { return true; }
+template<typename T, typename U, size_t A>
+inline bool operator!=(const AlignedAllocator<T,A>&, const AlignedAllocator<U,A>&) { return false; }
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,85 @@
+// Alignment.hxx
+// Mac Radigan
+//
+// Description:  This class aligns the daily returns of several
+//               series on their dates, with a k-way merge of the
+//               (newest first) date columns, into a panel with one
+//               row per date and one column per series.
+//
+//               Dates missing from some series are handled by the
+//               missing data policy:
+//
+//                 drop      keep only dates common to every series
+//                 ffill     keep every date, a series without a quote
+//                           on a date is carried forward (zero return),
+//                           back to the first date every series quotes
+//                 pairwise  keep every date, missing returns are NaN
+//                           (statistics use pairwise complete rows)
+//
+//               The merge is on the quote dates, and the returns of a
+//               row are computed from the closes on its date and on 
+//               the next older kept date, so every column of a row 
+//               spans the same period:  under drop, the return over a
+//               dropped date is compounded into the next kept date;
+//               under pairwise, a series not quoted on both dates is
+//               missing from the row.
+//
+//               The merge is a single pass over the newest rows of
+//               each series, and reuses its workspace between calls.
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include <armadillo>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#ifndef ALIGNMENT_HXX
+#define ALIGNMENT_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+enum MissingData { MISSING_DROP, MISSING_FFILL, MISSING_PAIRWISE };
+
+class Alignment
+{
+  private:
+    struct Cursor
+    {
+      time_t date;                  // date of the next quote
+      int    series;                // series index (panel column)
+      size_t pos;                   // index of the next quote
+    };
+    static bool later(const Cursor& a, const Cursor& b) { return a.date<b.date; }
+    std::vector<Cursor> heap;       // cursors, newest date on top
+    std::vector<char>   present;    // series quoted on the current date
+    std::vector<char>   quoted;     // series quoted on the open row's date
+    std::vector<size_t> ahead;      // quote of each series on or before
+                                    //   the current date (max: none)
+    std::vector<size_t> previous;   // quote of each series on or before 
+                                    //   the open row's date
+    mat panel;                      // rows as merged, before trimming
+    size_t missing;                 // NaN entries of the last panel
+    // copy constructor is not implemented, restrict use as private
+    Alignment(const Alignment& alignment);
+    Alignment& operator=(const Alignment& alignment);
+  protected:
+  public:
+    Alignment();
+    ~Alignment();
+    // x is the (M x N) panel of the newest (at most nrows, or all if
+    // nrows<=0) aligned dates, newest first, with dates[M] its dates
+    void align(const std::vector<const Series*>& series, MissingData policy,
+               int nrows, mat& x, std::vector<time_t>& dates);
+    // number of missing (NaN) returns of the last panel (pairwise only)
+    inline size_t getMissing() const { return missing; }
+    static MissingData parsePolicy(const std::string& name);
+    static const char* getPolicyName(MissingData policy);
+};
+
+NS_QUANT_END
+
+#endif
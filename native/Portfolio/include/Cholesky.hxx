@@ -0,0 +1,50 @@
+// Cholesky.hxx
+// Mac Radigan
+//
+// Description:  This class is the Cholesky factorization of a
+//               symmetric positive (semi)definite matrix, such
+//               as a covariance matrix,
+//
+//                 S + ridge*I = R'*R,   R upper triangular
+//
+//               If S is singular (or numerically indefinite) a 
+//               small ridge is added to the diagonal until the 
+//               factorization succeeds;  the ridge applied is 
+//               reported so callers can detect the fallback.
+//
+
+#include "quant.hxx"
+#include <armadillo>
+
+#ifndef CHOLESKY_HXX
+#define CHOLESKY_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+class Cholesky 
+{
+  private:
+    // first ridge tried, relative to the mean diagonal of S
+    static const double RIDGE_START;
+    // largest ridge tried, relative to the mean diagonal of S
+    static const double RIDGE_LIMIT;
+    mat r;                          // upper triangular factor
+    double ridge;                   // diagonal regularization applied
+  protected:
+  public:
+    Cholesky(); 
+    Cholesky(const mat& s); 
+    ~Cholesky(); 
+    void factor(const mat& s); 
+    mat solve(const mat& v) const;      // S^-1*v
+    void solve(const mat& v, mat& x) const;  // x = S^-1*v, in place
+    inline const mat& getFactor() const { return r; }
+    inline double getRidge() const { return ridge; }
+    inline bool isRegularized() const { return ridge>0; }
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,57 @@
+// FactorModel.hxx
+// Mac Radigan
+//
+// Description:  This class is a statistical factor model of the
+//               covariance of stock returns,
+//
+//                 S = B*B' + D
+//
+//               with B an (N x K) matrix of factor loadings and
+//               D a diagonal matrix of specific (idiosyncratic)
+//               variances.  Loadings are the K principal
+//               components of the returns matrix.
+//
+//               The N x N covariance is never formed:  products
+//               and solves go through the low-rank-plus-diagonal
+//               structure (Woodbury identity) in O(N*K) memory.
+//
+// See Also:     http://wikipedia.org/wiki/Woodbury_matrix_identity
+//
+
+#include "quant.hxx"
+#include <armadillo>
+
+#ifndef FACTORMODEL_HXX
+#define FACTORMODEL_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+class FactorModel 
+{
+  private:
+    // floor on specific variance, relative to total variance
+    static const double SPECIFIC_FLOOR;
+    mat loadings;                   // B (N x K) factor loadings
+    vec specific;                   // diag(D) (N x 1) specific variances
+    mat scaled;                     // D^-1*B (N x K)
+    mat capacitance;                // I + B'*D^-1*B (K x K)
+  protected:
+  public:
+    FactorModel(); 
+    ~FactorModel(); 
+    // estimate a K-factor model from an M x N matrix of returns
+    void estimate(const mat& x, int nfactors); 
+    mat multiply(const mat& v) const;   // S*v  for an N x m matrix v
+    mat solve(const mat& v) const;      // S^-1*v  for an N x m matrix v
+    mat getVariance() const;            // (1 x N) diag(S)
+    mat getCovariance() const;          // (N x N) dense S (small N only)
+    inline int getFactors() const { return loadings.n_cols; }
+    inline const mat& getLoadings() const { return loadings; }
+    inline const vec& getSpecific() const { return specific; }
+};
+
+NS_QUANT_END
+
+#endif
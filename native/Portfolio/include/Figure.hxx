@@ -61,12 +61,27 @@ class Figure
     inline void setName(std::string name) { this->name=name; }
     inline void setFormat(std::string format) { this->name=name; }
     void save(std::string fieldname);
-    void plotCandle(Series& series, const int nsamples);
+    void saveScript(std::string filename) const;   // stand-alone .gnuplot script
+    void saveScript(std::ostream& os) const;
+    // complete gnuplot commands rendering the figure to filename (with 
+    // the terminal of its extension), or to the current terminal if empty
+    std::string getCommands(const std::string& filename) const;
+    static std::string getTerminal(const std::string& filename);
+    // annotate the script (e.g. with inputs that are not plotted)
+    inline void comment(const std::string& text) { script << "# " << text << std::endl; }
+    void plotCandle(const Series& series, const int nsamples);
     void plotPortfolio(std::vector<std::string>& symbols, 
                        std::vector<double>& roi, 
                        std::vector<double>& std,
                        double roi_opt,
                        double std_opt);
+    void plotPortfolio(std::vector<std::string>& symbols, 
+                       std::vector<double>& roi, 
+                       std::vector<double>& std,
+                       double roi_opt,
+                       double std_opt,
+                       const std::vector<double>& frontier_roi,
+                       const std::vector<double>& frontier_std);
     inline void setTerminal(const char* const p) { terminal=p; }
     inline void setOutput(const char* const p) { output=p; }
     inline void setYlabel(const char* const p) { ylabel=p; }
@@ -74,9 +89,8 @@ class Figure
     inline void setTitle(const char* const p) { title=p; }
     inline void setPause(double t) { pause=t; }
     void reset();
-    inline std::string& toString() const {
-      std::string *pstr = new std::string(script.str());
-      return *pstr;
+    inline std::string toString() const {
+      return script.str();
     }
 };
 
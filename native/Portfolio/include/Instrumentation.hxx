@@ -0,0 +1,144 @@
+// Instrumentation.hxx
+// Mac Radigan
+//
+// Description:  This class is a process-wide registry of named
+//               timers and counters, for per-stage instrumentation
+//               of a run (parsing, loading, alignment, estimation,
+//               solves, report rendering).
+//
+//               Call sites use the macros below:  a site looks up
+//               its metric once (thread-safe static), after which an
+//               update is a few relaxed atomic operations, so timers
+//               may be left around every stage of the hot path.
+//
+//                 QUANT_TIMER(name)          time the enclosing scope
+//                 QUANT_TIMER_NAMED(expr)    ... with a computed name
+//                 QUANT_COUNT(name, n)       add n to a counter
+//                 QUANT_DURATION(name, d)    add a std::chrono duration
+//
+//               Without QUANT_INSTRUMENT defined (cmake -DINSTRUMENT=OFF)
+//               the macros expand to nothing, and their arguments are
+//               not evaluated;  the registry is then always empty.
+//
+
+#include "quant.hxx"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+#ifndef INSTRUMENTATION_HXX
+#define INSTRUMENTATION_HXX
+
+NS_QUANT_BEGIN
+
+class Metric
+{
+  public:
+    enum Kind { TIMER, COUNTER };
+  private:
+    std::string name;
+    Kind kind;
+    std::atomic<uint64_t> count;         // events
+    std::atomic<uint64_t> total;         // sum of values (ns for timers)
+    std::atomic<uint64_t> largest;       // largest value
+    // copy constructor is not implemented, restrict use as private
+    Metric(const Metric& metric);
+    Metric& operator=(const Metric& metric);
+  protected:
+  public:
+    Metric(const std::string& name, Kind kind);
+    inline void add(uint64_t value)
+    {
+      count.fetch_add(1, std::memory_order_relaxed);
+      total.fetch_add(value, std::memory_order_relaxed);
+      uint64_t seen = largest.load(std::memory_order_relaxed);
+      while(value>seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+    void reset();
+    inline const std::string& getName() const { return name; }
+    inline Kind getKind() const { return kind; }
+    inline uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    inline uint64_t getTotal() const { return total.load(std::memory_order_relaxed); }
+    inline uint64_t getMax() const { return largest.load(std::memory_order_relaxed); }
+};
+
+// times its scope, into a timer metric
+class ScopedTimer
+{
+  private:
+    Metric* metric;
+    std::chrono::steady_clock::time_point start;
+    // copy constructor is not implemented, restrict use as private
+    ScopedTimer(const ScopedTimer& timer);
+    ScopedTimer& operator=(const ScopedTimer& timer);
+  public:
+    inline ScopedTimer(Metric* metric)
+      : metric(metric), start(std::chrono::steady_clock::now()) {}
+    inline ~ScopedTimer()
+    {
+      metric->add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now()-start).count());
+    }
+};
+
+class Instrumentation
+{
+  private:
+    typedef std::map<std::string,std::unique_ptr<Metric> > metric_map;
+    // the registry (constructed on first use, never destroyed, so
+    // metrics may be updated during static destruction)
+    static metric_map& getRegistry(std::unique_lock<std::mutex>& guard);
+  protected:
+  public:
+    // true if the call sites were compiled in (QUANT_INSTRUMENT)
+    static bool isEnabled();
+    // the metric of a name, created on first use (never released)
+    static Metric* get(const std::string& name, Metric::Kind kind);
+    // every metric, in name order
+    static std::vector<const Metric*> getMetrics();
+    static void reset();
+    // summary of every metric:
+    //   {"enabled":true,
+    //    "timers":{"<name>":{"count":n,"total_s":t,"max_s":t},...},
+    //    "counters":{"<name>":{"count":n,"total":v,"max":v},...}}
+    static std::string toJson();
+};
+
+NS_QUANT_END
+
+#define QUANT_CONCAT_(a,b) a##b
+#define QUANT_CONCAT(a,b) QUANT_CONCAT_(a,b)
+
+#ifdef QUANT_INSTRUMENT
+#define QUANT_TIMER(name) \
+  static NS_QUANT::Metric* QUANT_CONCAT(quant_metric_,__LINE__) = \
+    NS_QUANT::Instrumentation::get(name, NS_QUANT::Metric::TIMER); \
+  NS_QUANT::ScopedTimer QUANT_CONCAT(quant_timer_,__LINE__)(QUANT_CONCAT(quant_metric_,__LINE__))
+#define QUANT_TIMER_NAMED(name) \
+  NS_QUANT::ScopedTimer QUANT_CONCAT(quant_timer_,__LINE__)( \
+    NS_QUANT::Instrumentation::get(name, NS_QUANT::Metric::TIMER))
+#define QUANT_COUNT(name, n) \
+  do { \
+    static NS_QUANT::Metric* quant_metric = \
+      NS_QUANT::Instrumentation::get(name, NS_QUANT::Metric::COUNTER); \
+    quant_metric->add(n); \
+  } while(0)
+#define QUANT_DURATION(name, d) \
+  do { \
+    static NS_QUANT::Metric* quant_metric = \
+      NS_QUANT::Instrumentation::get(name, NS_QUANT::Metric::TIMER); \
+    quant_metric->add(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); \
+  } while(0)
+#else
+#define QUANT_TIMER(name)
+#define QUANT_TIMER_NAMED(name)
+#define QUANT_COUNT(name, n) do {} while(0)
+#define QUANT_DURATION(name, d) do {} while(0)
+#endif
+
+#endif
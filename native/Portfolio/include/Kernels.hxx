@@ -0,0 +1,58 @@
+// Kernels.hxx
+// Mac Radigan
+//
+// Description:  These are the vectorized kernels of the time series
+//               math (rates of return and rolling statistics) and
+//               of the portfolio statistics (moments of the returns
+//               and rate conversions).
+//
+//               Series are ordered newest first, so the return of
+//               bar n is taken against bar n+1, and a rolling window
+//               ending at bar n covers bars n..n+window-1.
+//
+//               Each kernel has an AVX2 implementation and a scalar
+//               fallback;  the implementation is selected once, at
+//               run time, from the instruction sets of the host.
+//
+
+#include "quant.hxx"
+#include <stddef.h>
+
+#ifndef KERNELS_HXX
+#define KERNELS_HXX
+
+NS_QUANT_BEGIN
+
+class Kernels
+{
+  private:
+    Kernels();
+  protected:
+  public:
+    // r[n] = (c[n]-c[n+1])/c[n+1],  n < nc-1
+    static void simpleReturns(const double* c, size_t nc, double* r);
+    // r[n] = log(c[n]/c[n+1]),  n < nc-1
+    static void logReturns(const double* c, size_t nc, double* r);
+    // y[n] = mean(x[n..n+window-1]),  n <= nx-window
+    static void rollingMean(const double* x, size_t nx, size_t window, double* y);
+    // y[n] = std(x[n..n+window-1]),  n <= nx-window  (sample, window>1)
+    static void rollingVolatility(const double* x, size_t nx, size_t window, double* y);
+    // mean, covariance and volatility of the (ns x np) column-major
+    // returns x in a single blocked sweep;  mean and vol are np long,
+    // cov is (np x np) column-major (upper triangle computed, mirrored)
+    static void moments(const double* x, size_t ns, size_t np,
+                        double* mean, double* cov, double* vol);
+    // y[n] = ((1+x[n])^t-1)*100,  daily rates to annualized percentages
+    static void annualizeRate(const double* x, size_t n, double t, double* y);
+    // y[n] = (1+x[n]/100)^(1/t)-1,  annualized percentages to daily rates
+    static void dailyRate(const double* x, size_t n, double t, double* y);
+    // name of the selected implementation ("avx2" or "scalar")
+    static const char* getIsa();
+    // select the vector implementation (if supported) or the scalar one;
+    // returns true if the vector implementation is in use
+    static bool setVectorized(bool enabled);
+};
+
+NS_QUANT_END
+
+#endif
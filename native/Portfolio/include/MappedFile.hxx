@@ -0,0 +1,41 @@
+// MappedFile.hxx
+// Mac Radigan
+//
+// Description:  This class is a read-only memory mapping of a
+//               file.  The mapping is released when the object
+//               goes out of scope, so parsers may scan the file
+//               contents in place without copying them into
+//               intermediate line buffers.
+//
+
+#include "quant.hxx"
+#include <string>
+#include <stddef.h>
+
+#ifndef MAPPEDFILE_HXX
+#define MAPPEDFILE_HXX
+
+NS_QUANT_BEGIN
+
+class MappedFile
+{
+  private:
+    int         fd;       // file descriptor of the mapped file
+    const char* data;     // first byte of the mapping (NULL if empty)
+    size_t      length;   // length of the mapping in bytes
+    // copy constructor is not implemented, restrict use as private
+    MappedFile(const MappedFile& file);
+    MappedFile& operator=(const MappedFile& file);
+  protected:
+  public:
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+    inline const char* begin() const { return data; }
+    inline const char* end() const { return data+length; }
+    inline size_t size() const { return length; }
+    inline bool empty() const { return 0==length; }
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,73 @@
+// MomentIndex.hxx
+// Mac Radigan
+//
+// Description:  This class is an index of cumulative sums and cross
+//               products of a return history, from which the mean and
+//               covariance of any window of dates [start,end) follow
+//               in O(N^2), without a pass over the T rows.
+//
+//               Sums are kept at checkpoints every stride rows (stride 1
+//               is a plain prefix sum), and a query corrects the sums
+//               of the checkpoints nearest to the window ends by the
+//               rows between them, at most stride/2 at either end.
+//
+//               For numerical safety, returns are accumulated about the
+//               mean of the history (so the sums of a window do not 
+//               cancel), and each block of stride rows is summed on its
+//               own before it is added to the running totals (rounding
+//               grows with the number of blocks, not of rows).
+//
+//               Storage is (T/stride)*N*(N+3)/2 doubles.
+//
+
+#include "quant.hxx"
+#include <armadillo>
+#include <vector>
+#include <time.h>
+
+#ifndef MOMENTINDEX_HXX
+#define MOMENTINDEX_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+class MomentIndex
+{
+  private:
+    int stride;                     // rows between checkpoints
+    mat returns;                    // (N x T) returns, one column per date
+    std::vector<time_t> dates;      // (T) dates, oldest first
+    vec shift;                      // (N) mean of the history
+    mat sums;                       // (N x C) sums of rows [0, c*stride)
+    mat products;                   // (N*(N+1)/2 x C) cross products of
+                                    //   rows [0, c*stride), packed upper
+    // add (sign 1) or remove (sign -1) the sums and cross products 
+    // of rows [first,last)
+    void accumulate(int first, int last, double sign, double* s, double* c) const;
+    // copy constructor is not implemented, restrict use as private
+    MomentIndex(const MomentIndex& index);
+    MomentIndex& operator=(const MomentIndex& index);
+  protected:
+  public:
+    // rows between checkpoints
+    static const int DEFAULT_STRIDE;
+    MomentIndex();
+    ~MomentIndex();
+    // index the (N x T) returns x, one column per date (oldest first)
+    void build(const mat& x, const std::vector<time_t>& dates,
+               int stride=DEFAULT_STRIDE);
+    inline int getRows() const { return returns.n_cols; }
+    inline int getDimension() const { return returns.n_rows; }
+    inline int getStride() const { return stride; }
+    inline const mat& getReturns() const { return returns; }
+    inline const std::vector<time_t>& getDates() const { return dates; }
+    // the end of a window ending on date last (rows dated up to last)
+    int find(time_t last) const;
+    // (1 x N) mean and (N x N) sample covariance of rows [start,end)
+    void moments(int start, int end, mat& mean, mat& covariance) const;
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,91 @@
+// MonteCarlo.hxx
+// Mac Radigan
+//
+// Description:  This class estimates the Value-at-Risk and Expected
+//               Shortfall (CVaR) of a portfolio from simulated paths
+//               of correlated daily returns,
+//
+//                 r[t] = mu + L*z[t],   z[t] ~ N(0,I),  L*L' = S
+//
+//               with L the transposed Cholesky factor of a sample
+//               covariance (S = R'*R), or the loadings of a factor
+//               model plus its specific volatilities (S = B*B' + D).
+//               The factor and the weights are shared, not copied.
+//
+//               The weights are held over the horizon (no daily
+//               rebalancing), so the loss of a path at horizon h is
+//
+//                 loss = -sum_i w[i]*(prod_t (1+r[t,i]) - 1)
+//
+//               Paths are simulated in blocks on a thread pool.  The
+//               random numbers of a path are keyed by the seed and the
+//               path index only (counter-based), so results are the
+//               same bit for bit whatever the number of threads.
+//
+// See Also:     http://wikipedia.org/wiki/Expected_shortfall
+//
+
+#include "quant.hxx"
+#include "Cholesky.hxx"
+#include "FactorModel.hxx"
+#include <armadillo>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef MONTECARLO_HXX
+#define MONTECARLO_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+// simulated risk:  one row per horizon, one column per confidence level
+struct Risk
+{
+  std::vector<int> horizon;             // horizon (trading days)
+  std::vector<double> level;            // confidence level (e.g. 0.99)
+  mat var;                              // Value-at-Risk (percent of value)
+  mat cvar;                             // Expected Shortfall (percent of value)
+  std::vector<double> mean;             // mean loss per horizon (percent)
+  size_t paths;                         // number of simulated paths
+};
+
+class MonteCarlo
+{
+  private:
+    // paths simulated per task
+    static const size_t BLOCK_SIZE;
+    const mat& mu;                       // (1 x N) daily mean returns
+    const mat& weights;                  // (1 x N) portfolio weights
+    const mat* factor;                   // upper triangular R (S = R'*R), or
+    const mat* loadings;                 // B (N x K) factor loadings
+    vec specific;                        // (N) specific volatilities sqrt(diag(D))
+    size_t npaths;
+    uint64_t seed;
+    int nthreads;
+    // simulate paths [first,last), losses[h][path] at each horizon
+    void simulate(size_t first, size_t last, const std::vector<int>& horizons,
+                  std::vector< std::vector<double> >& losses) const;
+    // copy constructor is not implemented, restrict use as private
+    MonteCarlo(const MonteCarlo& mc);
+    MonteCarlo& operator=(const MonteCarlo& mc);
+  protected:
+  public:
+    // default number of paths
+    static const size_t DEFAULT_PATHS;
+    MonteCarlo(const mat& mu, const mat& weights, const Cholesky& cholesky);
+    MonteCarlo(const mat& mu, const mat& weights, const FactorModel& factors);
+    ~MonteCarlo();
+    inline void setPaths(size_t npaths) { this->npaths = npaths; }
+    inline void setSeed(uint64_t seed) { this->seed = seed; }
+    // worker threads (0:  every hardware thread)
+    inline void setThreads(int nthreads) { this->nthreads = nthreads; }
+    inline size_t getPaths() const { return npaths; }
+    // VaR and CVaR at every horizon (days) and confidence level
+    Risk run(const std::vector<int>& horizons, const std::vector<double>& levels) const;
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,88 @@
+// PanelStore.hxx
+// Mac Radigan
+//
+// Description:  This class is an HDF5 store of a whole quote database:
+//               one (date x symbol) panel per quote field, chunked
+//               and compressed, so that a portfolio reads the columns
+//               of its own stocks over its own dates from a single
+//               file, instead of opening a CSV file per stock.
+//
+//               Layout of a store (*.h5):
+//
+//                 /dates      (D)      int64, seconds (UTC), ascending
+//                 /symbols    (N)      fixed-length strings
+//                 /open, /high, /low, /close, /adj_close
+//                             (D x N)  double, NaN where not quoted
+//                 /volume     (D x N)  int32
+//
+//               The dates are the union of the dates of every stock.
+//               Panels are chunked CHUNK_DATES x CHUNK_SYMBOLS, with
+//               the shuffle and deflate filters;  the chunks of a read
+//               are kept in the chunk cache, so the stocks of a chunk
+//               column decompress it once when read in store order.
+//
+//               A store is written by import() from the CSV layout
+//               (<database>/<SYM>/<SYM>.csv), see importPanel, and is
+//               read-only afterwards (records are not appended).
+//
+//               The HDF5 library is not thread-safe:  every call into
+//               it is serialized.  Without HDF5 (QUANT_HDF5 not 
+//               defined) opening or importing a store throws.
+//
+// See Also:     Series, SeriesCache
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <time.h>
+
+#ifndef PANELSTORE_HXX
+#define PANELSTORE_HXX
+
+NS_QUANT_BEGIN
+
+class PanelStore
+{
+  private:
+    struct Handles;                      // HDF5 file and datasets
+    std::string filename;
+    std::unique_ptr<Handles> h5;
+    std::vector<time_t> dates;           // (D) ascending
+    std::vector<std::string> symbols;    // (N) in column order
+    std::map<std::string,int> columns;   // columns(symbol, column)
+    // copy constructor is not implemented, restrict use as private
+    PanelStore(const PanelStore& store);
+    PanelStore& operator=(const PanelStore& store);
+  protected:
+  public:
+    // dates and symbols of a panel chunk
+    static const int CHUNK_DATES;
+    static const int CHUNK_SYMBOLS;
+    // deflate level of the panels (0-9)
+    static const int COMPRESSION;
+    // true if a database path names a store (by its .h5 extension)
+    static bool isStore(const std::string& database);
+    // open a store, read-only
+    PanelStore(std::string filename);
+    ~PanelStore();
+    inline const std::string& getFilename() const { return filename; }
+    inline const std::vector<time_t>& getDates() const { return dates; }
+    inline const std::vector<std::string>& getSymbols() const { return symbols; }
+    inline bool contains(const std::string& symbol) const { return columns.count(symbol)>0; }
+    // the quotes of a stock dated in [first,last] (newest first, as 
+    // loaded from its CSV file);  throws if the stock is not stored, or
+    // not quoted in the range
+    void read(const std::string& symbol, time_t first, time_t last, Series& series) const;
+    // write a store of the stocks of a CSV quote database (every 
+    // stock of the database if symbols is empty)
+    static void import(const std::string& database, std::vector<std::string> symbols,
+                       const std::string& filename);
+};
+
+NS_QUANT_END
+
+#endif
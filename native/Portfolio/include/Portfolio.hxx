@@ -12,10 +12,21 @@
 
 #include "quant.hxx"
 #include "Series.hxx"
+#include "SeriesCache.hxx"
+#include "PanelStore.hxx"
+#include "FactorModel.hxx"
+#include "ActiveSetSolver.hxx"
+#include "Cholesky.hxx"
+#include "Alignment.hxx"
+#include "MonteCarlo.hxx"
+#include "Resampler.hxx"
+#include "MomentIndex.hxx"
 #include <armadillo>
 #include <string>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <limits>
 
 #ifndef PORTFOLIO_HXX
 #define PORTFOLIO_HXX
@@ -24,29 +35,100 @@ NS_QUANT_BEGIN
 
 using namespace arma;
 
+class Renderer;
+
+// efficient frontier:  one minimum-variance portfolio per target return
+struct Frontier
+{
+  std::vector<double> rreturn;          // annualized return (percent)
+  std::vector<double> volatility;       // annualized volatility (percent)
+  mat weights;                          // portfolio weights (one row per point)
+};
+
+// walk-forward backtest:  out-of-sample returns of a portfolio that is
+// re-optimized over the trailing window at every rebalance date
+struct Backtest
+{
+  std::vector<time_t> date;             // date of each realized return
+  std::vector<double> rreturn;          // realized daily portfolio return
+  std::vector<time_t> rebalance;        // rebalance dates
+  mat weights;                          // portfolio weights (one row per rebalance)
+  double portfolio_rreturn;             // annualized realized return (percent)
+  double portfolio_volatility;          // annualized realized volatility (percent)
+};
+
 class Portfolio 
 {
   private:
-    // window size (in days) of stock price samples
+    // default window size (in days) of stock price samples
     static const int WINDOW_LENGTH; 
     // number of trading days in a year (time horizon)
     static const int TIME_HORIZON;  
+    // load only the newest records of each stock, until more are needed
+    static bool lazyLoading;
     std::string datapath;                // path do stock data directory
-    std::map<std::string,Series> stocks; // stocks(ticker symbol, time series)
+    std::map<std::string,SeriesPtr> stocks; // stocks(ticker symbol, time series)
+    SeriesCache* cache;                  // shared series (NULL if not shared)
+    std::shared_ptr<const PanelStore> store; // panel store (if datapath is one)
+    time_t first_date;                   // dates read from a panel store
+    time_t last_date;
+    int window_length;                   // days of returns in an estimate
+    time_t window_end;                   // last date of the estimate window
+    MomentIndex index;                   // moments of the return history
+    bool isIndexed;                      // index is of the current data
     mat weights;                    // portfolio weights (sum to 1)
     mat volatility;                 // individual volatilities
     mat rreturn;                    // individual returns
+    mat covariance;                 // daily covariance of returns
+    mat variance;                   // daily variance of returns
+    mat sigma;                      // daily volatility of returns
+    mat mu;                         // daily mean returns
+    Cholesky cholesky;              // Cholesky factor of the covariance
+    bool isFactored;                // cholesky is of the current estimate
+    // workspace, reused by every optimization of the same size
+    mat returns;                    // (M x N) window of daily returns
+    mat border;                     // (N x 2) KKT border [mu 1v]
+    mat border_solve;               // (N x 2) S^-1*[mu 1v]
+    mat basis_w1;                   // (1 x N) frontier basis weights
+    mat basis_w0;                   // (1 x N) frontier basis offset
+    std::vector<const Series*> members;  // series in column order
+    std::vector<time_t> window;     // (M) dates of the returns window
+    MissingData missing;            // policy for dates missing from a series
+    Alignment alignment;            // date alignment of the series
+    int nfactors;                   // factor model size (0: sample covariance)
+    FactorModel factors;            // factor model of the covariance
+    double lower_bound;             // weight bounds of every stock
+    double upper_bound;
+    std::map<std::string,std::pair<double,double> > bounds; 
+                                    // bounds(ticker symbol, (lower,upper))
+    ActiveSetSolver qp;             // bound-constrained solver (warm started)
     double portfolio_rreturn;            // portfolio return
     double portfolio_volatility;         // portfolio volatility
     bool isOptimized;                    // dirty record flag
+    bool isEstimated;                    // estimate is of the current data
+    std::vector<std::string> formats;    // report formats (file extensions)
     // convert to annualized percentage
-    static mat& annualizeRate(mat& x);
+    static mat annualizeRate(const mat& x);
     static double annualizeRate(double x);
     // convert to daily percentage
-    static mat& dailyRate(mat& x);
+    static mat dailyRate(const mat& x);
     static double dailyRate(double x);
-    mat& getReturnsAsMatrix();       // convert portfolio returns
-                                          // to matrix format
+    void getReturnsAsMatrix(mat& x);      // convert portfolio returns
+                                          // to matrix format (date aligned)
+    void getReturnHistory(mat& x, std::vector<time_t>& dates); 
+                                          // full return history, one column
+                                          // per date (oldest first)
+    // load every record of the stocks loaded partially;  true if any was
+    bool materialize(); 
+    // the moment index of the return history, built on first use
+    const MomentIndex& getIndex(); 
+    void estimate();                      // covariance and mean returns
+    std::string getFilename(const std::string& symbol) const;
+    void basis(mat& w1, mat& w0);         // frontier basis of the covariance model
+    double quadratic(const mat& a, const mat& b) const;   // a*S*b'
+    bool isBounded() const;               // any finite weight bound
+    void getBounds(vec& lower, vec& upper) const;
+    void setProblem();                    // bounded problem of the estimate
     // copy constructor is not implemented, restrict use as private
     Portfolio(const Portfolio& portfolio) {};
     Portfolio& operator=(const Portfolio& portfolio) { return *this; };
@@ -54,18 +136,89 @@ class Portfolio
   protected:
   public:
     Portfolio(std::string datapath); 
+    Portfolio(std::string datapath, SeriesCache& cache); 
     ~Portfolio(); 
     void addSeries(std::string symbol); 
+    // read only the quotes dated in [first,last] (panel stores only);
+    // stocks already added are read again
+    void setDateRange(time_t first, time_t last); 
+    // pick up records appended to the series files since they were 
+    // loaded (shared CSV series only);  true if any series has changed,
+    // the next optimization estimates again
+    bool refresh(); 
     void createReport(std::string directory); 
+    // queue the report figures on a background renderer
+    void createReport(std::string directory, Renderer& renderer); 
+    // report formats:  gnuplot, dumb (terminal), eps, ps, jpg, png, tif, pdf
+    void setFormats(const std::vector<std::string>& formats); 
+    inline const std::vector<std::string>& getFormats() const { return formats; }
+    static std::vector<std::string> getDefaultFormats(); 
+    // trading days in a year (annualization of daily rates)
+    static inline int getTimeHorizon() { return TIME_HORIZON; }
+    // days of returns in an estimate, unless set by setWindow
+    static inline int getDefaultWindowLength() { return WINDOW_LENGTH; }
+    // estimate over the length days of returns ending on date last
+    // (the newest date by default)
+    void setWindow(int length, time_t last=std::numeric_limits<time_t>::max()); 
+    inline int getWindowLength() const { return window_length; }
+    inline time_t getWindowEnd() const { return window_end; }
+    // daily mean (1 x N) and covariance (N x N) of the length days of
+    // returns ending on date last, from the moment index of the return
+    // history (pairwise is dropped);  returns the number of days
+    int moments(int length, time_t last, mat& mean, mat& covariance); 
+    // lazy loading:  stocks are added with only their newest records 
+    // (one window of a CSV file), and the rest of the file is read
+    // when an estimate, backtest or chart needs older records
+    static inline void setLazyLoading(bool enabled) { lazyLoading=enabled; }
+    static inline bool isLazyLoading() { return lazyLoading; }
+    // covariance model:  K-factor model for K>0, sample covariance for 0
+    void setFactorModel(int nfactors); 
+    // weight bounds (e.g. 0 and inf for long-only), for every stock
+    // or for a single stock;  bounded problems use ActiveSetSolver
+    void setBounds(double lower, double upper); 
+    void setBounds(std::string symbol, double lower, double upper); 
+    // dates missing from some series:  drop, ffill or pairwise
+    inline void setMissingData(MissingData policy) { missing=policy; isEstimated=false; isIndexed=false; }
+    inline MissingData getMissingData() const { return missing; }
+    inline int getIterations() const { return qp.getIterations(); }
+    // Cholesky factor of the covariance of the last estimate (factored
+    // on first use)
+    const Cholesky& getCholesky(); 
     void optimize(double rreturn_opt);
-    inline double getPortfolioReturn() { return portfolio_rreturn; };
-    inline double getPortfolioVolatility() { return portfolio_volatility; };
-    inline mat& getReturn() { return rreturn; };
-    inline mat& getVolatility() { return volatility; };
-    std::string& toString() const;
+    Frontier frontier(const std::vector<double>& targets);
+    // resampled frontier:  weights averaged over bootstrap resamples of
+    // the returns window (blocks of block days, 1 for the bootstrap);
+    // targets not attainable in any resample are omitted
+    Frontier resample(const std::vector<double>& targets, 
+                      size_t nresamples=Resampler::DEFAULT_RESAMPLES, int block=1,
+                      uint64_t seed=1, int nthreads=0);
+    // moments over pairwise complete rows of x (NaN missing)
+    static void pairwiseMoments(const mat& x, mat& mu, mat& s, mat& sigma);
+    // frontier basis, w = mu_opt*w1+w0
+    static void solveBasis(const mat& s, const mat& mu, mat& w1, mat& w0);
+    static void solveBasis(const Cholesky& factor, const mat& mu, mat& w1, mat& w0);
+    // frontier basis from m = [mu 1v] and y = S^-1*m (2 x 2 Schur complement)
+    static void schurBasis(const mat& m, const mat& y, mat& w1, mat& w0);
+    // walk-forward backtest over the whole history, re-optimized over
+    // the trailing window (of the window length) every rebalance days
+    Backtest backtest(double rreturn_opt, int rebalance);
+    // Monte Carlo VaR and CVaR of the optimized weights, over horizons
+    // (days) at confidence levels, from the covariance model's factor
+    Risk risk(const std::vector<int>& horizons, const std::vector<double>& levels,
+              size_t npaths=MonteCarlo::DEFAULT_PATHS, uint64_t seed=1, int nthreads=0);
+    inline double getPortfolioReturn() const { return portfolio_rreturn; };
+    inline double getPortfolioVolatility() const { return portfolio_volatility; };
+    inline const mat& getReturn() const { return rreturn; };
+    inline const mat& getVolatility() const { return volatility; };
+    inline const mat& getWeights() const { return weights; };
+    // (M x N) daily returns of the last estimate, newest first
+    inline const mat& getReturnWindow() const { return returns; };
+    // symbols in weight (column) order
+    std::vector<std::string> getSymbols() const;
+    std::string toString() const;
 };
 
-std::ostream& operator<<(std::ostream& os, const Portfolio& p) 
+inline std::ostream& operator<<(std::ostream& os, const Portfolio& p) 
 {
   os << p.toString();
   return os;
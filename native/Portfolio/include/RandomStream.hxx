@@ -0,0 +1,80 @@
+// RandomStream.hxx
+// Mac Radigan
+//
+// Description:  This class is a counter-based random number stream
+//               (splitmix64):  the n-th number of a stream is
+//
+//                 mix(key + n*gamma),   key = mix(seed ^ mix(stream+gamma))
+//
+//               so the stream of any path, resample or sample is
+//               generated on any thread, in any order, from the seed
+//               and its index alone.  The sequence is fully specified
+//               (unlike the distributions of <random>), so results do
+//               not depend on the platform or the number of threads.
+//
+// See Also:     G. L. Steele, D. Lea and C. H. Flood, Fast Splittable
+//               Pseudorandom Number Generators, OOPSLA 2014
+//
+
+#include "quant.hxx"
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#ifndef RANDOMSTREAM_HXX
+#define RANDOMSTREAM_HXX
+
+NS_QUANT_BEGIN
+
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;  // odd, 2^64/phi
+
+class RandomStream
+{
+  private:
+    uint64_t state;
+    bool cached;                    // spare normal deviate is held
+    double spare;
+  public:
+    RandomStream(uint64_t seed, uint64_t stream)
+      : state(mix(seed ^ mix(stream+GOLDEN_GAMMA))), cached(false), spare(0)
+    {
+    }
+    // splitmix64 finalizer (a bijection of 64 bit words)
+    static inline uint64_t mix(uint64_t z)
+    {
+      z = (z ^ (z>>30))*0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z>>27))*0x94D049BB133111EBULL;
+      return z ^ (z>>31);
+    }
+    inline uint64_t next() { return mix(state += GOLDEN_GAMMA); }
+    // uniform on [0,1)
+    inline double uniform() { return (next()>>11)*(1.0/9007199254740992.0); }
+    // uniform on [0,n)
+    inline size_t uniform(size_t n) { return static_cast<size_t>(uniform()*n); }
+    // uniform on (-1,1)
+    inline double symmetric()
+    {
+      return static_cast<int64_t>(next())*(1.0/9223372036854775808.0);
+    }
+    // standard normal, by the polar method (no sin or cos)
+    inline double normal()
+    {
+      if(cached) { cached = false; return spare; }
+      double u, v, s;
+      do {
+        u = symmetric();
+        v = symmetric();
+        s = u*u+v*v;
+      } while(s>=1 || 0==s);
+      double f = sqrt(-2*log(s)/s);
+      spare = v*f;
+      cached = true;
+      return u*f;
+    }
+};
+
+NS_QUANT_END
+
+#endif
+
+// *EOF*
@@ -0,0 +1,89 @@
+// Renderer.hxx
+// Mac Radigan
+//
+// Description:  This class renders figures in the background on
+//               a pool of long-lived gnuplot sessions.  Each worker
+//               thread owns one session, started on its first
+//               figure, and renders any number of outputs through
+//               it.  A session that fails (e.g. gnuplot exited) is
+//               closed, and the figure is sent to a new session.  The
+//               destructor completes all queued figures and waits for
+//               the sessions to finish writing.
+//
+//               Rendering is incremental:  every output file is
+//               tagged with the fingerprint of the commands that
+//               render it, data included (in a hidden file
+//               .<file>.fingerprint next to it), and is only
+//               rendered again when the fingerprint changes.  The tag
+//               is written once gnuplot confirms the output (a print
+//               of its error number, read back after the figure), so
+//               an output that failed is rendered again.
+//
+// See Also:     Figure
+//
+
+#include "quant.hxx"
+#include "Figure.hxx"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <sys/time.h>
+
+#ifndef RENDERER_HXX
+#define RENDERER_HXX
+
+NS_QUANT_BEGIN
+
+class Renderer
+{
+  private:
+    struct Job
+    {
+      std::string commands;              // gnuplot commands
+      std::string tag;                   // fingerprint file (empty: none)
+      std::string format;                // output extension (or terminal)
+      uint64_t fingerprint;
+    };
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;                // queued figures
+    std::mutex lock;
+    std::condition_variable ready;
+    bool stopping;
+    bool incremental;                    // skip outputs that are current
+    size_t rendered;                     // figures delivered to a session
+    size_t skipped;                      // outputs already current
+    struct timeval children;             // CPU time of reaped sessions
+    struct Session;
+    void run();
+    void enqueue(const Job& job);
+    static std::string getTagName(const std::string& filename);
+    static bool isCurrent(const std::string& filename, uint64_t fingerprint);
+    static void tag(const std::string& tag, uint64_t fingerprint);
+    // copy constructor is not implemented, restrict use as private
+    Renderer(const Renderer& renderer);
+    Renderer& operator=(const Renderer& renderer);
+  protected:
+  public:
+    // seconds a session may take to confirm a figure
+    static const int TIMEOUT;
+    Renderer(int nsessions, bool incremental=true);
+    ~Renderer();
+    // queue a figure for output to filename (terminal of its extension),
+    // or to the figure's own terminal if filename is empty;  .gnuplot
+    // scripts need no session and are written immediately
+    void render(const Figure& figure, const std::string& filename);
+    void submit(const std::string& commands);
+    inline int size() const { return workers.size(); }
+    // 64 bit FNV-1a hash of a text
+    static uint64_t getFingerprint(const std::string& text);
+    size_t getRendered();
+    size_t getSkipped();
+};
+
+NS_QUANT_END
+
+#endif
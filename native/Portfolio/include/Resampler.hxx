@@ -0,0 +1,80 @@
+// Resampler.hxx
+// Mac Radigan
+//
+// Description:  This class computes resampled efficient portfolios
+//               (Michaud):  the returns window is resampled many
+//               times, each resample is estimated and optimized, and
+//               the weights of every target return are averaged over
+//               the resamples, which damps the sensitivity of the
+//               weights to estimation noise.
+//
+//               Resamples draw the rows (days) of the returns matrix
+//               with replacement, one at a time (bootstrap) or in
+//               circular blocks of consecutive days (block bootstrap,
+//               which keeps short-range dependence).
+//
+//               Resamples are claimed in small batches from a shared
+//               counter by one worker per thread, each with its own
+//               scratch matrices and solver (reused across resamples).
+//               The rows of a resample depend only on the seed and its
+//               index, and weights are averaged in resample order, so
+//               the result does not depend on the number of threads.
+//
+// See Also:     R. Michaud, Efficient Asset Management, 1998
+//
+
+#include "quant.hxx"
+#include <armadillo>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef RESAMPLER_HXX
+#define RESAMPLER_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+class Resampler
+{
+  private:
+    // resamples claimed at a time by a worker
+    static const size_t BATCH_SIZE;
+    struct Scratch;
+    const mat& returns;                  // (M x N) daily returns, complete
+    int nfactors;                        // factor model size (0: sample covariance)
+    vec lower;                           // weight bounds (empty: unbounded)
+    vec upper;
+    size_t nresamples;
+    int block;                           // block length (days, 1: bootstrap)
+    uint64_t seed;
+    int nthreads;
+    // estimate and optimize resample idx, weights[t*N..] of each target
+    bool resample(size_t idx, const std::vector<double>& targets, Scratch& scratch,
+                  double* weights, char* solved) const;
+    // copy constructor is not implemented, restrict use as private
+    Resampler(const Resampler& resampler);
+    Resampler& operator=(const Resampler& resampler);
+  protected:
+  public:
+    // default number of resamples
+    static const size_t DEFAULT_RESAMPLES;
+    Resampler(const mat& returns, int nfactors=0);
+    ~Resampler();
+    inline void setResamples(size_t nresamples) { this->nresamples = nresamples; }
+    // block length of the block bootstrap (0 or 1:  bootstrap)
+    inline void setBlockLength(int block) { this->block = block>1 ? block : 1; }
+    inline void setSeed(uint64_t seed) { this->seed = seed; }
+    // worker threads (0:  every hardware thread)
+    inline void setThreads(int nthreads) { this->nthreads = nthreads; }
+    // weight bounds of the active-set solver (empty:  unbounded)
+    void setBounds(const vec& lower, const vec& upper);
+    // averaged weights, one row per daily target return;  count[t] is 
+    // the number of resamples in which target t was attainable
+    mat run(const std::vector<double>& targets, std::vector<size_t>& count) const;
+};
+
+NS_QUANT_END
+
+#endif
@@ -13,50 +13,121 @@
 //
 
 #include "quant.hxx"
+#include "Aligned.hxx"
 #include <string>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <map>
+#include <mutex>
 #include <time.h>
+#include <sys/stat.h>
 
 #ifndef SERIES_HXX
 #define SERIES_HXX
 
 NS_QUANT_BEGIN
 
+// cache-aligned, padded columns (structure of arrays)
+typedef std::vector<time_t, AlignedAllocator<time_t> > TimeColumn;
+typedef std::vector<double, AlignedAllocator<double> > DoubleColumn;
+typedef std::vector<int,    AlignedAllocator<int> >    IntColumn;
+
 class Series 
 {
   private:
     std::string              symbol;
-    std::vector<time_t>      date;
-    std::vector<double>      close;
-    std::vector<double>      open;
-    std::vector<double>      high;
-    std::vector<double>      low;
-    std::vector<int>         volume;
-    std::vector<double>      adj_close;
-    std::vector<double>      rreturn;
+    TimeColumn               date;
+    DoubleColumn             close;
+    DoubleColumn             open;
+    DoubleColumn             high;
+    DoubleColumn             low;
+    IntColumn                volume;
+    DoubleColumn             adj_close;
+    DoubleColumn             rreturn;
+    static bool              useSidecar;
+    off_t                    parsed;   // bytes of the source CSV parsed
+    ino_t                    inode;    // inode of the source CSV
+    size_t                   recent;   // newest records loaded (0: every record)
+    // serialized CSV of the newest records, by number of records;
+    // series are shared read-only, so the cache is filled under a lock
+    mutable std::map<int,std::string> csv;
+    mutable std::mutex       csvLock;
+    void computeReturns();           // daily rates of return from close
+    void parseCsv(std::string filename, size_t nrecords);
+    // parse the records of [p,end) onto the columns (origin is the start
+    // of the file, for error messages)
+    void parseRecords(const char* origin, const char* p, const char* end,
+                      const std::string& filename);
+    void reverse();                  // reverse the order of the records
+    // order the records newest first, whatever the order of the file
+    // (a date quoted twice keeps its first record)
+    void normalize();
+    // binary columnar cache of a parsed CSV file
+    static std::string getSidecarName(const std::string& filename);
+    bool loadSidecar(const std::string& sidecar, const struct stat& source);
+    bool saveSidecar(const std::string& sidecar, const struct stat& source) const;
+    // reads the columns of a stock from a panel store
+    friend class PanelStore;
   protected:
   public:
     Series(); 
     ~Series(); 
-    void load(std::string symbol, std::string filename); 
+    // load a Yahoo! Finance CSV file, through its binary sidecar
+    // (<SYM>.qbin) when one exists and matches the CSV mtime and size;
+    // records are held newest first, whatever the order of the file;
+    // nrecords>0 parses only the newest nrecords records of a file 
+    // that is newest first (the rest of the file is not read), else
+    // every record is loaded
+    void load(std::string symbol, std::string filename, size_t nrecords=0); 
+    // line-by-line stream parser (reference path for benchmarking)
+    void loadStream(std::string symbol, std::string filename); 
+    // true if the source CSV has changed size or been replaced since
+    // it was loaded (or last updated)
+    bool isStale(const std::string& filename) const; 
+    // add the records appended to the source CSV since it was loaded,
+    // parsing only the appended lines (in any date order), as a load
+    // of the file would order them;  a file that was replaced, 
+    // truncated, rewritten or appended out of order is reloaded
+    // (as are the newest records of a partial series);  returns the 
+    // number of new records
+    size_t update(const std::string& filename); 
+    // true if every record of the source was loaded
+    inline bool isComplete() const { return 0==recent; }
+    // true if the series holds the newest nrecords records (0: every record)
+    inline bool covers(size_t nrecords) const { return 0==recent || (nrecords>0 && nrecords<=recent); }
+    inline const std::string&      getSymbol() const { return symbol; }
     //inline std::vector<std::string> getDate() { return date; }
-    inline std::vector<time_t>      getDate() { return date; }
-    inline std::vector<double>      getClose() { return close; }
-    inline std::vector<double>      getOpen() { return open; }
-    inline std::vector<double>      getHigh() { return high; }
-    inline std::vector<double>      getLow() { return low; }
-    inline std::vector<int>         getVolume() { return volume; }
-    inline std::vector<double>      getAdjClose() { return adj_close; }
-    inline std::vector<double>      getRreturn() { return rreturn; }
-    std::string getAsCsv(int nsamples) const; // serialize data to Comma Separated Value (CSV) format
+    inline const TimeColumn&       getDate() const { return date; }
+    inline const DoubleColumn&     getClose() const { return close; }
+    inline const DoubleColumn&     getOpen() const { return open; }
+    inline const DoubleColumn&     getHigh() const { return high; }
+    inline const DoubleColumn&     getLow() const { return low; }
+    inline const IntColumn&        getVolume() const { return volume; }
+    inline const DoubleColumn&     getAdjClose() const { return adj_close; }
+    inline const DoubleColumn&     getRreturn() const { return rreturn; }
+    // derived series (newest first), computed by the vector kernels
+    void getLogReturn(DoubleColumn& r) const;           // log(c[n]/c[n+1])
+    void getAdjReturn(DoubleColumn& r) const;           // from adjusted close
+    void getRollingMean(int window, DoubleColumn& y) const;       // of returns
+    void getRollingVolatility(int window, DoubleColumn& y) const; // of returns
+    // enable or disable the binary sidecar cache (enabled by default)
+    static inline void setSidecarEnabled(bool enabled) { useSidecar=enabled; }
+    // serialize the newest nsamples records (at most the whole series)
+    // to Comma Separated Value (CSV) format (cached)
+    const std::string& getAsCsv(int nsamples) const;
     Series& operator=(const Series &rhs);
+    Series& operator=(Series &&rhs);
     Series(const Series &copyin);
+    Series(Series &&movein);
     int operator==(const Series &rhs) const;
     int operator<(const Series &rhs) const;
     //friend ostream &operator<<(ostream &, const Series &);
 };
 
+// series shared read-only between portfolios
+typedef std::shared_ptr<const Series> SeriesPtr;
+
 NS_QUANT_END
 
 #endif
@@ -0,0 +1,79 @@
+// SeriesCache.hxx
+// Mac Radigan
+//
+// Description:  This class is a thread-safe cache of loaded
+//               financial time series, keyed by file name.
+//
+//               Each file is loaded at most once, by the first
+//               caller to request it; concurrent callers for the
+//               same file wait for that load to complete (and share
+//               its failure, which is not cached).  The
+//               loaded series are shared read-only between all
+//               portfolios that hold them.
+//
+//               Long-running callers refresh a file to pick up
+//               records appended to it:  the cached series is copied,
+//               the copy is updated from the appended lines only,
+//               and replaces the cached entry.  Portfolios holding
+//               the previous series are unaffected until they
+//               refresh too.
+//
+//               A series may be loaded partially, with only its newest
+//               records;  a caller requesting more records replaces
+//               the cached entry with a series holding them.
+//
+//               Series of a panel store are keyed by store, stock
+//               and date range, and the stores are kept open.
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include "PanelStore.hxx"
+#include <string>
+#include <map>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <memory>
+#include <time.h>
+
+#ifndef SERIESCACHE_HXX
+#define SERIESCACHE_HXX
+
+NS_QUANT_BEGIN
+
+class SeriesCache 
+{
+  private:
+    typedef std::shared_future<SeriesPtr> entry_type;
+    std::map<std::string,entry_type> entries; // entries(file name or store key, series)
+    std::map<std::string,std::shared_ptr<const PanelStore> > stores; // stores(file name, store)
+    std::mutex lock;
+    // the entry of a key, loaded by the first caller to request it
+    SeriesPtr load(const std::string& key, const std::function<void(Series&)>& read); 
+    // replace the current entry of a key by a copy of it modified by
+    // update, unless another caller has replaced it already
+    SeriesPtr replace(const std::string& key, const SeriesPtr& current,
+                      const std::function<void(Series&)>& update); 
+    // copy constructor is not implemented, restrict use as private
+    SeriesCache(const SeriesCache& cache);
+    SeriesCache& operator=(const SeriesCache& cache);
+  protected:
+  public:
+    SeriesCache(); 
+    ~SeriesCache(); 
+    // the series of a file holding at least its newest nrecords
+    // records (0: every record)
+    SeriesPtr get(std::string symbol, std::string filename, size_t nrecords=0); 
+    // the quotes of a stock in a panel store dated in [first,last]
+    SeriesPtr get(std::string symbol, const PanelStore& store, time_t first, time_t last); 
+    // a panel store, opened by the first caller to request it
+    std::shared_ptr<const PanelStore> getStore(const std::string& filename); 
+    // the cached series, updated first if its file has changed
+    SeriesPtr refresh(std::string symbol, std::string filename); 
+    size_t size(); 
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,66 @@
+// Server.hxx
+// Mac Radigan
+//
+// Description:  This class is a long-running request server on a
+//               local (Unix domain) socket.  Each connection carries
+//               one request:  the client writes the request and shuts
+//               down its side of the connection, the server replies
+//               and closes the connection.
+//
+//               Requests are answered on a pool of worker threads by
+//               the request handler, so the state the handler keeps
+//               (loaded series, estimates) stays hot between requests.
+//               A handler exception is returned to the client as a
+//               single "error: <what>" line.  A client that does not
+//               send its request (or read its reply) within the
+//               timeout is dropped, so that it does not hold a worker.
+//
+// See Also:     ThreadPool
+//
+
+#include "quant.hxx"
+#include "ThreadPool.hxx"
+#include <string>
+#include <functional>
+
+#ifndef SERVER_HXX
+#define SERVER_HXX
+
+NS_QUANT_BEGIN
+
+class Server
+{
+  public:
+    typedef std::function<std::string(const std::string&)> handler_type;
+  private:
+    std::string path;                    // socket path
+    handler_type handler;                // request --> reply
+    int listener;                        // listening socket
+    int wakeup[2];                       // self-pipe, written by stop()
+    int timeout;                         // seconds a client may stall
+    ThreadPool pool;
+    void serve(int connection);
+    // copy constructor is not implemented, restrict use as private
+    Server(const Server& server);
+    Server& operator=(const Server& server);
+  protected:
+  public:
+    // largest request accepted (bytes)
+    static const size_t MAX_REQUEST;
+    // seconds a client may stall reading or writing (default)
+    static const int TIMEOUT;
+    // listen on path (a stale socket file is replaced)
+    Server(const std::string& path, const handler_type& handler, int nthreads,
+           int timeout=TIMEOUT);
+    ~Server();
+    // accept connections until stop() is called
+    void run();
+    // async-signal-safe:  may be called from a signal handler
+    void stop();
+    // send a request to the server listening on path, and return its reply
+    static std::string query(const std::string& path, const std::string& request);
+};
+
+NS_QUANT_END
+
+#endif
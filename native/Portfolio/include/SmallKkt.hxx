@@ -0,0 +1,118 @@
+// SmallKkt.hxx
+// Mac Radigan
+//
+// Description:  This is the frontier basis of small portfolios (up to
+//               MAX_STOCKS stocks), specialized on the number of stocks
+//               at compile time:
+//
+//                 Y = S^-1*[mu 1v],   [w1 w0] = Y*C^-1
+//
+//               as Portfolio::solveBasis, but on fixed-size arrays on
+//               the stack, with loops of constant trip count that the
+//               compiler unrolls, and no allocation.  The dispatcher
+//               selects the specialization at run time, and reports
+//               failure for larger portfolios, or for a covariance
+//               that is not positive definite (the Cholesky class then
+//               regularizes it), so callers fall back to the dynamic
+//               solve.
+//
+// See Also:     Portfolio::solveBasis
+//
+
+#include "quant.hxx"
+#include <armadillo>
+#include <math.h>
+#include <stddef.h>
+
+#ifndef SMALLKKT_HXX
+#define SMALLKKT_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+template<int N>
+class FixedKkt
+{
+  public:
+    // s (N x N, column major), mu (N);  w1, w0 (N) and, if given, 
+    // the variance 1/(1v'*S^-1*1v) of the global minimum-variance 
+    // portfolio;  false if S is not numerically positive definite (a
+    // pivot below 1e-12 of its diagonal), or the returns are degenerate
+    static inline bool basis(const double* s, const double* mu,
+                             double* w1, double* w0, double* minimum=NULL)
+    {
+      // S = L*L', L lower triangular (by rows), with reciprocal pivots
+      double l[N][N];
+      double inv[N];
+      for(int j=0; j<N; j++)
+      {
+        double d = s[j*N+j];
+        for(int k=0; k<j; k++) d -= l[j][k]*l[j][k];
+        if(!(d>1e-12*s[j*N+j])) return false;
+        inv[j] = 1/sqrt(d);
+        for(int i=j+1; i<N; i++)
+        {
+          double v = s[j*N+i];
+          for(int k=0; k<j; k++) v -= l[i][k]*l[j][k];
+          l[i][j] = v*inv[j];
+        }
+      }
+      // L*z = [mu 1v], then L'*y = z
+      double y0[N];
+      double y1[N];
+      for(int i=0; i<N; i++)
+      {
+        double v0 = mu[i];
+        double v1 = 1;
+        for(int k=0; k<i; k++) { v0 -= l[i][k]*y0[k]; v1 -= l[i][k]*y1[k]; }
+        y0[i] = v0*inv[i];
+        y1[i] = v1*inv[i];
+      }
+      for(int i=N-1; i>=0; i--)
+      {
+        double v0 = y0[i];
+        double v1 = y1[i];
+        for(int k=i+1; k<N; k++) { v0 -= l[k][i]*y0[k]; v1 -= l[k][i]*y1[k]; }
+        y0[i] = v0*inv[i];
+        y1[i] = v1*inv[i];
+      }
+      // 2 x 2 Schur complement [c b; b a], as Portfolio::schurBasis
+      double a = 0;
+      double b = 0;
+      double c = 0;
+      for(int i=0; i<N; i++)
+      {
+        a += y1[i];
+        b += y0[i];
+        c += mu[i]*y0[i];
+      }
+      double d = a*c-b*b;
+      if(0==d || !isfinite(d)) return false;
+      double r = 1/d;
+      for(int i=0; i<N; i++)
+      {
+        w1[i] = (a*y0[i] - b*y1[i])*r;
+        w0[i] = (c*y1[i] - b*y0[i])*r;
+      }
+      if(minimum) *minimum = 1/a;
+      return true;
+    }
+};
+
+class SmallKkt
+{
+  public:
+    // largest portfolio with a fixed-size specialization
+    static const int MAX_STOCKS;
+    // the specialization for n stocks (false if there is none, or
+    // if it fails);  arguments as FixedKkt<N>::basis
+    static bool basis(int n, const double* s, const double* mu,
+                      double* w1, double* w0, double* minimum=NULL);
+    // s (n x n), mu (1 x n);  w1, w0 (1 x n)
+    static bool basis(const mat& s, const mat& mu, mat& w1, mat& w0);
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,66 @@
+// SyntheticMarket.hxx
+// Mac Radigan
+//
+// Description:  This class generates a deterministic synthetic
+//               market:  daily quotes of any number of stocks, in
+//               the Yahoo! Finance CSV format of the quote database
+//               (<database>/<SYM>/<SYM>.csv, newest first).
+//
+//               Returns are correlated through a K-factor model,
+//
+//                 r[t,i] = mu[i] + b[i]'*f[t] + s[i]*e[t,i]
+//
+//               with a market factor (positive loadings) and K-1
+//               style factors.  Every stock is generated from its
+//               own random stream, so a stock is the same whatever
+//               the number of stocks generated with it, and the
+//               output depends only on the seed (not on the random
+//               number library of the platform).
+//
+//               Quotes are dated on weekdays, ending 2013-12-31.
+//
+
+#include "quant.hxx"
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef SYNTHETICMARKET_HXX
+#define SYNTHETICMARKET_HXX
+
+NS_QUANT_BEGIN
+
+class SyntheticMarket
+{
+  private:
+    int ndays;                           // quotes per stock
+    int nfactors;                        // number of factors
+    uint64_t seed;
+    std::vector<std::string> symbols;
+    std::vector<double> factors;         // (ndays x K) factor returns, by day
+    std::vector<time_t> dates;           // (ndays) quote dates, oldest first
+    void generate();
+  protected:
+  public:
+    // trading days in a year
+    static const int DAYS_PER_YEAR;
+    // symbols SYN0000, SYN0001, ...
+    SyntheticMarket(int nsymbols, int ndays, uint64_t seed=1, int nfactors=3);
+    SyntheticMarket(const std::vector<std::string>& symbols, int ndays,
+                    uint64_t seed=1, int nfactors=3);
+    ~SyntheticMarket();
+    inline const std::vector<std::string>& getSymbols() const { return symbols; }
+    inline int getDays() const { return ndays; }
+    // write the quotes of stock idx as a CSV file
+    void writeSeries(int idx, const std::string& filename) const;
+    // write the quotes of every stock to a quote database
+    void write(const std::string& database) const;
+    // write an input data file for the first nstocks stocks
+    void writePortfolio(const std::string& filename, const std::string& database,
+                        const std::string& output, int nstocks, double roi) const;
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,47 @@
+// ThreadPool.hxx
+// Mac Radigan
+//
+// Description:  This class is a fixed-size pool of worker 
+//               threads servicing a first-in first-out queue
+//               of tasks.  The destructor completes all queued
+//               tasks before joining the workers.
+//
+
+#include "quant.hxx"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#ifndef THREADPOOL_HXX
+#define THREADPOOL_HXX
+
+NS_QUANT_BEGIN
+
+class ThreadPool 
+{
+  private:
+    std::vector<std::thread> workers;
+    std::deque< std::function<void()> > tasks;
+    std::mutex lock;
+    std::condition_variable ready;
+    bool stopping;
+    void run();
+    // copy constructor is not implemented, restrict use as private
+    ThreadPool(const ThreadPool& pool);
+    ThreadPool& operator=(const ThreadPool& pool);
+  protected:
+  public:
+    ThreadPool(int nthreads); 
+    ~ThreadPool(); 
+    void submit(const std::function<void()>& task); 
+    inline int size() const { return workers.size(); }
+    // number of hardware threads (at least 1)
+    static int concurrency(); 
+};
+
+NS_QUANT_END
+
+#endif
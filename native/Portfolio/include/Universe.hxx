@@ -0,0 +1,117 @@
+// Universe.hxx
+// Mac Radigan
+//
+// Description:  This class estimates the mean returns and covariance
+//               of a universe of stocks once, so that portfolios of
+//               any subset of it are evaluated from sub-blocks of the
+//               universe estimate, without estimating again.
+//
+//               A search ranks the k-stock subsets of the universe by
+//               the annualized volatility of their minimum-variance
+//               portfolio at a target return (short selling allowed):
+//               every subset is enumerated, or a sample of them is
+//               drawn.  Subsets are evaluated in parallel, each worker
+//               with its own scratch, and keeps its best candidates;
+//               ranking is by volatility, then by members, so results
+//               do not depend on the number of threads.
+//
+//               Under the drop policy, the universe dates are those
+//               quoted by every stock of the universe;  with stocks of
+//               different calendars, the pairwise policy gives each
+//               sub-block the estimate of its own portfolio.
+//
+// See Also:     Portfolio
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include "SeriesCache.hxx"
+#include "PanelStore.hxx"
+#include "Alignment.hxx"
+#include <armadillo>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef UNIVERSE_HXX
+#define UNIVERSE_HXX
+
+NS_QUANT_BEGIN
+
+using namespace arma;
+
+// a subset of the universe and its minimum-variance portfolio
+struct Candidate
+{
+  std::vector<int> members;             // universe indices, ascending
+  std::vector<std::string> symbols;     // symbols of the members
+  double volatility;                    // annualized volatility at the target (percent)
+  double minimum;                       // annualized volatility of the global
+                                        //   minimum-variance portfolio (percent)
+  mat weights;                          // (1 x k) weights at the target
+};
+
+class Universe
+{
+  private:
+    // subsets claimed at a time by a search worker
+    static const size_t BATCH_SIZE;
+    std::string datapath;                // path to stock data directory
+    SeriesCache local;                   // series, unless a cache is shared
+    SeriesCache* cache;
+    std::shared_ptr<const PanelStore> store; // panel store (if datapath is one)
+    std::vector<std::string> symbols;    // symbols in column order
+    std::vector<SeriesPtr> series;
+    MissingData missing;                 // policy for dates missing from a series
+    Alignment alignment;
+    mat returns;                         // (M x U) window of daily returns
+    std::vector<time_t> window;          // (M) dates of the returns window
+    mat mu;                              // (1 x U) daily mean returns
+    mat covariance;                      // (U x U) daily covariance
+    bool isEstimated;
+    std::string getFilename(const std::string& symbol) const;
+    // evaluate a subset with the scratch of a worker (false if singular)
+    struct Scratch;
+    bool evaluate(const std::vector<int>& members, double mu_opt, Scratch& scratch,
+                  double& variance, double& minimum) const;
+    // copy constructor is not implemented, restrict use as private
+    Universe(const Universe& universe);
+    Universe& operator=(const Universe& universe);
+  protected:
+  public:
+    Universe(std::string datapath);
+    Universe(std::string datapath, SeriesCache& cache);
+    ~Universe();
+    void addSeries(std::string symbol);
+    // update the series whose files changed since they were loaded 
+    // (true if any did;  panel stores are not refreshed)
+    bool refresh();
+    // symbols of a list file, one per line (# comments)
+    static std::vector<std::string> readSymbols(const std::string& filename);
+    inline void setMissingData(MissingData policy) { missing=policy; isEstimated=false; }
+    // mean returns and covariance of every stock, over the newest window
+    void estimate();
+    inline int size() const { return symbols.size(); }
+    inline const std::vector<std::string>& getSymbols() const { return symbols; }
+    inline const mat& getMean() const { return mu; }
+    inline const mat& getCovariance() const { return covariance; }
+    // universe index of a symbol (-1 if not in the universe)
+    int indexOf(const std::string& symbol) const;
+    // mean returns (1 x k) and covariance (k x k) of a subset
+    void extract(const std::vector<int>& members, mat& mu, mat& s) const;
+    // minimum-variance portfolio of a subset at a target return
+    // (annualized percentage), from sub-blocks of the estimate
+    Candidate evaluate(const std::vector<int>& members, double rreturn_opt) const;
+    // the ntop best k-stock subsets at a target return:  every subset
+    // (nsamples 0), or nsamples subsets drawn at random
+    std::vector<Candidate> search(int k, double rreturn_opt, size_t ntop,
+                                  size_t nsamples=0, uint64_t seed=1, int nthreads=0) const;
+    // number of k-stock subsets of n stocks (0 if it exceeds 2^63)
+    static uint64_t choose(int n, int k);
+};
+
+NS_QUANT_END
+
+#endif
@@ -0,0 +1,315 @@
+// ActiveSetSolver.cxx
+// Mac Radigan
+
+#include "ActiveSetSolver.hxx"
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+USING_QUANT
+using namespace std;
+
+const int    ActiveSetSolver::MAX_ITERATIONS = 1000;
+const double ActiveSetSolver::TOLERANCE      = 1e-10;
+const double ActiveSetSolver::PHASE1_BOUND   = 1e3;
+
+namespace {
+
+// indices of v in ascending order
+struct ascending 
+{
+  const vec& v;
+  ascending(const vec& v) : v(v) {}
+  bool operator()(int a, int b) const { return v[a]<v[b]; }
+};
+
+}
+
+ActiveSetSolver::ActiveSetSolver() 
+  : warm(false), iterations(0)
+{
+}
+
+ActiveSetSolver::~ActiveSetSolver() 
+{
+}
+
+void ActiveSetSolver::setProblem(const mat& s, const mat& mu, 
+                                 const vec& lower, const vec& upper) 
+{
+  int np = s.n_rows;
+  if(s.n_cols!=np || mu.n_elem!=np || lower.n_elem!=np || upper.n_elem!=np) 
+  {
+    throw runtime_error("Inconsistent dimensions for the constrained portfolio.");
+  }
+  for(int idx=0; idx<np; idx++) 
+  {
+    if(lower[idx]>upper[idx]) 
+    {
+      throw runtime_error("Lower weight bound exceeds upper weight bound.");
+    }
+  }
+  if(static_cast<int>(state.size())!=np) 
+  {
+    state.assign(np, FREE);
+    warm = false;
+  }
+  this->s = s;
+  this->mu.set_size(np);
+  for(int idx=0; idx<np; idx++) this->mu[idx] = mu(idx);
+  this->lower = lower;
+  this->upper = upper;
+}
+
+bool ActiveSetSolver::feasible(double target, vec& x0) const 
+{
+  //
+  // phase 1:  the weights filling the budget from the lowest (highest)
+  //           mean return up attain the least (greatest) portfolio
+  //           return within the bounds;  the target is feasible iff
+  //           it lies between the two, and a convex combination of the
+  //           two fills is then a feasible point
+  //
+  int np = mu.n_elem;
+  vec lo(np);
+  vec hi(np);
+  for(int idx=0; idx<np; idx++) 
+  {
+    lo[idx] = max(lower[idx], -PHASE1_BOUND);
+    hi[idx] = min(upper[idx],  PHASE1_BOUND);
+  }
+  double budget = 1.0-accu(lo);
+  if(budget<-TOLERANCE || budget>accu(hi-lo)+TOLERANCE) return false;
+  vector<int> order(np);
+  for(int idx=0; idx<np; idx++) order[idx] = idx;
+  sort(order.begin(), order.end(), ascending(mu));
+  vec wmin = lo;
+  vec wmax = lo;
+  double rmin = budget;
+  double rmax = budget;
+  for(int idx=0; idx<np; idx++) 
+  {
+    int a = order[idx];       // ascending mean return
+    int b = order[np-1-idx];  // descending mean return
+    double da = min(max(rmin,0.0), hi[a]-lo[a]);
+    double db = min(max(rmax,0.0), hi[b]-lo[b]);
+    wmin[a] += da; rmin -= da;
+    wmax[b] += db; rmax -= db;
+  }
+  double mmin = dot(mu, wmin);
+  double mmax = dot(mu, wmax);
+  double scale = max(fabs(mmin), fabs(mmax)) + TOLERANCE;
+  if(target<mmin-TOLERANCE*scale || target>mmax+TOLERANCE*scale) return false;
+  double theta = mmax>mmin ? (target-mmin)/(mmax-mmin) : 0.0;
+  theta = min(max(theta,0.0),1.0);
+  x0 = (1-theta)*wmin + theta*wmax;
+  return true;
+}
+
+bool ActiveSetSolver::solveEqp(double target, vec& xw) const 
+{
+  //
+  // equality-constrained problem with the working set fixed at its 
+  // bounds (free variables F, fixed variables W):
+  //
+  //   | 2S_FF  mu_F 1v | * | w_F     | = | -2S_FW*w_W      |
+  //   | mu_F'  0    0  |   | lambda1 |   | mu_opt-mu_W'w_W |
+  //   | 1v'    0    0  |   | lambda2 |   | 1-1v'w_W        |
+  //
+  int np = mu.n_elem;
+  vector<int> free;
+  for(int idx=0; idx<np; idx++) if(FREE==state[idx]) free.push_back(idx);
+  int nf = free.size();
+  if(nf<2) return false;
+  xw.set_size(np);
+  for(int idx=0; idx<np; idx++) 
+  {
+    if(AT_LOWER==state[idx]) xw[idx] = lower[idx];
+    if(AT_UPPER==state[idx]) xw[idx] = upper[idx];
+    if(FREE==state[idx])     xw[idx] = 0;
+  }
+  mat a = zeros<mat>(nf+2, nf+2);
+  mat b = zeros<mat>(nf+2, 1);
+  for(int r=0; r<nf; r++) 
+  {
+    for(int c=0; c<nf; c++) a(r,c) = 2*s(free[r],free[c]);
+    a(r,nf)   = mu[free[r]];  a(nf,r)   = mu[free[r]];
+    a(r,nf+1) = 1.0;          a(nf+1,r) = 1.0;
+    b(r,0) = -2*dot(s.col(free[r]), xw);
+  }
+  b(nf,0)   = target-dot(mu, xw);
+  b(nf+1,0) = 1.0-accu(xw);
+  mat z;
+  if(!arma::solve(z, a, b)) return false;
+  for(int r=0; r<nf; r++) xw[free[r]] = z(r,0);
+  return true;
+}
+
+bool ActiveSetSolver::step(const vec& xk, vec& p, vec& nu) const 
+{
+  //
+  // step p from xk toward the minimum over the working set:
+  //
+  //   | 2S_FF  mu_F 1v | * | p_F |   | -g_F |
+  //   | mu_F'  0    0  |   | nu1 | = |  0   |
+  //   | 1v'    0    0  |   | nu2 |   |  0   |
+  //
+  //   where g = 2S*xk, and p_W = 0
+  //
+  int np = mu.n_elem;
+  vector<int> free;
+  for(int idx=0; idx<np; idx++) if(FREE==state[idx]) free.push_back(idx);
+  int nf = free.size();
+  p.zeros(np);
+  nu.zeros(2);
+  mat a = zeros<mat>(nf+2, nf+2);
+  mat b = zeros<mat>(nf+2, 1);
+  for(int r=0; r<nf; r++) 
+  {
+    for(int c=0; c<nf; c++) a(r,c) = 2*s(free[r],free[c]);
+    a(r,nf)   = mu[free[r]];  a(nf,r)   = mu[free[r]];
+    a(r,nf+1) = 1.0;          a(nf+1,r) = 1.0;
+    b(r,0) = -2*dot(s.col(free[r]), xk);
+  }
+  if(nf<2) 
+  {
+    // the equality constraints fix the free variables; estimate the
+    // multipliers in the least-squares sense over the free variables
+    mat af = zeros<mat>(nf, 2);
+    mat gf = zeros<mat>(nf, 1);
+    for(int r=0; r<nf; r++) 
+    {
+      af(r,0) = mu[free[r]]; af(r,1) = 1.0; gf(r,0) = b(r,0);
+    }
+    mat n2;
+    mat ata = af.t()*af;
+    ata(0,0) += TOLERANCE; ata(1,1) += TOLERANCE;
+    if(!arma::solve(n2, ata, af.t()*gf)) return false;
+    nu[0] = n2(0,0); nu[1] = n2(1,0);
+    return true;
+  }
+  mat z;
+  if(!arma::solve(z, a, b)) return false;
+  for(int r=0; r<nf; r++) p[free[r]] = z(r,0);
+  nu[0] = z(nf,0);
+  nu[1] = z(nf+1,0);
+  return true;
+}
+
+vec ActiveSetSolver::solve(double target) 
+{
+  int np = mu.n_elem;
+  iterations = 0;
+  vec x0;
+  if(!feasible(target, x0)) 
+  {
+    throw runtime_error("Portfolio cannot achieve specified estimated target ROI within the weight bounds.");
+  }
+  vec xk = x0;
+  if(warm) 
+  {
+    // warm start:  minimum over the previous working set, if it is
+    // feasible, or else as far toward it from x0 as the bounds allow
+    vec xw;
+    if(solveEqp(target, xw)) 
+    {
+      vec d = xw-x0;
+      double alpha = 1.0;
+      int blocking = -1;
+      for(int idx=0; idx<np; idx++) 
+      {
+        if(FREE!=state[idx]) continue;
+        if(d[idx]<0 && x0[idx]+d[idx]<lower[idx]) 
+        {
+          double a = (lower[idx]-x0[idx])/d[idx];
+          if(a<alpha) { alpha = a; blocking = idx; }
+        } else if(d[idx]>0 && x0[idx]+d[idx]>upper[idx]) {
+          double a = (upper[idx]-x0[idx])/d[idx];
+          if(a<alpha) { alpha = a; blocking = idx; }
+        }
+      }
+      if(blocking<0) 
+      {
+        xk = xw;
+      } else {
+        // x0 is not on the previous working set; restart from it
+        state.assign(np, FREE);
+        xk = x0+alpha*d;
+        xk[blocking] = d[blocking]<0 ? lower[blocking] : upper[blocking];
+        state[blocking] = d[blocking]<0 ? AT_LOWER : AT_UPPER;
+      }
+    } else {
+      state.assign(np, FREE);
+    }
+  } else {
+    state.assign(np, FREE);
+  }
+  // variables fixed by the working set sit exactly on their bounds
+  for(int idx=0; idx<np; idx++) 
+  {
+    if(AT_LOWER==state[idx]) xk[idx] = lower[idx];
+    if(AT_UPPER==state[idx]) xk[idx] = upper[idx];
+  }
+  double scale = 0;
+  for(int idx=0; idx<np; idx++) scale = max(scale, 2*fabs(s(idx,idx)));
+  double mtol = TOLERANCE*max(scale, 1e-300);
+  vec p;
+  vec nu;
+  for(iterations=1; iterations<=MAX_ITERATIONS; iterations++) 
+  {
+    if(!step(xk, p, nu)) 
+    {
+      throw runtime_error("Constrained portfolio optimization is singular.");
+    }
+    double pmax = 0;
+    for(int idx=0; idx<np; idx++) pmax = max(pmax, fabs(p[idx]));
+    if(pmax<=TOLERANCE) 
+    {
+      // stationary on the working set:  check the bound multipliers
+      //   r = 2S*x + lambda1*mu + lambda2*1v
+      //   (r >= 0 at a lower bound, r <= 0 at an upper bound)
+      int release = -1;
+      double worst = mtol;
+      for(int idx=0; idx<np; idx++) 
+      {
+        if(FREE==state[idx]) continue;
+        double r = 2*dot(s.col(idx), xk) + nu[0]*mu[idx] + nu[1];
+        double violation = AT_LOWER==state[idx] ? -r : r;
+        if(violation>worst) { worst = violation; release = idx; }
+      }
+      if(release<0) 
+      {
+        x = xk;
+        warm = true;
+        return x;
+      }
+      state[release] = FREE;
+    } else {
+      // largest step along p that keeps the free variables in bounds
+      double alpha = 1.0;
+      int blocking = -1;
+      for(int idx=0; idx<np; idx++) 
+      {
+        if(FREE!=state[idx]) continue;
+        if(p[idx]<0 && xk[idx]+p[idx]<lower[idx]) 
+        {
+          double a = (lower[idx]-xk[idx])/p[idx];
+          if(a<alpha) { alpha = a; blocking = idx; }
+        } else if(p[idx]>0 && xk[idx]+p[idx]>upper[idx]) {
+          double a = (upper[idx]-xk[idx])/p[idx];
+          if(a<alpha) { alpha = a; blocking = idx; }
+        }
+      }
+      xk += alpha*p;
+      if(blocking>=0) 
+      {
+        state[blocking] = p[blocking]<0 ? AT_LOWER : AT_UPPER;
+        xk[blocking] = p[blocking]<0 ? lower[blocking] : upper[blocking];
+      }
+    }
+  }
+  throw runtime_error("Constrained portfolio optimization did not converge.");
+}
+
+// *EOF*
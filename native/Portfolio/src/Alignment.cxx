@@ -0,0 +1,175 @@
+// Alignment.cxx
+// Mac Radigan
+
+#include "Alignment.hxx"
+#include "Instrumentation.hxx"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string.h>
+#include <boost/algorithm/string.hpp>
+
+USING_QUANT
+using namespace std;
+
+Alignment::Alignment()
+  : missing(0)
+{
+}
+
+Alignment::~Alignment()
+{
+}
+
+void Alignment::align(const vector<const Series*>& series, MissingData policy,
+                      int nrows, mat& x, vector<time_t>& dates)
+{
+  QUANT_TIMER("align");
+  const size_t none = numeric_limits<size_t>::max();
+  int np = series.size();
+  // rows are bounded by the shortest history (drop), or the
+  // total of every history (union of the dates), less the oldest
+  size_t bound = 0;
+  size_t shortest = numeric_limits<size_t>::max();
+  for(int sIdx=0; sIdx<np; sIdx++)
+  {
+    size_t n = series[sIdx]->getDate().size();
+    bound += n;
+    shortest = min(shortest, n);
+  }
+  if(MISSING_DROP==policy && np>0) bound = shortest;
+  if(bound>0) bound--;
+  if(nrows>0 && bound>static_cast<size_t>(nrows)) bound = nrows;
+  panel.set_size(bound, np);
+  dates.clear();
+  dates.reserve(bound);
+  present.assign(np, 0);
+  quoted.assign(np, 0);
+  ahead.assign(np, none);
+  previous.assign(np, none);
+  heap.clear();
+  heap.reserve(np);
+  for(int sIdx=0; sIdx<np; sIdx++)
+  {
+    if(series[sIdx]->getDate().empty()) continue;
+    Cursor c = { series[sIdx]->getDate()[0], sIdx, 0 };
+    heap.push_back(c);
+    ahead[sIdx] = 0;
+  }
+  make_heap(heap.begin(), heap.end(), later);
+  missing = 0;
+  size_t rows = 0;
+  bool pending = false;             // a row is open on the last kept date
+  time_t opened = 0;
+  bool done = 0==np;
+  while(!done && rows<bound && !heap.empty())
+  {
+    // every series quoted on the newest remaining date
+    time_t date = heap.front().date;
+    int count = 0;
+    while(!heap.empty() && heap.front().date==date)
+    {
+      pop_heap(heap.begin(), heap.end(), later);
+      Cursor& c = heap.back();
+      present[c.series] = 1;
+      count++;
+      if(++c.pos<series[c.series]->getDate().size())
+      {
+        c.date = series[c.series]->getDate()[c.pos];
+        push_heap(heap.begin(), heap.end(), later);
+      } else {
+        heap.pop_back();
+      }
+    }
+    // the open row is closed on this date:  returns span the dates 
+    // between the kept dates, from the quote of each series on (or, 
+    // ffill, before) either date;  ahead holds the quote of each
+    // series on or before this date
+    bool keep = MISSING_DROP!=policy || count==np;
+    if(keep && pending)
+    {
+      size_t nmissing = 0;
+      bool complete = true;
+      for(int sIdx=0; sIdx<np && complete; sIdx++)
+      {
+        const DoubleColumn& close = series[sIdx]->getClose();
+        size_t p = previous[sIdx];
+        size_t q = ahead[sIdx];
+        switch(policy)
+        {
+          case MISSING_DROP:
+            panel(rows, sIdx) = (close[p]-close[q])/close[q];
+            break;
+          case MISSING_FFILL:
+            // without a quote on or before this date, every older 
+            // date is incomplete too
+            if(none==q)
+            {
+              complete = false;
+              done = true;
+            } else {
+              panel(rows, sIdx) = (close[p]-close[q])/close[q];
+            }
+            break;
+          case MISSING_PAIRWISE:
+            if(quoted[sIdx] && present[sIdx])
+            {
+              panel(rows, sIdx) = (close[p]-close[q])/close[q];
+            } else {
+              panel(rows, sIdx) = numeric_limits<double>::quiet_NaN();
+              nmissing++;
+            }
+            break;
+        }
+      }
+      // a row without any return is not kept
+      if(complete && nmissing<static_cast<size_t>(np))
+      {
+        dates.push_back(opened);
+        missing += nmissing;
+        rows++;
+      }
+    }
+    if(keep)
+    {
+      pending = true;
+      opened = date;
+      previous = ahead;
+      quoted = present;
+    }
+    for(int sIdx=0; sIdx<np; sIdx++)
+    {
+      if(!present[sIdx]) continue;
+      ahead[sIdx] = ahead[sIdx]+1<series[sIdx]->getDate().size() ? ahead[sIdx]+1 : none;
+      present[sIdx] = 0;
+    }
+    // without every series, there are no more common dates
+    if(MISSING_DROP==policy && heap.size()<static_cast<size_t>(np)) done = true;
+  }
+  x.set_size(rows, np);
+  for(int sIdx=0; sIdx<np; sIdx++)
+  {
+    if(rows>0) memcpy(x.colptr(sIdx), panel.colptr(sIdx), rows*sizeof(double));
+  }
+}
+
+MissingData Alignment::parsePolicy(const string& name)
+{
+  if(boost::algorithm::iequals(name, "drop")) return MISSING_DROP;
+  if(boost::algorithm::iequals(name, "ffill")) return MISSING_FFILL;
+  if(boost::algorithm::iequals(name, "pairwise")) return MISSING_PAIRWISE;
+  throw runtime_error("Unknown missing data policy: "+name);
+}
+
+const char* Alignment::getPolicyName(MissingData policy)
+{
+  switch(policy)
+  {
+    case MISSING_DROP:     return "drop";
+    case MISSING_FFILL:    return "ffill";
+    case MISSING_PAIRWISE: return "pairwise";
+  }
+  return "unknown";
+}
+
+// *EOF*
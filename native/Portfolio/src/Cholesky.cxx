@@ -0,0 +1,83 @@
+// Cholesky.cxx
+// Mac Radigan
+
+#include "Cholesky.hxx"
+#include <stdexcept>
+
+USING_QUANT
+using namespace std;
+
+const double Cholesky::RIDGE_START = 1e-12;
+const double Cholesky::RIDGE_LIMIT = 1e-2;
+
+Cholesky::Cholesky() 
+  : ridge(0)
+{
+}
+
+Cholesky::Cholesky(const mat& s) 
+  : ridge(0)
+{
+  factor(s);
+}
+
+Cholesky::~Cholesky() 
+{
+}
+
+void Cholesky::factor(const mat& s) 
+{
+  ridge = 0;
+  if(s.n_rows!=s.n_cols) throw runtime_error("Cholesky factorization requires a square matrix.");
+  if(chol(r, s)) return;
+  // singular:  regularize with a growing ridge on the diagonal
+  int n = s.n_rows;
+  double scale = 0;
+  for(int idx=0; idx<n; idx++) scale += s(idx,idx);
+  scale = n>0 && scale>0 ? scale/n : 1.0;
+  mat sr = s;
+  for(double k=RIDGE_START; k<=RIDGE_LIMIT; k*=10) 
+  {
+    ridge = k*scale;
+    for(int idx=0; idx<n; idx++) sr(idx,idx) = s(idx,idx)+ridge;
+    if(chol(r, sr)) return;
+  }
+  throw runtime_error("Covariance matrix is not positive semidefinite.");
+}
+
+mat Cholesky::solve(const mat& v) const 
+{
+  // S*x = v  -->  R'*(R*x) = v, two triangular solves
+  mat y = arma::solve(trimatl(r.t()), v);
+  return arma::solve(trimatu(r), y);
+}
+
+void Cholesky::solve(const mat& v, mat& x) const 
+{
+  // forward and back substitution into x, without temporaries
+  int n = r.n_rows;
+  int m = v.n_cols;
+  x.set_size(n, m);
+  for(int c=0; c<m; c++) 
+  {
+    const double* b = v.colptr(c);
+    double* y = x.colptr(c);
+    // R'*y = b
+    for(int i=0; i<n; i++) 
+    {
+      const double* ri = r.colptr(i);
+      double sum = b[i];
+      for(int k=0; k<i; k++) sum -= ri[k]*y[k];
+      y[i] = sum/ri[i];
+    }
+    // R*x = y
+    for(int i=n-1; i>=0; i--) 
+    {
+      double sum = y[i];
+      for(int k=i+1; k<n; k++) sum -= r(i,k)*y[k];
+      y[i] = sum/r(i,i);
+    }
+  }
+}
+
+// *EOF*
@@ -0,0 +1,127 @@
+// FactorModel.cxx
+// Mac Radigan
+
+#include "FactorModel.hxx"
+#include <stdexcept>
+#include <algorithm>
+
+USING_QUANT
+using namespace std;
+
+const double FactorModel::SPECIFIC_FLOOR = 1e-6;
+
+FactorModel::FactorModel() 
+{
+}
+
+FactorModel::~FactorModel() 
+{
+}
+
+void FactorModel::estimate(const mat& x, int nfactors) 
+{
+  int ns = x.n_rows;   // number of samples
+  int np = x.n_cols;   // number of stocks
+  if(ns<2) throw runtime_error("Factor model requires at least two samples.");
+  if(nfactors<1) throw runtime_error("Factor model requires at least one factor.");
+  // centered returns
+  mat xc = x;
+  for(int c=0; c<np; c++) 
+  {
+    double* p = xc.colptr(c);
+    double m = 0;
+    for(int r=0; r<ns; r++) m += p[r];
+    m /= ns;
+    for(int r=0; r<ns; r++) p[r] -= m;
+  }
+  //
+  // principal components of the sample covariance, from the SVD of
+  // the centered returns (only the right singular vectors are needed):
+  //
+  //   xc = U*diag(s)*V'   -->   cov(x) = V*diag(s.^2/(M-1))*V'
+  //
+  mat u;
+  vec s;
+  mat v;
+  if(!svd_econ(u, s, v, xc, "right")) 
+  {
+    throw runtime_error("Factor model decomposition failed.");
+  }
+  int nk = min(nfactors, static_cast<int>(s.n_elem));
+  double norm = 1.0/sqrt(static_cast<double>(ns-1));
+  loadings.set_size(np, nk);
+  for(int k=0; k<nk; k++) 
+  {
+    double scale = s[k]*norm;
+    for(int r=0; r<np; r++) loadings(r,k) = v(r,k)*scale;
+  }
+  // specific variance:  total variance not explained by the factors
+  specific.set_size(np);
+  for(int r=0; r<np; r++) 
+  {
+    const double* p = xc.colptr(r);
+    double total = 0;
+    for(int t=0; t<ns; t++) total += p[t]*p[t];
+    total /= ns-1;
+    double common = 0;
+    for(int k=0; k<nk; k++) common += loadings(r,k)*loadings(r,k);
+    specific[r] = max(total-common, SPECIFIC_FLOOR*total);
+  }
+  //
+  // Woodbury identity:
+  //
+  //   (B*B' + D)^-1 = D^-1 - D^-1*B*(I + B'*D^-1*B)^-1*B'*D^-1
+  //
+  scaled.set_size(np, nk);
+  for(int k=0; k<nk; k++) 
+  {
+    for(int r=0; r<np; r++) scaled(r,k) = loadings(r,k)/specific[r];
+  }
+  capacitance = loadings.t()*scaled;
+  for(int k=0; k<nk; k++) capacitance(k,k) += 1.0;
+}
+
+mat FactorModel::multiply(const mat& v) const 
+{
+  // S*v = B*(B'*v) + D*v
+  mat y = loadings*(loadings.t()*v);
+  for(unsigned c=0; c<v.n_cols; c++) 
+  {
+    for(unsigned r=0; r<v.n_rows; r++) y(r,c) += specific[r]*v(r,c);
+  }
+  return y;
+}
+
+mat FactorModel::solve(const mat& v) const 
+{
+  // S^-1*v = D^-1*v - D^-1*B*(I + B'*D^-1*B)^-1*(B'*D^-1*v)
+  mat t = arma::solve(capacitance, scaled.t()*v);
+  mat y = -(scaled*t);
+  for(unsigned c=0; c<v.n_cols; c++) 
+  {
+    for(unsigned r=0; r<v.n_rows; r++) y(r,c) += v(r,c)/specific[r];
+  }
+  return y;
+}
+
+mat FactorModel::getVariance() const 
+{
+  int np = loadings.n_rows;
+  mat var(1, np);
+  for(int r=0; r<np; r++) 
+  {
+    double common = 0;
+    for(unsigned k=0; k<loadings.n_cols; k++) common += loadings(r,k)*loadings(r,k);
+    var(0,r) = common + specific[r];
+  }
+  return var;
+}
+
+mat FactorModel::getCovariance() const 
+{
+  mat cov = loadings*loadings.t();
+  for(unsigned r=0; r<specific.n_elem; r++) cov(r,r) += specific[r];
+  return cov;
+}
+
+// *EOF*
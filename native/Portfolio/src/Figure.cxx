@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
 #include <math.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -35,12 +36,14 @@ Figure::~Figure() {
 void Figure::initialize() {
   pause = 0.0;
   name = "default";
-  gpin = popen("gnuplot","w");
+  // the gnuplot session is opened on first use, figures rendered
+  // through a Renderer never open one
+  gpin = NULL;
   reset();
 }
 
 void Figure::dispose() {
-  pclose(gpin);
+  if(NULL!=gpin) pclose(gpin);
 }
 
 void Figure::reset() {
@@ -66,19 +69,39 @@ const double* const Figure::getOrdinalRange(TMatrixD& mat) {
    return dvalue;
 }
 
-void Figure::show() {
-  fprintf(gpin, "set terminal %s\n", terminal.c_str());
-  if(!output.empty()) {
-    fprintf(gpin, "set output %s\n", output.c_str());
+string Figure::getCommands(const string& filename) const {
+  stringstream commands;
+  // sessions are shared between figures, start from a clean state
+  commands << "reset" << endl;
+  if(filename.empty()) {
+    commands << "set terminal " << terminal << endl;
+    if(!output.empty()) {
+      commands << "set output " << output << endl;
+    } else {
+      commands << "set output" << endl;
+    }
+  } else {
+    commands << "set terminal " << getTerminal(filename) << endl;
+    commands << "set output \"" << filename << "\"" << endl;
   }
-  fprintf(gpin, "set title \"%s\"\n", title.c_str());
-  fprintf(gpin, "set xlabel \"%s\"\n", xlabel.c_str());
-  fprintf(gpin, "set ylabel \"%s\"\n", ylabel.c_str());
-  fprintf(gpin, "%s\n", script.str().c_str());
+  commands << "set title \"" << title << "\"" << endl;
+  commands << "set xlabel \"" << xlabel << "\"" << endl;
+  commands << "set ylabel \"" << ylabel << "\"" << endl;
+  commands << script.str() << endl;
+  if(pause>0.0) {
+    commands << "pause(" << pause << ")" << endl;
+  }
+  // close the output file, so the session may render the next figure
+  commands << "set output" << endl;
+  return commands.str();
+}
+
+void Figure::show() {
+  if(NULL==gpin) gpin = popen("gnuplot","w");
   if(pause>0.0) {
      cerr << "pause " << pause << " seconds" << endl;
-     fprintf(gpin, "pause(%g)\n", pause);
   }
+  fputs(getCommands("").c_str(), gpin);
   fflush(gpin);
 }
 
@@ -87,6 +110,17 @@ void Figure::plotPortfolio(vector<std::string>& symbols,
                            vector<double>& std,
                            double roi_opt,
                            double std_opt) {
+  plotPortfolio(symbols, roi, std, roi_opt, std_opt, 
+                vector<double>(), vector<double>());
+}
+
+void Figure::plotPortfolio(vector<std::string>& symbols, 
+                           vector<double>& roi, 
+                           vector<double>& std,
+                           double roi_opt,
+                           double std_opt,
+                           const vector<double>& frontier_roi,
+                           const vector<double>& frontier_std) {
   script << "set datafile separator ','" << endl;
   script << "set multiplot" << endl;
   script << "set xlabel '% Risk (annualized)' offset 1" << endl;
@@ -95,6 +129,7 @@ void Figure::plotPortfolio(vector<std::string>& symbols,
   script << "set pointsize 2.5" << endl;
   script << "set style line 1 lc rgb '#00FF00' pt 9 # red triangle" << endl;
   script << "set style line 2 lc rgb '#FF0000' pt 9 # green triangle" << endl;
+  script << "set style line 3 lc rgb '#0000FF' lw 1.5 # blue line" << endl;
   script << "set yrange [0:40]" << endl;
   script << "set xrange [0:40]" << endl;
   //script << "set grid" << endl;
@@ -102,8 +137,15 @@ void Figure::plotPortfolio(vector<std::string>& symbols,
   script << "set rmargin 2" << endl;
   script << "set multiplot" << endl;
   script << "set key off" << endl;
+  if(!frontier_roi.empty()) {
+    // efficient frontier
+    script << "plot '-' w l ls 3" << endl;
+    for(int fIdx=0; fIdx<frontier_roi.size(); fIdx++) {
+      script << frontier_std.at(fIdx) << "," << frontier_roi.at(fIdx) << endl;
+    }
+    script << "e" << endl;
+  }
   script << "plot '-' w p ls 2" << endl;
-  typedef vector<string> formats_vector;
   for(int sIdx=0; sIdx<symbols.size(); sIdx++) {
     script << std.at(sIdx) << "," << roi.at(sIdx) << endl;
   }
@@ -123,12 +165,14 @@ void Figure::plotPortfolio(vector<std::string>& symbols,
   script << "unset multiplot" << endl;
 }
 
-void Figure::plotCandle(Series& series, const int nsamples) {
-  vector<double> high = series.getHigh();
-  vector<double> low  = series.getLow();
+void Figure::plotCandle(const Series& series, const int nsamples) {
+  const DoubleColumn& high = series.getHigh();
+  const DoubleColumn& low  = series.getLow();
+  // a short history is plotted in full
+  const int length = min<int>(nsamples, series.getDate().size());
   double minPrice = numeric_limits<double>::max();
   double maxPrice = numeric_limits<double>::min();
-  for(int idx=1; idx<nsamples; idx++) {
+  for(int idx=1; idx<length; idx++) {
     if(low.at(idx)<minPrice) minPrice = low.at(idx);
     if(high.at(idx)>maxPrice) maxPrice = high.at(idx);
   }
@@ -159,11 +203,11 @@ void Figure::plotCandle(Series& series, const int nsamples) {
          << ", "
          << "'-' every ::2 using 1:($5>$2?$2:1/0):($5>$2?$3:1/0):($5>$2?$4:1/0):($5>$2?$5:1/0) notitle with candlesticks lt rgb '#FF0000'" 
          << endl;
-  script << series.getAsCsv(nsamples);
+  script << series.getAsCsv(length);
   script << "e" << endl;
 #else
   script << "plot '-' using 1:2:3:4:5 notitle with candlesticks" << endl;
-  script << series.getAsCsv(nsamples);
+  script << series.getAsCsv(length);
   script << "e" << endl;
 #endif
   script << "unset title" << endl;
@@ -175,61 +219,56 @@ void Figure::plotCandle(Series& series, const int nsamples) {
   script << "set format y '%1.0f'" << endl;
   script << "set ylabel 'volume (x 1k)' offset 1" << endl;
   script << "plot '-' using 1:($6/10000) notitle with impulses lt 3" << endl;
-  script << series.getAsCsv(nsamples);
+  script << series.getAsCsv(length);
   script << "e" << endl;
   script << "unset multiplot" << endl;
 }
 
+string Figure::getTerminal(const string& filename) {
+  string ext = path(path(filename).extension()).string();
+  if(!ext.compare(".ps")) {
+    return "postscript enhanced color portrait";
+  } else if(!ext.compare(".eps")) {
+    return "postscript eps enhanced color dashed";
+  } else if(!ext.compare(".png")) {
+    return "png";
+  } else if(!ext.compare(".tif")) {
+    return "tiff";
+  } else if(!ext.compare(".jpg")) {
+    return "jpeg";
+  } else if(!ext.compare(".pdf")) {
+    return "pdf";
+  }
+  throw runtime_error("Unsupported output file extension.");
+}
+
+void Figure::saveScript(string filename) const {
+  std::ofstream fout;
+  fout.open(filename.c_str());
+  saveScript(fout);
+  fout.close();
+}
+
+void Figure::saveScript(std::ostream& fout) const {
+  fout << "#!/usr/bin/env gnuplot" << endl;
+  fout << "set terminal X11 persist" << endl;
+  fout << "#set output \"" << output.c_str() << "\"" << endl;
+  fout << "set title \"" << title.c_str() << "\"" << endl;
+  fout << "set xlabel \"" << xlabel.c_str() << "\"" << endl;
+  fout << "set ylabel \"" << ylabel.c_str() << "\"" << endl;
+  fout << script.str().c_str() << endl;
+}
+
 void Figure::save(string filename) {
-  path file(filename);
-  string dir = path(file.parent_path()).string();
-  string ext = path(file.extension()).string();
-  //if(!exists(dir)) {
-  //  cerr << "mkdir> " << dir << endl;
-  //  mkdir(dir.c_str(), PERM_DIRECTORY);
-  //}
+  string ext = path(path(filename).extension()).string();
   if(!ext.compare(".gnuplot")) {
-    //cerr << "output type set to gnuplot" << endl;
-    ofstream fout;
-    fout.open(filename.c_str());
-    fout << "#!/usr/bin/env gnuplot" << endl;
-    fout << "set terminal X11 persist" << endl;
-    fout << "#set output \"" << output.c_str() << "\"" << endl;
-    fout << "set title \"" << title.c_str() << "\"" << endl;
-    fout << "set xlabel \"" << xlabel.c_str() << "\"" << endl;
-    fout << "set ylabel \"" << ylabel.c_str() << "\"" << endl;
-    fout << script.str().c_str() << endl;
-    fout.close();
+    saveScript(filename);
   } else {
-    string tempTerminal = terminal;
-    string tempOutput = output;
-    if(!ext.compare(".ps")) {
-      //cerr << "output type set to postscript" << endl;
-      setTerminal("postscript enhanced color portrait");
-    } else if(!ext.compare(".eps")) {
-      //cerr << "output type set to postscript enhanced color" << endl;
-      setTerminal("postscript eps enhanced color dashed");
-    } else if(!ext.compare(".png")) {
-      //cerr << "output type set to portable networks graphics" << endl;
-      setTerminal("png");
-    } else if(!ext.compare(".tif")) {
-      //cerr << "output type set to tagged image format" << endl;
-      setTerminal("tiff");
-    } else if(!ext.compare(".jpg")) {
-      //cerr << "output type set to joint photographic experts group" << endl;
-      setTerminal("jpeg");
-    } else if(!ext.compare(".pdf")) {
-      //cerr << "output type set to portable document format" << endl;
-      setTerminal("pdf");
-    } else {
-      throw runtime_error("Unsupported output file extension.");
-    }
-    string newOutput = "\"" + filename + "\"";
-    setOutput(newOutput.c_str());
+    string commands = getCommands(filename);
     cerr << "save> " << filename << endl;
-    show();
-    setTerminal(tempTerminal.c_str());
-    setOutput(tempOutput.c_str());
+    if(NULL==gpin) gpin = popen("gnuplot","w");
+    fputs(commands.c_str(), gpin);
+    fflush(gpin);
   }
 }
 
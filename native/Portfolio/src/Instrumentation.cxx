@@ -0,0 +1,104 @@
+// Instrumentation.cxx
+// Mac Radigan
+
+#include "Instrumentation.hxx"
+#include <sstream>
+#include <iomanip>
+
+USING_QUANT
+using namespace std;
+
+Metric::Metric(const string& name, Kind kind)
+  : name(name), kind(kind), count(0), total(0), largest(0)
+{
+}
+
+void Metric::reset()
+{
+  count.store(0, memory_order_relaxed);
+  total.store(0, memory_order_relaxed);
+  largest.store(0, memory_order_relaxed);
+}
+
+Instrumentation::metric_map& Instrumentation::getRegistry(unique_lock<mutex>& guard)
+{
+  static mutex* lock = new mutex();
+  static metric_map* metrics = new metric_map();
+  guard = unique_lock<mutex>(*lock);
+  return *metrics;
+}
+
+bool Instrumentation::isEnabled()
+{
+#ifdef QUANT_INSTRUMENT
+  return true;
+#else
+  return false;
+#endif
+}
+
+Metric* Instrumentation::get(const string& name, Metric::Kind kind)
+{
+  unique_lock<mutex> guard;
+  metric_map& metrics = getRegistry(guard);
+  unique_ptr<Metric>& metric = metrics[name];
+  if(!metric) metric.reset(new Metric(name, kind));
+  return metric.get();
+}
+
+vector<const Metric*> Instrumentation::getMetrics()
+{
+  unique_lock<mutex> guard;
+  metric_map& metrics = getRegistry(guard);
+  vector<const Metric*> result;
+  for(metric_map::const_iterator it=metrics.begin(); it!=metrics.end(); ++it)
+  {
+    result.push_back(it->second.get());
+  }
+  return result;
+}
+
+void Instrumentation::reset()
+{
+  unique_lock<mutex> guard;
+  metric_map& metrics = getRegistry(guard);
+  for(metric_map::iterator it=metrics.begin(); it!=metrics.end(); ++it)
+  {
+    it->second->reset();
+  }
+}
+
+string Instrumentation::toJson()
+{
+  // metric names are identifiers and file extensions, no escaping needed
+  vector<const Metric*> metrics = getMetrics();
+  stringstream timers;
+  stringstream counters;
+  timers << setprecision(9);
+  for(size_t idx=0; idx<metrics.size(); idx++)
+  {
+    const Metric* m = metrics[idx];
+    if(0==m->getCount()) continue;
+    if(Metric::TIMER==m->getKind())
+    {
+      timers << (timers.tellp()>0 ? ",\n    " : "\n    ")
+             << "\"" << m->getName() << "\": {\"count\": " << m->getCount()
+             << ", \"total_s\": " << m->getTotal()*1e-9
+             << ", \"max_s\": " << m->getMax()*1e-9 << "}";
+    } else {
+      counters << (counters.tellp()>0 ? ",\n    " : "\n    ")
+               << "\"" << m->getName() << "\": {\"count\": " << m->getCount()
+               << ", \"total\": " << m->getTotal()
+               << ", \"max\": " << m->getMax() << "}";
+    }
+  }
+  stringstream json;
+  json << "{\n"
+       << "  \"enabled\": " << (isEnabled() ? "true" : "false") << ",\n"
+       << "  \"timers\": {" << timers.str() << (timers.tellp()>0 ? "\n  " : "") << "},\n"
+       << "  \"counters\": {" << counters.str() << (counters.tellp()>0 ? "\n  " : "") << "}\n"
+       << "}\n";
+  return json.str();
+}
+
+// *EOF*
@@ -0,0 +1,664 @@
+// Kernels.cxx
+// Mac Radigan
+
+#include "Kernels.hxx"
+#include <math.h>
+#include <string.h>
+
+#if !defined(QUANT_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUANT_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+USING_QUANT
+
+namespace {
+
+// rolling statistics are accumulated a block at a time
+const size_t BLOCK = 256;
+// moments are accumulated over blocks of rows, so that a block of
+// every column stays in cache while the upper triangle is swept
+const size_t ROWS = 128;
+
+typedef void (*ReturnsKernel)(const double*, size_t, double*);
+typedef void (*RollingKernel)(const double*, size_t, size_t, double*);
+typedef void (*MomentsKernel)(const double*, size_t, size_t, double*, double*, double*);
+typedef void (*RateKernel)(const double*, size_t, double, double*);
+
+struct KernelTable
+{
+  const char*   isa;
+  ReturnsKernel simpleReturns;
+  ReturnsKernel logReturns;
+  RollingKernel rollingMean;
+  RollingKernel rollingVolatility;
+  MomentsKernel moments;
+  RateKernel    annualizeRate;
+  RateKernel    dailyRate;
+};
+
+//
+// scalar reference implementations
+//
+
+void simpleReturnsScalar(const double* c, size_t nc, double* r)
+{
+  for(size_t idx=0; idx+1<nc; idx++)
+  {
+    r[idx] = (c[idx]-c[idx+1])/c[idx+1];
+  }
+}
+
+void logReturnsScalar(const double* c, size_t nc, double* r)
+{
+  for(size_t idx=0; idx+1<nc; idx++)
+  {
+    r[idx] = log(c[idx]/c[idx+1]);
+  }
+}
+
+//
+// rolling sums slide from the oldest window to the newest:
+//
+//   s[n] = s[n+1] + (x[n]-k) - (x[n+w]-k)
+//   q[n] = q[n+1] + (x[n]-k)^2 - (x[n+w]-k)^2
+//
+// the shift k (a sample of the window) keeps the variance from
+// cancelling catastrophically when the mean is large (prices);
+// the sums are recomputed exactly every span bars to bound drift
+//
+inline size_t span(size_t w)
+{
+  return w>BLOCK ? w : BLOCK;
+}
+
+// exact sums of the window x[n..n+w-1]
+inline void seed(const double* x, size_t n, size_t w, double& k, double& s, double& q)
+{
+  k = x[n];
+  s = 0;
+  q = 0;
+  for(size_t idx=n; idx<n+w; idx++)
+  {
+    double d = x[idx]-k;
+    s += d;
+    q += d*d;
+  }
+}
+
+inline double volatility(double s, double q, size_t w)
+{
+  double v = (q-s*s/w)/(w-1);
+  return v>0 ? sqrt(v) : 0;
+}
+
+void rollingMeanScalar(const double* x, size_t nx, size_t w, double* y)
+{
+  if(w<1 || nx<w) return;
+  // outputs [lo,hi), newest first
+  for(size_t hi=nx-w+1; hi>0; )
+  {
+    size_t lo = hi>span(w) ? hi-span(w) : 0;
+    double k, s, q;
+    seed(x, hi-1, w, k, s, q);
+    y[hi-1] = k+s/w;
+    for(size_t idx=hi-1; idx-->lo; )
+    {
+      s += (x[idx]-k)-(x[idx+w]-k);
+      y[idx] = k+s/w;
+    }
+    hi = lo;
+  }
+}
+
+void rollingVolatilityScalar(const double* x, size_t nx, size_t w, double* y)
+{
+  if(w<2 || nx<w) return;
+  for(size_t hi=nx-w+1; hi>0; )
+  {
+    size_t lo = hi>span(w) ? hi-span(w) : 0;
+    double k, s, q;
+    seed(x, hi-1, w, k, s, q);
+    y[hi-1] = volatility(s, q, w);
+    for(size_t idx=hi-1; idx-->lo; )
+    {
+      double a = x[idx]-k;
+      double b = x[idx+w]-k;
+      s += a-b;
+      q += a*a-b*b;
+      y[idx] = volatility(s, q, w);
+    }
+    hi = lo;
+  }
+}
+
+//
+// moments are accumulated about a shift k (the first sample of each 
+// column), which keeps the single sweep as accurate as two passes:
+//
+//   s[i]   = sum (x[t,i]-k[i])
+//   c[i,j] = sum (x[t,i]-k[i])*(x[t,j]-k[j]),   i <= j
+//
+//   mean[i]  = k[i] + s[i]/ns
+//   cov[i,j] = (c[i,j] - s[i]*s[j]/ns)/(ns-1)
+//
+inline void finishMoments(const double* x, size_t ns, size_t np,
+                          double* mean, double* cov, double* vol)
+{
+  for(size_t j=0; j<np; j++)
+  {
+    for(size_t i=0; i<=j; i++)
+    {
+      double c = ns>1 ? (cov[i+j*np]-mean[i]*mean[j]/ns)/(ns-1) : 0;
+      cov[i+j*np] = c;
+      cov[j+i*np] = c;
+    }
+  }
+  for(size_t j=0; j<np; j++)
+  {
+    mean[j] = x[j*ns] + mean[j]/ns;
+    vol[j] = cov[j+j*np]>0 ? sqrt(cov[j+j*np]) : 0;
+  }
+}
+
+void momentsScalar(const double* x, size_t ns, size_t np,
+                   double* mean, double* cov, double* vol)
+{
+  memset(mean, 0, np*sizeof(double));
+  memset(cov, 0, np*np*sizeof(double));
+  if(0==ns) { memset(vol, 0, np*sizeof(double)); return; }
+  for(size_t t0=0; t0<ns; t0+=ROWS)
+  {
+    size_t t1 = t0+ROWS<ns ? t0+ROWS : ns;
+    for(size_t j=0; j<np; j++)
+    {
+      const double* xj = x+j*ns;
+      double kj = xj[0];
+      double s = 0;
+      for(size_t t=t0; t<t1; t++) s += xj[t]-kj;
+      mean[j] += s;
+      for(size_t i=0; i<=j; i++)
+      {
+        const double* xi = x+i*ns;
+        double ki = xi[0];
+        double c = 0;
+        for(size_t t=t0; t<t1; t++) c += (xi[t]-ki)*(xj[t]-kj);
+        cov[i+j*np] += c;
+      }
+    }
+  }
+  finishMoments(x, ns, np, mean, cov, vol);
+}
+
+void annualizeRateScalar(const double* x, size_t n, double t, double* y)
+{
+  for(size_t idx=0; idx<n; idx++)
+  {
+    y[idx] = expm1(t*log1p(x[idx]))*100.0;
+  }
+}
+
+void dailyRateScalar(const double* x, size_t n, double t, double* y)
+{
+  for(size_t idx=0; idx<n; idx++)
+  {
+    y[idx] = expm1(log1p(x[idx]/100.0)/t);
+  }
+}
+
+const KernelTable SCALAR = {
+  "scalar",
+  simpleReturnsScalar, logReturnsScalar,
+  rollingMeanScalar, rollingVolatilityScalar,
+  momentsScalar, annualizeRateScalar, dailyRateScalar
+};
+
+#ifdef QUANT_HAVE_AVX2
+
+//
+// AVX2 implementations:  4 bars per instruction, unaligned loads
+// (c[n+1] is never aligned when c[n] is), scalar tails
+//
+
+__attribute__((target("avx2")))
+void simpleReturnsAvx2(const double* c, size_t nc, double* r)
+{
+  if(nc<2) return;
+  size_t n = nc-1;
+  size_t idx = 0;
+  for(; idx+4<=n; idx+=4)
+  {
+    __m256d a = _mm256_loadu_pd(c+idx);
+    __m256d b = _mm256_loadu_pd(c+idx+1);
+    _mm256_storeu_pd(r+idx, _mm256_div_pd(_mm256_sub_pd(a,b), b));
+  }
+  for(; idx<n; idx++)
+  {
+    r[idx] = (c[idx]-c[idx+1])/c[idx+1];
+  }
+}
+
+__attribute__((target("avx2")))
+void logReturnsAvx2(const double* c, size_t nc, double* r)
+{
+  if(nc<2) return;
+  size_t n = nc-1;
+  size_t idx = 0;
+  // price relatives in vector, then the logarithm in place
+  for(; idx+4<=n; idx+=4)
+  {
+    __m256d a = _mm256_loadu_pd(c+idx);
+    __m256d b = _mm256_loadu_pd(c+idx+1);
+    _mm256_storeu_pd(r+idx, _mm256_div_pd(a, b));
+  }
+  for(; idx<n; idx++)
+  {
+    r[idx] = c[idx]/c[idx+1];
+  }
+  for(idx=0; idx<n; idx++)
+  {
+    r[idx] = log(r[idx]);
+  }
+}
+
+//
+// the rolling kernels compute the per-bar updates of the sums 
+// in vector, accumulate them in order, and finish in vector;
+// the sums are seeded exactly as in the scalar kernels
+//
+__attribute__((target("avx2")))
+void updatesAvx2(const double* x, size_t w, double k, size_t lo, size_t n,
+                 double* ds, double* dq)
+{
+  // ds[i] = (x[lo+i]-k)-(x[lo+i+w]-k),  dq[i] = (x[lo+i]-k)^2-(x[lo+i+w]-k)^2
+  __m256d vk = _mm256_set1_pd(k);
+  size_t idx = 0;
+  for(; idx+4<=n; idx+=4)
+  {
+    __m256d a = _mm256_sub_pd(_mm256_loadu_pd(x+lo+idx), vk);
+    __m256d b = _mm256_sub_pd(_mm256_loadu_pd(x+lo+idx+w), vk);
+    _mm256_storeu_pd(ds+idx, _mm256_sub_pd(a,b));
+    if(NULL!=dq)
+    {
+      _mm256_storeu_pd(dq+idx, _mm256_sub_pd(_mm256_mul_pd(a,a), _mm256_mul_pd(b,b)));
+    }
+  }
+  for(; idx<n; idx++)
+  {
+    double a = x[lo+idx]-k;
+    double b = x[lo+idx+w]-k;
+    ds[idx] = a-b;
+    if(NULL!=dq) dq[idx] = a*a-b*b;
+  }
+}
+
+__attribute__((target("avx2")))
+void rollingMeanAvx2(const double* x, size_t nx, size_t w, double* y)
+{
+  if(w<1 || nx<w) return;
+  double ds[BLOCK];
+  for(size_t top=nx-w+1; top>0; )
+  {
+    size_t bottom = top>span(w) ? top-span(w) : 0;
+    double k, s, q;
+    seed(x, top-1, w, k, s, q);
+    y[top-1] = k+s/w;
+    __m256d vk = _mm256_set1_pd(k);
+    __m256d vw = _mm256_set1_pd(static_cast<double>(w));
+    // outputs [bottom,top-1) a block at a time
+    for(size_t hi=top-1; hi>bottom; )
+    {
+      size_t lo = hi-bottom>BLOCK ? hi-BLOCK : bottom;
+      size_t n = hi-lo;
+      updatesAvx2(x, w, k, lo, n, ds, NULL);
+      for(size_t idx=n; idx-->0; )
+      {
+        s += ds[idx];
+        y[lo+idx] = s;
+      }
+      size_t idx = 0;
+      for(; idx+4<=n; idx+=4)
+      {
+        __m256d vs = _mm256_loadu_pd(y+lo+idx);
+        _mm256_storeu_pd(y+lo+idx, _mm256_add_pd(vk, _mm256_div_pd(vs, vw)));
+      }
+      for(; idx<n; idx++) y[lo+idx] = k+y[lo+idx]/w;
+      hi = lo;
+    }
+    top = bottom;
+  }
+}
+
+__attribute__((target("avx2")))
+void rollingVolatilityAvx2(const double* x, size_t nx, size_t w, double* y)
+{
+  if(w<2 || nx<w) return;
+  double ds[BLOCK];
+  double dq[BLOCK];
+  double ys[BLOCK];
+  __m256d vw  = _mm256_set1_pd(static_cast<double>(w));
+  __m256d vw1 = _mm256_set1_pd(static_cast<double>(w-1));
+  __m256d zero = _mm256_setzero_pd();
+  for(size_t top=nx-w+1; top>0; )
+  {
+    size_t bottom = top>span(w) ? top-span(w) : 0;
+    double k, s, q;
+    seed(x, top-1, w, k, s, q);
+    y[top-1] = volatility(s, q, w);
+    for(size_t hi=top-1; hi>bottom; )
+    {
+      size_t lo = hi-bottom>BLOCK ? hi-BLOCK : bottom;
+      size_t n = hi-lo;
+      updatesAvx2(x, w, k, lo, n, ds, dq);
+      for(size_t idx=n; idx-->0; )
+      {
+        s += ds[idx];
+        q += dq[idx];
+        ys[idx] = s;
+        y[lo+idx] = q;
+      }
+      size_t idx = 0;
+      for(; idx+4<=n; idx+=4)
+      {
+        __m256d vs = _mm256_loadu_pd(ys+idx);
+        __m256d vq = _mm256_loadu_pd(y+lo+idx);
+        __m256d v = _mm256_div_pd(_mm256_sub_pd(vq, _mm256_div_pd(_mm256_mul_pd(vs,vs), vw)), vw1);
+        _mm256_storeu_pd(y+lo+idx, _mm256_sqrt_pd(_mm256_max_pd(v, zero)));
+      }
+      for(; idx<n; idx++) y[lo+idx] = volatility(ys[idx], y[lo+idx], w);
+      hi = lo;
+    }
+    top = bottom;
+  }
+}
+
+__attribute__((target("avx2")))
+inline double sum(__m256d v)
+{
+  __m128d lo = _mm256_castpd256_pd128(v);
+  __m128d hi = _mm256_extractf128_pd(v, 1);
+  lo = _mm_add_pd(lo, hi);
+  return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2")))
+void momentsAvx2(const double* x, size_t ns, size_t np,
+                 double* mean, double* cov, double* vol)
+{
+  memset(mean, 0, np*sizeof(double));
+  memset(cov, 0, np*np*sizeof(double));
+  if(0==ns) { memset(vol, 0, np*sizeof(double)); return; }
+  for(size_t t0=0; t0<ns; t0+=ROWS)
+  {
+    size_t t1 = t0+ROWS<ns ? t0+ROWS : ns;
+    size_t tv = t0+((t1-t0)&~size_t(3));   // end of the vector rows
+    for(size_t j=0; j<np; j++)
+    {
+      const double* xj = x+j*ns;
+      __m256d kj = _mm256_set1_pd(xj[0]);
+      __m256d vs = _mm256_setzero_pd();
+      for(size_t t=t0; t<tv; t+=4)
+      {
+        vs = _mm256_add_pd(vs, _mm256_sub_pd(_mm256_loadu_pd(xj+t), kj));
+      }
+      double s = sum(vs);
+      for(size_t t=tv; t<t1; t++) s += xj[t]-xj[0];
+      mean[j] += s;
+      // four columns i..i+3 against column j, sharing the loads of j
+      size_t i = 0;
+      for(; i+4<=j+1; i+=4)
+      {
+        const double* x0 = x+i*ns;
+        const double* x1 = x0+ns;
+        const double* x2 = x1+ns;
+        const double* x3 = x2+ns;
+        __m256d k0 = _mm256_set1_pd(x0[0]);
+        __m256d k1 = _mm256_set1_pd(x1[0]);
+        __m256d k2 = _mm256_set1_pd(x2[0]);
+        __m256d k3 = _mm256_set1_pd(x3[0]);
+        __m256d c0 = _mm256_setzero_pd();
+        __m256d c1 = _mm256_setzero_pd();
+        __m256d c2 = _mm256_setzero_pd();
+        __m256d c3 = _mm256_setzero_pd();
+        for(size_t t=t0; t<tv; t+=4)
+        {
+          __m256d dj = _mm256_sub_pd(_mm256_loadu_pd(xj+t), kj);
+          c0 = _mm256_add_pd(c0, _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x0+t), k0), dj));
+          c1 = _mm256_add_pd(c1, _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x1+t), k1), dj));
+          c2 = _mm256_add_pd(c2, _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x2+t), k2), dj));
+          c3 = _mm256_add_pd(c3, _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x3+t), k3), dj));
+        }
+        double d0 = sum(c0), d1 = sum(c1), d2 = sum(c2), d3 = sum(c3);
+        for(size_t t=tv; t<t1; t++)
+        {
+          double dj = xj[t]-xj[0];
+          d0 += (x0[t]-x0[0])*dj;
+          d1 += (x1[t]-x1[0])*dj;
+          d2 += (x2[t]-x2[0])*dj;
+          d3 += (x3[t]-x3[0])*dj;
+        }
+        cov[i  +j*np] += d0;
+        cov[i+1+j*np] += d1;
+        cov[i+2+j*np] += d2;
+        cov[i+3+j*np] += d3;
+      }
+      for(; i<=j; i++)
+      {
+        const double* xi = x+i*ns;
+        __m256d ki = _mm256_set1_pd(xi[0]);
+        __m256d c = _mm256_setzero_pd();
+        for(size_t t=t0; t<tv; t+=4)
+        {
+          __m256d dj = _mm256_sub_pd(_mm256_loadu_pd(xj+t), kj);
+          c = _mm256_add_pd(c, _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(xi+t), ki), dj));
+        }
+        double d = sum(c);
+        for(size_t t=tv; t<t1; t++) d += (xi[t]-xi[0])*(xj[t]-xj[0]);
+        cov[i+j*np] += d;
+      }
+    }
+  }
+  finishMoments(x, ns, np, mean, cov, vol);
+}
+
+//
+// vector log and exp (Cephes rational approximations, double
+// precision), for the rate conversions
+//
+//   log(x) = e*ln2 + log(m),   x = m*2^e,  sqrt(1/2) <= m < sqrt(2)
+//   exp(x) = 2^n * exp(r),     x = n*ln2 + r,  |r| <= ln2/2
+//
+__attribute__((target("avx2")))
+inline __m256d polevl(__m256d x, const double* c, int n)
+{
+  __m256d y = _mm256_set1_pd(c[0]);
+  for(int idx=1; idx<=n; idx++)
+  {
+    y = _mm256_add_pd(_mm256_mul_pd(y, x), _mm256_set1_pd(c[idx]));
+  }
+  return y;
+}
+
+// polynomial with a unit leading coefficient (not stored)
+__attribute__((target("avx2")))
+inline __m256d p1evl(__m256d x, const double* c, int n)
+{
+  __m256d y = _mm256_add_pd(x, _mm256_set1_pd(c[0]));
+  for(int idx=1; idx<n; idx++)
+  {
+    y = _mm256_add_pd(_mm256_mul_pd(y, x), _mm256_set1_pd(c[idx]));
+  }
+  return y;
+}
+
+__attribute__((target("avx2")))
+__m256d logAvx2(__m256d x)
+{
+  static const double P[] = {
+    1.01875663804580931796E-4, 4.97494994976747001425E-1,
+    4.70579119878881725854E0,  1.44989225341610930846E1,
+    1.79368678507819816313E1,  7.70838733755885391666E0 };
+  static const double Q[] = {
+    1.12873587189167450590E1,  4.52279145837532221105E1,
+    8.29875266912776603211E1,  7.11544750618563894466E1,
+    2.31251620126765340583E1 };
+  const __m256i mantissa = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+  const __m256i half     = _mm256_set1_epi64x(0x3FE0000000000000LL);
+  const __m256d magic    = _mm256_set1_pd(4503599627370496.0);  // 2^52
+  const __m256i magici   = _mm256_castpd_si256(magic);
+  const __m256d one      = _mm256_set1_pd(1.0);
+  // x = m*2^e, 0.5 <= m < 1  (finite positive x)
+  __m256i bits = _mm256_castpd_si256(x);
+  __m256i ebits = _mm256_srli_epi64(bits, 52);
+  __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(ebits, magici)), magic);
+  e = _mm256_sub_pd(e, _mm256_set1_pd(1022.0));
+  __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissa), half));
+  // m < sqrt(1/2):  m = 2m-1, e = e-1;  otherwise m = m-1
+  __m256d small = _mm256_cmp_pd(m, _mm256_set1_pd(0.70710678118654752440), _CMP_LT_OQ);
+  e = _mm256_sub_pd(e, _mm256_and_pd(small, one));
+  m = _mm256_sub_pd(_mm256_add_pd(m, _mm256_and_pd(small, m)), one);
+  __m256d z = _mm256_mul_pd(m, m);
+  __m256d y = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(m, z), polevl(m, P, 5)), p1evl(m, Q, 5));
+  y = _mm256_add_pd(y, _mm256_mul_pd(e, _mm256_set1_pd(-2.121944400546905827679e-4)));
+  y = _mm256_sub_pd(y, _mm256_mul_pd(_mm256_set1_pd(0.5), z));
+  return _mm256_add_pd(_mm256_add_pd(m, y), _mm256_mul_pd(e, _mm256_set1_pd(0.693359375)));
+}
+
+__attribute__((target("avx2")))
+__m256d expAvx2(__m256d x)
+{
+  static const double P[] = {
+    1.26177193074810590878E-4, 3.02994407707441961300E-2,
+    9.99999999999999999910E-1 };
+  static const double Q[] = {
+    3.00198505138664455042E-6, 2.52448340349684104192E-3,
+    2.27265548208155028766E-1, 2.00000000000000000009E0 };
+  x = _mm256_min_pd(x, _mm256_set1_pd(709.0));
+  x = _mm256_max_pd(x, _mm256_set1_pd(-708.0));
+  // n = round(x/ln2)
+  __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634073599)),
+                              _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+  x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(6.93145751953125E-1)));
+  x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(1.42860682030941723212E-6)));
+  __m256d xx = _mm256_mul_pd(x, x);
+  __m256d px = _mm256_mul_pd(x, polevl(xx, P, 2));
+  x = _mm256_div_pd(px, _mm256_sub_pd(polevl(xx, Q, 3), px));
+  x = _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_add_pd(x, x));
+  // scale by 2^n
+  __m256i ni = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+  return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(x), _mm256_slli_epi64(ni, 52)));
+}
+
+__attribute__((target("avx2")))
+void annualizeRateAvx2(const double* x, size_t n, double t, double* y)
+{
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d vt  = _mm256_set1_pd(t);
+  const __m256d pct = _mm256_set1_pd(100.0);
+  size_t idx = 0;
+  for(; idx+4<=n; idx+=4)
+  {
+    __m256d v = logAvx2(_mm256_add_pd(one, _mm256_loadu_pd(x+idx)));
+    v = _mm256_sub_pd(expAvx2(_mm256_mul_pd(vt, v)), one);
+    _mm256_storeu_pd(y+idx, _mm256_mul_pd(v, pct));
+  }
+  annualizeRateScalar(x+idx, n-idx, t, y+idx);
+}
+
+__attribute__((target("avx2")))
+void dailyRateAvx2(const double* x, size_t n, double t, double* y)
+{
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d vt  = _mm256_set1_pd(t);
+  const __m256d pct = _mm256_set1_pd(100.0);
+  size_t idx = 0;
+  for(; idx+4<=n; idx+=4)
+  {
+    __m256d v = logAvx2(_mm256_add_pd(one, _mm256_div_pd(_mm256_loadu_pd(x+idx), pct)));
+    v = _mm256_sub_pd(expAvx2(_mm256_div_pd(v, vt)), one);
+    _mm256_storeu_pd(y+idx, v);
+  }
+  dailyRateScalar(x+idx, n-idx, t, y+idx);
+}
+
+const KernelTable AVX2 = {
+  "avx2",
+  simpleReturnsAvx2, logReturnsAvx2,
+  rollingMeanAvx2, rollingVolatilityAvx2,
+  momentsAvx2, annualizeRateAvx2, dailyRateAvx2
+};
+
+bool hasAvx2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+const KernelTable* selectTable(bool vectorized)
+{
+#ifdef QUANT_HAVE_AVX2
+  if(vectorized && hasAvx2()) return &AVX2;
+#endif
+  return &SCALAR;
+}
+
+// selected once, on first use
+const KernelTable*& active()
+{
+  static const KernelTable* table = selectTable(true);
+  return table;
+}
+
+}
+
+void Kernels::simpleReturns(const double* c, size_t nc, double* r)
+{
+  active()->simpleReturns(c, nc, r);
+}
+
+void Kernels::logReturns(const double* c, size_t nc, double* r)
+{
+  active()->logReturns(c, nc, r);
+}
+
+void Kernels::rollingMean(const double* x, size_t nx, size_t window, double* y)
+{
+  active()->rollingMean(x, nx, window, y);
+}
+
+void Kernels::rollingVolatility(const double* x, size_t nx, size_t window, double* y)
+{
+  active()->rollingVolatility(x, nx, window, y);
+}
+
+void Kernels::moments(const double* x, size_t ns, size_t np,
+                      double* mean, double* cov, double* vol)
+{
+  active()->moments(x, ns, np, mean, cov, vol);
+}
+
+void Kernels::annualizeRate(const double* x, size_t n, double t, double* y)
+{
+  active()->annualizeRate(x, n, t, y);
+}
+
+void Kernels::dailyRate(const double* x, size_t n, double t, double* y)
+{
+  active()->dailyRate(x, n, t, y);
+}
+
+const char* Kernels::getIsa()
+{
+  return active()->isa;
+}
+
+bool Kernels::setVectorized(bool enabled)
+{
+  // not synchronized:  select before kernels run on other threads
+  active() = selectTable(enabled);
+  return &SCALAR!=active();
+}
+
+// *EOF*
@@ -0,0 +1,51 @@
+// MappedFile.cxx
+// Mac Radigan
+
+#include "MappedFile.hxx"
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+USING_QUANT
+using namespace std;
+
+MappedFile::MappedFile(const string& filename)
+  : fd(-1), data(NULL), length(0)
+{
+  fd = open(filename.c_str(), O_RDONLY);
+  if(fd<0) {
+    string msg = "Unable to open file: ";
+    msg+=filename;
+    throw runtime_error(msg);
+  }
+  struct stat st;
+  if(fstat(fd,&st)<0) {
+    close(fd);
+    string msg = "Unable to stat file: ";
+    msg+=filename;
+    throw runtime_error(msg);
+  }
+  length = static_cast<size_t>(st.st_size);
+  if(length>0) {
+    void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(MAP_FAILED==p) {
+      close(fd);
+      string msg = "Unable to map file: ";
+      msg+=filename;
+      throw runtime_error(msg);
+    }
+    // the file is scanned front to back exactly once
+    madvise(p, length, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if(NULL!=data) munmap(const_cast<char*>(data), length);
+  if(fd>=0) close(fd);
+}
+
+// *EOF*
@@ -0,0 +1,164 @@
+// MomentIndex.cxx
+// Mac Radigan
+
+#include "MomentIndex.hxx"
+#include "Instrumentation.hxx"
+#include <algorithm>
+#include <stdexcept>
+
+USING_QUANT
+using namespace std;
+
+// rows between checkpoints
+const int MomentIndex::DEFAULT_STRIDE = 32;
+
+MomentIndex::MomentIndex()
+  : stride(DEFAULT_STRIDE)
+{
+}
+
+MomentIndex::~MomentIndex()
+{
+}
+
+void MomentIndex::build(const mat& x, const vector<time_t>& dates, int stride)
+{
+  if(stride<1) throw runtime_error("Moment index stride must be at least one row.");
+  if(x.n_cols!=dates.size()) throw runtime_error("Moment index requires one date per row.");
+  QUANT_TIMER("moments.index");
+  this->stride = stride;
+  this->returns = x;
+  this->dates = dates;
+  int np = returns.n_rows;
+  int ns = returns.n_cols;
+  // returns are accumulated about the mean of the history
+  shift.zeros(np);
+  for(int t=0; t<ns; t++) shift += returns.col(t);
+  if(ns>0) shift /= ns;
+  //
+  // checkpoint c holds the sums of rows [0, c*stride),
+  //
+  //   s[i]   = sum (x[i,t]-k[i])
+  //   c[i,j] = sum (x[i,t]-k[i])*(x[j,t]-k[j]),   i <= j
+  //
+  // each block is summed on its own, then added to the totals
+  int nc = ns/stride+1;
+  int npacked = np*(np+1)/2;
+  sums.zeros(np, nc);
+  products.zeros(npacked, nc);
+  vector<double> s(np);
+  vector<double> c(npacked);
+  for(int cIdx=1; cIdx<nc; cIdx++)
+  {
+    std::fill(s.begin(), s.end(), 0.0);
+    std::fill(c.begin(), c.end(), 0.0);
+    accumulate((cIdx-1)*stride, cIdx*stride, 1, s.data(), c.data());
+    const double* s0 = sums.colptr(cIdx-1);
+    double* s1 = sums.colptr(cIdx);
+    for(int i=0; i<np; i++) s1[i] = s0[i]+s[i];
+    const double* c0 = products.colptr(cIdx-1);
+    double* c1 = products.colptr(cIdx);
+    for(int k=0; k<npacked; k++) c1[k] = c0[k]+c[k];
+  }
+  QUANT_COUNT("moments.index.rows", ns);
+}
+
+void MomentIndex::accumulate(int first, int last, double sign, double* s, double* c) const
+{
+  int np = returns.n_rows;
+  int nr = last-first;
+  if(nr<1) return;
+  // deviations from the shift, one row of np per date
+  vector<double> d(static_cast<size_t>(nr)*np);
+  for(int t=0; t<nr; t++)
+  {
+    const double* xt = returns.colptr(first+t);
+    double* dt = &d[t*np];
+    for(int i=0; i<np; i++)
+    {
+      dt[i] = xt[i]-shift[i];
+      s[i] += sign*dt[i];
+    }
+  }
+  // packed upper triangle, column j at j*(j+1)/2;  a column is
+  // updated by every row while it is in cache, two rows per pass
+  double* cj = c;
+  for(int j=0; j<np; j++)
+  {
+    int t = 0;
+    for(; t+1<nr; t+=2)
+    {
+      const double* d0 = &d[t*np];
+      const double* d1 = d0+np;
+      double a0 = sign*d0[j];
+      double a1 = sign*d1[j];
+      for(int i=0; i<=j; i++) cj[i] += d0[i]*a0+d1[i]*a1;
+    }
+    if(t<nr)
+    {
+      const double* d0 = &d[t*np];
+      double a0 = sign*d0[j];
+      for(int i=0; i<=j; i++) cj[i] += d0[i]*a0;
+    }
+    cj += j+1;
+  }
+}
+
+int MomentIndex::find(time_t last) const
+{
+  return upper_bound(dates.begin(), dates.end(), last)-dates.begin();
+}
+
+void MomentIndex::moments(int start, int end, mat& mean, mat& covariance) const
+{
+  if(start<0 || end>getRows() || end-start<2)
+  {
+    throw runtime_error("Moment window requires at least two dates of the history.");
+  }
+  int np = returns.n_rows;
+  int npacked = np*(np+1)/2;
+  vector<double> s(np, 0.0);
+  vector<double> c(npacked, 0.0);
+  // the checkpoints nearest to either end of the window, and the
+  // rows between a checkpoint and the window end (at most stride/2),
+  // added if inside the window or removed if outside of it
+  int last = sums.n_cols-1;
+  int cs = min((start+stride/2)/stride, last);
+  int ce = min((end+stride/2)/stride, last);
+  if(cs<ce)
+  {
+    const double* s0 = sums.colptr(cs);
+    const double* s1 = sums.colptr(ce);
+    for(int i=0; i<np; i++) s[i] = s1[i]-s0[i];
+    const double* c0 = products.colptr(cs);
+    const double* c1 = products.colptr(ce);
+    for(int k=0; k<npacked; k++) c[k] = c1[k]-c0[k];
+    if(start<cs*stride) accumulate(start, cs*stride, 1, s.data(), c.data());
+    else accumulate(cs*stride, start, -1, s.data(), c.data());
+    if(ce*stride<end) accumulate(ce*stride, end, 1, s.data(), c.data());
+    else accumulate(end, ce*stride, -1, s.data(), c.data());
+  } else {
+    accumulate(start, end, 1, s.data(), c.data());
+  }
+  //
+  //   mean[i]  = k[i] + s[i]/n
+  //   cov[i,j] = (c[i,j] - s[i]*s[j]/n)/(n-1)
+  //
+  double n = end-start;
+  mean.set_size(1, np);
+  covariance.set_size(np, np);
+  const double* cj = c.data();
+  for(int j=0; j<np; j++)
+  {
+    for(int i=0; i<=j; i++)
+    {
+      double v = (cj[i]-s[i]*s[j]/n)/(n-1);
+      covariance(i,j) = v;
+      covariance(j,i) = v;
+    }
+    cj += j+1;
+    mean(0,j) = shift[j]+s[j]/n;
+  }
+}
+
+// *EOF*
@@ -0,0 +1,149 @@
+// MonteCarlo.cxx
+// Mac Radigan
+
+#include "MonteCarlo.hxx"
+#include "RandomStream.hxx"
+#include "ThreadPool.hxx"
+#include "Instrumentation.hxx"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+
+const size_t MonteCarlo::BLOCK_SIZE = 1024;
+const size_t MonteCarlo::DEFAULT_PATHS = 1000000;
+
+MonteCarlo::MonteCarlo(const mat& mu, const mat& weights, const Cholesky& cholesky)
+  : mu(mu), weights(weights), factor(&cholesky.getFactor()), loadings(NULL), 
+    npaths(DEFAULT_PATHS), seed(1), nthreads(0)
+{
+  if(factor->n_rows!=mu.n_elem || factor->n_cols!=mu.n_elem) 
+  {
+    throw runtime_error("Monte Carlo requires a covariance factor of every stock.");
+  }
+}
+
+MonteCarlo::MonteCarlo(const mat& mu, const mat& weights, const FactorModel& factors)
+  : mu(mu), weights(weights), factor(NULL), loadings(&factors.getLoadings()),
+    specific(sqrt(factors.getSpecific())), npaths(DEFAULT_PATHS), seed(1), nthreads(0)
+{
+  if(loadings->n_rows!=mu.n_elem) 
+  {
+    throw runtime_error("Monte Carlo requires a factor model of every stock.");
+  }
+}
+
+MonteCarlo::~MonteCarlo()
+{
+}
+
+void MonteCarlo::simulate(size_t first, size_t last, const vector<int>& horizons,
+                          vector< vector<double> >& losses) const
+{
+  int np = mu.n_elem;
+  int nk = NULL!=loadings ? loadings->n_cols : 0;
+  int nh = horizons.size();
+  const double* m = mu.memptr();
+  const double* w = weights.memptr();
+  // scratch of the block:  shocks, daily returns and growth of each stock
+  vector<double> z(NULL!=factor ? np : nk+np);
+  vector<double> r(np);
+  vector<double> g(np);
+  for(size_t path=first; path<last; path++) 
+  {
+    // the stream of the path:  any path is generated on any thread
+    RandomStream stream(seed, path);
+    std::fill(g.begin(), g.end(), 1.0);
+    for(int t=1, hIdx=0; hIdx<nh; t++) 
+    {
+      for(size_t idx=0; idx<z.size(); idx++) z[idx] = stream.normal();
+      if(NULL!=factor) 
+      {
+        // r = mu + R'*z:  column i of R holds row i of R' (i+1 terms)
+        for(int i=0; i<np; i++) 
+        {
+          const double* ri = factor->colptr(i);
+          double sum = m[i];
+          for(int j=0; j<=i; j++) sum += ri[j]*z[j];
+          r[i] = sum;
+        }
+      } else {
+        // r = mu + B*f + sqrt(D)*e
+        for(int i=0; i<np; i++) r[i] = m[i] + specific[i]*z[nk+i];
+        for(int k=0; k<nk; k++) 
+        {
+          const double* bk = loadings->colptr(k);
+          double fk = z[k];
+          for(int i=0; i<np; i++) r[i] += bk[i]*fk;
+        }
+      }
+      for(int i=0; i<np; i++) g[i] *= 1+r[i];
+      if(t==horizons[hIdx]) 
+      {
+        double pnl = 0;
+        for(int i=0; i<np; i++) pnl += w[i]*(g[i]-1);
+        losses[hIdx][path] = -100*pnl;
+        hIdx++;
+      }
+    }
+  }
+}
+
+Risk MonteCarlo::run(const vector<int>& horizons, const vector<double>& levels) const
+{
+  QUANT_TIMER("portfolio.risk");
+  if(npaths<1) throw runtime_error("Monte Carlo requires at least one path.");
+  if(weights.n_elem!=mu.n_elem) throw runtime_error("Monte Carlo requires an optimized portfolio.");
+  if(horizons.empty() || levels.empty()) throw runtime_error("Monte Carlo requires a horizon and a confidence level.");
+  Risk risk;
+  risk.horizon = horizons;
+  sort(risk.horizon.begin(), risk.horizon.end());
+  risk.horizon.erase(unique(risk.horizon.begin(), risk.horizon.end()), risk.horizon.end());
+  if(risk.horizon.front()<1) throw runtime_error("Risk horizon must be at least one day.");
+  risk.level = levels;
+  for(size_t lIdx=0; lIdx<levels.size(); lIdx++) 
+  {
+    if(!(levels[lIdx]>0 && levels[lIdx]<1)) throw runtime_error("Confidence level must be in (0,1).");
+  }
+  int nh = risk.horizon.size();
+  int nl = levels.size();
+  risk.paths = npaths;
+  vector< vector<double> > losses(nh, vector<double>(npaths));
+  {
+    // every block writes its own paths:  no locking, and the losses
+    // do not depend on the order in which the blocks complete
+    ThreadPool pool(nthreads>0 ? nthreads : ThreadPool::concurrency());
+    for(size_t first=0; first<npaths; first+=BLOCK_SIZE) 
+    {
+      size_t last = min(first+BLOCK_SIZE, npaths);
+      pool.submit([this,first,last,&risk,&losses]() { 
+        simulate(first, last, risk.horizon, losses); 
+      });
+    }
+  }
+  QUANT_COUNT("risk.paths", npaths);
+  // VaR is the level quantile of the loss, CVaR the mean loss beyond it
+  risk.var.set_size(nh, nl);
+  risk.cvar.set_size(nh, nl);
+  risk.mean.resize(nh);
+  for(int hIdx=0; hIdx<nh; hIdx++) 
+  {
+    vector<double>& loss = losses[hIdx];
+    sort(loss.begin(), loss.end());
+    vector<double> tail(npaths+1, 0.0);  // tail[k] = sum(loss[k..n-1])
+    for(size_t idx=npaths; idx-->0; ) tail[idx] = tail[idx+1]+loss[idx];
+    risk.mean[hIdx] = tail[0]/npaths;
+    for(int lIdx=0; lIdx<nl; lIdx++) 
+    {
+      size_t k = static_cast<size_t>(ceil(levels[lIdx]*npaths));
+      k = k>0 ? min(k-1, npaths-1) : 0;
+      risk.var(hIdx,lIdx) = loss[k];
+      risk.cvar(hIdx,lIdx) = tail[k]/(npaths-k);
+    }
+  }
+  return risk;
+}
+
+// *EOF*
@@ -0,0 +1,363 @@
+// PanelStore.cxx
+// Mac Radigan
+
+#include "PanelStore.hxx"
+#include "Instrumentation.hxx"
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <math.h>
+#include <stdio.h>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#ifdef QUANT_HDF5
+#include <hdf5.h>
+#endif
+
+USING_QUANT
+using namespace std;
+
+const int PanelStore::CHUNK_DATES   = 256;
+const int PanelStore::CHUNK_SYMBOLS = 16;
+const int PanelStore::COMPRESSION   = 4;
+
+bool PanelStore::isStore(const string& database)
+{
+  string extension = boost::filesystem::path(database).extension().string();
+  return boost::algorithm::iequals(extension, ".h5") || boost::algorithm::iequals(extension, ".hdf5");
+}
+
+#ifdef QUANT_HDF5
+
+namespace {
+
+// every call into the library, which is not thread-safe
+mutex h5lock;
+
+// panels, in the order of the Handles datasets
+enum Field { OPEN, HIGH, LOW, CLOSE, ADJ_CLOSE, VOLUME, NFIELDS };
+const char* FIELDS[NFIELDS] = { "open", "high", "low", "close", "adj_close", "volume" };
+
+// chunk cache of a panel:  a chunk column of the longest stores
+const size_t CHUNK_CACHE = 32<<20;
+
+void check(herr_t status, const string& what)
+{
+  if(status<0) throw runtime_error(what);
+}
+
+// an HDF5 identifier, closed on destruction
+class Handle
+{
+  private:
+    hid_t id;
+    herr_t (*closer)(hid_t);
+    // copy constructor is not implemented, restrict use as private
+    Handle(const Handle& handle);
+    Handle& operator=(const Handle& handle);
+  public:
+    Handle(hid_t id, herr_t (*closer)(hid_t), const string& what)
+      : id(id), closer(closer)
+    {
+      if(id<0) throw runtime_error(what);
+    }
+    ~Handle() { closer(id); }
+    inline operator hid_t() const { return id; }
+};
+
+// library messages are replaced by the exceptions of the callers
+void silence()
+{
+  static bool silenced = false;
+  if(!silenced) H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+  silenced = true;
+}
+
+}
+
+struct PanelStore::Handles
+{
+  Handle file;
+  unique_ptr<Handle> panels[NFIELDS];
+  Handles(const string& filename)
+    : file(H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose,
+           "Unable to open panel store: "+filename)
+  {
+  }
+};
+
+PanelStore::PanelStore(string filename)
+  : filename(filename)
+{
+  lock_guard<mutex> guard(h5lock);
+  silence();
+  h5.reset(new Handles(filename));
+  string error = "Invalid panel store: "+filename;
+  // dates
+  {
+    Handle ds(H5Dopen2(h5->file, "dates", H5P_DEFAULT), H5Dclose, error);
+    Handle space(H5Dget_space(ds), H5Sclose, error);
+    hssize_t nd = H5Sget_simple_extent_npoints(space);
+    vector<int64_t> seconds(nd);
+    if(nd>0) check(H5Dread(ds, H5T_NATIVE_INT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, &seconds[0]), error);
+    dates.assign(seconds.begin(), seconds.end());
+  }
+  // symbols
+  {
+    Handle ds(H5Dopen2(h5->file, "symbols", H5P_DEFAULT), H5Dclose, error);
+    Handle type(H5Dget_type(ds), H5Tclose, error);
+    Handle space(H5Dget_space(ds), H5Sclose, error);
+    size_t length = H5Tget_size(type);
+    hssize_t ns = H5Sget_simple_extent_npoints(space);
+    Handle memtype(H5Tcopy(H5T_C_S1), H5Tclose, error);
+    check(H5Tset_size(memtype, length), error);
+    check(H5Tset_strpad(memtype, H5T_STR_NULLPAD), error);
+    vector<char> names(ns*length+1, '\0');
+    if(ns>0) check(H5Dread(ds, memtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, &names[0]), error);
+    for(hssize_t idx=0; idx<ns; idx++) 
+    {
+      const char* name = &names[idx*length];
+      symbols.push_back(string(name, find(name, name+length, '\0')));
+      columns[symbols.back()] = idx;
+    }
+  }
+  // panels, with a chunk cache sized for a column of chunks
+  Handle access(H5Pcreate(H5P_DATASET_ACCESS), H5Pclose, error);
+  check(H5Pset_chunk_cache(access, 12421, CHUNK_CACHE, 1.0), error);
+  for(int f=0; f<NFIELDS; f++) 
+  {
+    h5->panels[f].reset(new Handle(H5Dopen2(h5->file, FIELDS[f], access), H5Dclose, error));
+  }
+}
+
+PanelStore::~PanelStore()
+{
+  lock_guard<mutex> guard(h5lock);
+  h5.reset();
+}
+
+void PanelStore::read(const string& symbol, time_t first, time_t last, Series& series) const
+{
+  QUANT_TIMER("store.read");
+  map<string,int>::const_iterator column = columns.find(symbol);
+  if(columns.end()==column) throw runtime_error("Stock is not in panel store: "+symbol);
+  // the rows of the date range
+  hsize_t lo = lower_bound(dates.begin(), dates.end(), first)-dates.begin();
+  hsize_t hi = upper_bound(dates.begin(), dates.end(), last)-dates.begin();
+  if(hi<=lo) throw runtime_error("Stock is not quoted in the date range: "+symbol);
+  hsize_t n = hi-lo;
+  vector<double> values[NFIELDS-1];
+  vector<int> volume(n);
+  {
+    lock_guard<mutex> guard(h5lock);
+    string error = "Unable to read panel store: "+filename;
+    Handle memspace(H5Screate_simple(1, &n, NULL), H5Sclose, error);
+    hsize_t start[2] = { lo, static_cast<hsize_t>(column->second) };
+    hsize_t count[2] = { n, 1 };
+    for(int f=0; f<NFIELDS; f++) 
+    {
+      hid_t panel = *h5->panels[f];
+      Handle space(H5Dget_space(panel), H5Sclose, error);
+      check(H5Sselect_hyperslab(space, H5S_SELECT_SET, start, NULL, count, NULL), error);
+      if(VOLUME==f) 
+      {
+        check(H5Dread(panel, H5T_NATIVE_INT, memspace, space, H5P_DEFAULT, &volume[0]), error);
+      } else {
+        values[f].resize(n);
+        check(H5Dread(panel, H5T_NATIVE_DOUBLE, memspace, space, H5P_DEFAULT, &values[f][0]), error);
+      }
+    }
+  }
+  // the dates quoted (close is NaN where not), newest first
+  series.symbol = symbol;
+  series.date.clear();
+  series.open.clear();
+  series.high.clear();
+  series.low.clear();
+  series.close.clear();
+  series.volume.clear();
+  series.adj_close.clear();
+  for(hsize_t r=n; r-->0;) 
+  {
+    if(isnan(values[CLOSE][r])) continue;
+    series.date.push_back(dates[lo+r]);
+    series.open.push_back(values[OPEN][r]);
+    series.high.push_back(values[HIGH][r]);
+    series.low.push_back(values[LOW][r]);
+    series.close.push_back(values[CLOSE][r]);
+    series.volume.push_back(volume[r]);
+    series.adj_close.push_back(values[ADJ_CLOSE][r]);
+  }
+  if(series.date.empty()) throw runtime_error("Stock is not quoted in the date range: "+symbol);
+  series.parsed = 0;
+  series.inode = 0;
+  series.recent = 0;
+  {
+    lock_guard<mutex> guard(series.csvLock);
+    series.csv.clear();
+  }
+  series.computeReturns();
+  QUANT_COUNT("store.read.rows", series.date.size());
+}
+
+void PanelStore::import(const string& database, vector<string> symbols, const string& filename)
+{
+  QUANT_TIMER("store.import");
+  namespace fs = boost::filesystem;
+  if(symbols.empty()) 
+  {
+    // every <SYM>/<SYM>.csv of the database
+    if(!fs::is_directory(database)) throw runtime_error("Not a quote database: "+database);
+    for(fs::directory_iterator it(database), end; it!=end; ++it) 
+    {
+      string symbol = it->path().filename().string();
+      if(fs::is_regular_file(it->path() / (symbol+".csv"))) symbols.push_back(symbol);
+    }
+    sort(symbols.begin(), symbols.end());
+  }
+  if(symbols.empty()) throw runtime_error("No stocks to import from: "+database);
+  int ns = symbols.size();
+  // the union of the dates of every stock
+  set<time_t> quoted;
+  for(int sIdx=0; sIdx<ns; sIdx++) 
+  {
+    Series series;
+    series.load(symbols[sIdx], database+"/"+symbols[sIdx]+"/"+symbols[sIdx]+".csv");
+    quoted.insert(series.getDate().begin(), series.getDate().end());
+  }
+  vector<time_t> dates(quoted.begin(), quoted.end());
+  hsize_t nd = dates.size();
+  if(0==nd) throw runtime_error("No quotes to import from: "+database);
+  // written beside the store, and renamed over it once complete
+  string partial = filename+".partial";
+  try 
+  {
+    lock_guard<mutex> guard(h5lock);
+    silence();
+    string error = "Unable to write panel store: "+filename;
+    Handle file(H5Fcreate(partial.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT), H5Fclose, error);
+    {
+      vector<int64_t> seconds(dates.begin(), dates.end());
+      Handle space(H5Screate_simple(1, &nd, NULL), H5Sclose, error);
+      Handle ds(H5Dcreate2(file, "dates", H5T_STD_I64LE, space,
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT), H5Dclose, error);
+      check(H5Dwrite(ds, H5T_NATIVE_INT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, &seconds[0]), error);
+    }
+    {
+      size_t length = 1;
+      for(int sIdx=0; sIdx<ns; sIdx++) length = max(length, symbols[sIdx].size());
+      vector<char> names(ns*length, '\0');
+      for(int sIdx=0; sIdx<ns; sIdx++) copy(symbols[sIdx].begin(), symbols[sIdx].end(), &names[sIdx*length]);
+      hsize_t count = ns;
+      Handle type(H5Tcopy(H5T_C_S1), H5Tclose, error);
+      check(H5Tset_size(type, length), error);
+      check(H5Tset_strpad(type, H5T_STR_NULLPAD), error);
+      Handle space(H5Screate_simple(1, &count, NULL), H5Sclose, error);
+      Handle ds(H5Dcreate2(file, "symbols", type, space,
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT), H5Dclose, error);
+      check(H5Dwrite(ds, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &names[0]), error);
+    }
+    // panels, chunked and compressed
+    hsize_t dims[2] = { nd, static_cast<hsize_t>(ns) };
+    hsize_t chunk[2] = { min<hsize_t>(nd, CHUNK_DATES), min<hsize_t>(ns, CHUNK_SYMBOLS) };
+    Handle space(H5Screate_simple(2, dims, NULL), H5Sclose, error);
+    unique_ptr<Handle> panels[NFIELDS];
+    for(int f=0; f<NFIELDS; f++) 
+    {
+      Handle create(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, error);
+      check(H5Pset_chunk(create, 2, chunk), error);
+      check(H5Pset_shuffle(create), error);
+      check(H5Pset_deflate(create, COMPRESSION), error);
+      if(VOLUME==f) 
+      {
+        int zero = 0;
+        check(H5Pset_fill_value(create, H5T_NATIVE_INT, &zero), error);
+      } else {
+        double nan = numeric_limits<double>::quiet_NaN();
+        check(H5Pset_fill_value(create, H5T_NATIVE_DOUBLE, &nan), error);
+      }
+      panels[f].reset(new Handle(H5Dcreate2(file, FIELDS[f], VOLUME==f ? H5T_STD_I32LE : H5T_IEEE_F64LE,
+                                            space, H5P_DEFAULT, create, H5P_DEFAULT), H5Dclose, error));
+    }
+    // a chunk column of stocks at a time:  (D x b) blocks, by row
+    for(int s0=0; s0<ns; s0+=CHUNK_SYMBOLS) 
+    {
+      int nb = min(ns-s0, CHUNK_SYMBOLS);
+      vector<double> block[NFIELDS-1];
+      for(int f=0; f<NFIELDS-1; f++) block[f].assign(nd*nb, numeric_limits<double>::quiet_NaN());
+      vector<int> volume(nd*nb, 0);
+      for(int b=0; b<nb; b++) 
+      {
+        const string& symbol = symbols[s0+b];
+        Series series;
+        series.load(symbol, database+"/"+symbol+"/"+symbol+".csv");
+        const TimeColumn& date = series.getDate();
+        for(size_t r=0; r<date.size(); r++) 
+        {
+          size_t row = lower_bound(dates.begin(), dates.end(), date[r])-dates.begin();
+          size_t at = row*nb+b;
+          block[OPEN][at]      = series.getOpen()[r];
+          block[HIGH][at]      = series.getHigh()[r];
+          block[LOW][at]       = series.getLow()[r];
+          block[CLOSE][at]     = series.getClose()[r];
+          block[ADJ_CLOSE][at] = series.getAdjClose()[r];
+          volume[at]           = series.getVolume()[r];
+        }
+      }
+      hsize_t start[2] = { 0, static_cast<hsize_t>(s0) };
+      hsize_t count[2] = { nd, static_cast<hsize_t>(nb) };
+      Handle memspace(H5Screate_simple(2, count, NULL), H5Sclose, error);
+      check(H5Sselect_hyperslab(space, H5S_SELECT_SET, start, NULL, count, NULL), error);
+      for(int f=0; f<NFIELDS; f++) 
+      {
+        if(VOLUME==f) 
+        {
+          check(H5Dwrite(*panels[f], H5T_NATIVE_INT, memspace, space, H5P_DEFAULT, &volume[0]), error);
+        } else {
+          check(H5Dwrite(*panels[f], H5T_NATIVE_DOUBLE, memspace, space, H5P_DEFAULT, &block[f][0]), error);
+        }
+      }
+    }
+  } catch(...) {
+    remove(partial.c_str());
+    throw;
+  }
+  if(0!=rename(partial.c_str(), filename.c_str())) 
+  {
+    remove(partial.c_str());
+    throw runtime_error("Unable to write panel store: "+filename);
+  }
+  QUANT_COUNT("store.import.stocks", ns);
+}
+
+#else
+
+struct PanelStore::Handles
+{
+};
+
+PanelStore::PanelStore(string filename)
+  : filename(filename)
+{
+  throw runtime_error("Panel stores require HDF5 (not compiled in): "+filename);
+}
+
+PanelStore::~PanelStore()
+{
+}
+
+void PanelStore::read(const string& symbol, time_t first, time_t last, Series& series) const
+{
+  throw runtime_error("Panel stores require HDF5 (not compiled in): "+filename);
+}
+
+void PanelStore::import(const string& database, vector<string> symbols, const string& filename)
+{
+  throw runtime_error("Panel stores require HDF5 (not compiled in): "+filename);
+}
+
+#endif
+
+// *EOF*
@@ -3,10 +3,18 @@
 
 #include "Portfolio.hxx"
 #include "Figure.hxx"
+#include "Renderer.hxx"
+#include "Cholesky.hxx"
+#include "SmallKkt.hxx"
+#include "Kernels.hxx"
+#include "Instrumentation.hxx"
 #include <sstream>
 #include <stdexcept>
 #include <iomanip>
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <memory>
 #include <math.h>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
@@ -22,85 +30,422 @@ using namespace boost::algorithm;
 const int Portfolio::WINDOW_LENGTH = 250; 
 // number of trading days in a year (time horizon)
 const int Portfolio::TIME_HORIZON = 250;  
+bool Portfolio::lazyLoading = false;
 
 Portfolio::Portfolio(string datapath) 
 {
   this->datapath = datapath;
-  isOptimized = true;
+  this->cache = NULL;
+  if(PanelStore::isStore(datapath)) this->store.reset(new PanelStore(datapath));
+  this->first_date = numeric_limits<time_t>::min();
+  this->last_date  = numeric_limits<time_t>::max();
+  this->window_length = WINDOW_LENGTH;
+  this->window_end = numeric_limits<time_t>::max();
+  this->nfactors = 0;
+  this->lower_bound = -numeric_limits<double>::infinity();
+  this->upper_bound =  numeric_limits<double>::infinity();
+  this->missing = MISSING_DROP;
+  setFormats(getDefaultFormats());
+  portfolio_rreturn = 0;
+  portfolio_volatility = 0;
+  isOptimized = false;
+  isEstimated = false;
+  isFactored = false;
+  isIndexed = false;
+}
+
+Portfolio::Portfolio(string datapath, SeriesCache& cache) 
+{
+  this->datapath = datapath;
+  this->cache = &cache;
+  if(PanelStore::isStore(datapath)) this->store = cache.getStore(datapath);
+  this->first_date = numeric_limits<time_t>::min();
+  this->last_date  = numeric_limits<time_t>::max();
+  this->window_length = WINDOW_LENGTH;
+  this->window_end = numeric_limits<time_t>::max();
+  this->nfactors = 0;
+  this->lower_bound = -numeric_limits<double>::infinity();
+  this->upper_bound =  numeric_limits<double>::infinity();
+  this->missing = MISSING_DROP;
+  setFormats(getDefaultFormats());
+  portfolio_rreturn = 0;
+  portfolio_volatility = 0;
+  isOptimized = false;
+  isEstimated = false;
+  isFactored = false;
+  isIndexed = false;
 }
 
 Portfolio::~Portfolio() 
 { 
 }
 
-mat& Portfolio::getReturnsAsMatrix() 
+void Portfolio::getReturnsAsMatrix(mat& x) 
 {
   // convert portfolio returns to matrix format
   //
   // x is an M x N matrix of daily returns, 
-  //    where M is the number daily returns
+  //    where M is the number daily returns (at most the window length,
+  //            the newest dates up to the window end after alignment, 
+  //            newest first)
   //    and   N is the number number of stocks in the portfolio
-  int np = stocks.size();   // number of stocks in portfolio
-  int ns = WINDOW_LENGTH;   // number of samples
-  mat *x = new mat(ns,np);
-  int sIdx = 0;
-  int nIdx = 0;
-  typedef map<string,Series> stock_map;
+  //
+  // x is filled in place, and only reallocated if its size changes
+  members.clear();
+  typedef map<string,SeriesPtr> stock_map;
+  BOOST_FOREACH(const stock_map::value_type& it, stocks) 
+  {
+    members.push_back(it.second.get());
+  }
+  if(numeric_limits<time_t>::max()==window_end) 
+  {
+    alignment.align(members, missing, window_length, x, window);
+  } else {
+    // the window ends on an earlier date:  align the history, and
+    // skip the newer dates
+    mat history;
+    vector<time_t> newest;
+    alignment.align(members, missing, 0, history, newest);
+    size_t first = 0;
+    while(first<newest.size() && newest[first]>window_end) first++;
+    size_t nrows = min(newest.size()-first, static_cast<size_t>(window_length));
+    x.set_size(nrows, history.n_cols);
+    if(nrows>0) x = history.rows(first, first+nrows-1);
+    window.assign(newest.begin()+first, newest.begin()+first+nrows);
+  }
+  // the window of partially loaded series is exact if it is full and
+  // every partial series quotes back to its oldest date, else the
+  // series are loaded in full and aligned again
+  bool partial = false;
+  bool covered = x.n_rows==static_cast<uword>(window_length);
+  BOOST_FOREACH(const Series* series, members) 
+  {
+    if(series->isComplete()) continue;
+    partial = true;
+    const DoubleColumn& r = series->getRreturn();
+    if(r.empty() || window.empty() || series->getDate()[r.size()-1]>window.back()) covered = false;
+  }
+  if(partial && !covered && materialize()) 
+  {
+    getReturnsAsMatrix(x);
+  }
+}
+
+bool Portfolio::materialize() 
+{
+  bool loaded = false;
+  typedef map<string,SeriesPtr> stock_map;
   BOOST_FOREACH(stock_map::value_type& it, stocks) 
   {
-    nIdx=0;
-    vector<double> rreturn = it.second.getRreturn();
-    for(int nIdx=0; nIdx<min((int)rreturn.size(),ns); nIdx++) 
+    if(it.second->isComplete()) continue;
+    QUANT_COUNT("series.materialize", 1);
+    string filename = getFilename(it.first);
+    if(NULL!=cache) 
     {
-      (*x)(nIdx,sIdx) = rreturn.at(nIdx); // rates of return (daily)
+      it.second = cache->get(it.first, filename);
+    } else {
+      std::shared_ptr<Series> series(new Series());
+      series->load(it.first, filename);
+      it.second = series;
     }
-    sIdx++;
+    loaded = true;
   }
-  return *x;
+  return loaded;
 }
 
-void Portfolio::optimize(double rreturn_opt) 
+void Portfolio::getReturnHistory(mat& x, vector<time_t>& dates) 
+{
+  // x is an N x M matrix of daily returns, one column per date
+  //    (oldest first), over the aligned history of every stock;
+  //    rolling estimates need complete rows, so pairwise is dropped
+  materialize();
+  members.clear();
+  typedef map<string,SeriesPtr> stock_map;
+  BOOST_FOREACH(const stock_map::value_type& it, stocks) 
+  {
+    members.push_back(it.second.get());
+  }
+  mat history;
+  vector<time_t> newest;
+  alignment.align(members, MISSING_PAIRWISE==missing ? MISSING_DROP : missing, 
+                  0, history, newest);
+  int np = history.n_cols;
+  int ns = history.n_rows;
+  x.set_size(np, ns);
+  dates.resize(ns);
+  for(int nIdx=0; nIdx<ns; nIdx++) 
+  {
+    for(int sIdx=0; sIdx<np; sIdx++) 
+    {
+      x(sIdx,ns-1-nIdx) = history(nIdx,sIdx);
+    }
+    dates[ns-1-nIdx] = newest[nIdx];
+  }
+}
+
+void Portfolio::estimate() 
 {
   // x is an M x N matrix of daily returns, 
   //    where M is the number daily returns
   //    and   N is the number number of stocks in the portfolio
-  mat x = getReturnsAsMatrix();
-  // s is a (M x N) variance-covariance matrix (of portfolio daily returns)
-  mat s = cov(x);
-  // mu is a (1 x M) matrix of mean portfolio daily returns
-  //   mu = mean(x)
-  mat mu = mean(x);
-  // volatility is a (1 x M) matrix of portfolio daily standard deviation
-  //   volatility = sqrt(diag(cov))
-  mat sigma = sqrt(s.diag()).t();
-  // convert target return to fractional daily
-  double mu_opt = rreturn_opt/(TIME_HORIZON*100); 
-  // save for the portfolio
-  rreturn.resize(mu.n_rows, mu.n_cols);          rreturn=mu;
-  volatility.resize(sigma.n_rows, sigma.n_cols); volatility=sigma; 
+  getReturnsAsMatrix(returns);
+  QUANT_TIMER("portfolio.covariance");
+  mat& x = returns;
+  int ns = x.n_rows;
+  int np = x.n_cols;
+  if(ns<2) 
+  {
+    throw runtime_error("Portfolio series have too few common dates.");
+  }
+  bool complete = 0==alignment.getMissing();
+  mu.set_size(1,np);
+  variance.set_size(1,np);
+  sigma.set_size(1,np);
+  if(nfactors>0) 
+  {
+    // mu is a (1 x N) matrix of mean portfolio daily returns
+    //   mu = mean(x)
+    for(int c=0; c<np; c++) 
+    {
+      const double* xc = x.colptr(c);
+      double sum = 0;
+      for(int r=0; r<ns; r++) sum += xc[r];
+      mu(0,c) = sum/ns;
+    }
+    if(!complete) 
+    {
+      // pairwise:  the factors are fit with missing returns at their mean
+      for(int c=0; c<np; c++) 
+      {
+        double* xc = x.colptr(c);
+        double sum = 0;
+        int n = 0;
+        for(int r=0; r<ns; r++) if(!isnan(xc[r])) { sum += xc[r]; n++; }
+        mu(0,c) = n>0 ? sum/n : 0;
+        for(int r=0; r<ns; r++) if(isnan(xc[r])) xc[r] = mu(0,c);
+      }
+    }
+    // S = B*B' + D, the N x N covariance is not formed
+    factors.estimate(x, nfactors);
+    variance = factors.getVariance();
+    for(int c=0; c<np; c++) sigma(0,c) = sqrt(variance(0,c));
+    covariance.reset();
+  } else {
+    // mu = mean(x), s = cov(x) and sigma = sqrt(diag(s)), 
+    // in a single sweep of the returns
+    covariance.set_size(np,np);
+    if(complete) 
+    {
+      Kernels::moments(x.memptr(), ns, np, 
+                       mu.memptr(), covariance.memptr(), sigma.memptr());
+    } else {
+      pairwiseMoments(x, mu, covariance, sigma);
+    }
+    for(int c=0; c<np; c++) variance(0,c) = covariance(c,c);
+  }
+  // S = R'*R is factored on first use (small portfolios solve without it)
+  isFactored = false;
+  // reused by every optimization until the data or the model changes
+  isEstimated = true;
+}
+
+void Portfolio::pairwiseMoments(const mat& x, mat& mu, mat& s, mat& sigma) 
+{
   //
-  // special case:  If there is only one stock in the portfolio,
-  //                the matrix solution representation is A_3x3 
-  //                singular matrix.  Handle a single-investment
-  //                portfolio as a special case;
+  // mu[i]   = mean of the returns of stock i that are present
+  // s[i,j]  = covariance over the rows where both i and j are present,
+  //           about the means of those rows
   //
-  if(1==stocks.size()) 
+  // s need not be positive definite;  the Cholesky factorization
+  // regularizes it if it is not
+  //
+  int ns = x.n_rows;
+  int np = x.n_cols;
+  for(int c=0; c<np; c++) 
   {
-    if(rreturn(0,0)!=rreturn_opt) 
+    const double* xc = x.colptr(c);
+    double sum = 0;
+    int n = 0;
+    for(int t=0; t<ns; t++) if(!isnan(xc[t])) { sum += xc[t]; n++; }
+    mu(0,c) = n>0 ? sum/n : 0;
+  }
+  for(int c=0; c<np; c++) 
+  {
+    const double* xc = x.colptr(c);
+    for(int r=0; r<=c; r++) 
     {
-       // a single-stock portfolio has only one possible return
-       // (if not allowing for short-selling, or inclusion of a risk-free asset)
-       throw runtime_error("Portfolio cannot achieve specified estimated target ROI.");
+      const double* xr = x.colptr(r);
+      double sr = 0, sc = 0;
+      int n = 0;
+      for(int t=0; t<ns; t++) 
+      {
+        if(isnan(xr[t]) || isnan(xc[t])) continue;
+        sr += xr[t]; sc += xc[t]; n++;
+      }
+      double cov = 0;
+      if(n>1) 
+      {
+        double mr = sr/n, mc = sc/n;
+        for(int t=0; t<ns; t++) 
+        {
+          if(isnan(xr[t]) || isnan(xc[t])) continue;
+          cov += (xr[t]-mr)*(xc[t]-mc);
+        }
+        cov /= n-1;
+      }
+      s(r,c) = cov;
+      s(c,r) = cov;
     }
-    // the return from 1 stock (annualized and reported as a percentage)
-    portfolio_rreturn    = mu_opt;
-    // the volatility of 1 stock (annualized and reported as a percentage)
-    portfolio_volatility = volatility(0,0)/sqrt(1/TIME_HORIZON)*100;
-    // the single investment weight is unity [1]
-    weights.resize(1,1); weights(0,0) = 1;
-    return;
+    sigma(0,c) = sqrt(s(c,c));
   }
-  //
+}
+
+void Portfolio::setWindow(int length, time_t last) 
+{
+  if(length<2) throw runtime_error("Estimate window requires at least two days.");
+  window_length = length;
+  window_end = last;
+  isOptimized = false;
+  isEstimated = false;
+}
+
+const Cholesky& Portfolio::getCholesky() 
+{
+  if(!isEstimated) estimate();
+  if(!isFactored) 
+  {
+    // S = R'*R, shared by every solve against this estimate
+    cholesky.factor(0==nfactors ? covariance : factors.getCovariance());
+    isFactored = true;
+  }
+  return cholesky;
+}
+
+const MomentIndex& Portfolio::getIndex() 
+{
+  if(!isIndexed) 
+  {
+    mat x;
+    vector<time_t> dates;
+    getReturnHistory(x, dates);
+    index.build(x, dates);
+    isIndexed = true;
+  }
+  return index;
+}
+
+int Portfolio::moments(int length, time_t last, mat& mean, mat& covariance) 
+{
+  if(length<2) throw runtime_error("Estimate window requires at least two days.");
+  const MomentIndex& history = getIndex();
+  int end = history.find(last);
+  int start = max(0, end-length);
+  history.moments(start, end, mean, covariance);
+  return end-start;
+}
+
+void Portfolio::setFactorModel(int nfactors) 
+{
+  if(nfactors<0) throw runtime_error("Number of factors cannot be negative.");
+  this->nfactors = nfactors;
+  isEstimated = false;
+}
+
+void Portfolio::setBounds(double lower, double upper) 
+{
+  if(lower>upper) throw runtime_error("Lower weight bound exceeds upper weight bound.");
+  lower_bound = lower;
+  upper_bound = upper;
+}
+
+void Portfolio::setBounds(string symbol, double lower, double upper) 
+{
+  if(lower>upper) throw runtime_error("Lower weight bound exceeds upper weight bound.");
+  bounds[symbol] = make_pair(lower, upper);
+}
+
+bool Portfolio::isBounded() const 
+{
+  if(isfinite(lower_bound) || isfinite(upper_bound)) return true;
+  typedef map<string,pair<double,double> > bounds_map;
+  BOOST_FOREACH(const bounds_map::value_type& it, bounds) 
+  {
+    if(!stocks.count(it.first)) continue;
+    if(isfinite(it.second.first) || isfinite(it.second.second)) return true;
+  }
+  return false;
+}
+
+void Portfolio::getBounds(vec& lower, vec& upper) const 
+{
+  lower.set_size(stocks.size());
+  upper.set_size(stocks.size());
+  int sIdx = 0;
+  typedef map<string,SeriesPtr> stock_map;
+  BOOST_FOREACH(const stock_map::value_type& it, stocks) 
+  {
+    map<string,pair<double,double> >::const_iterator b = bounds.find(it.first);
+    lower[sIdx] = bounds.end()!=b ? b->second.first  : lower_bound;
+    upper[sIdx] = bounds.end()!=b ? b->second.second : upper_bound;
+    sIdx++;
+  }
+}
+
+void Portfolio::setProblem() 
+{
+  // the active-set solver works on the dense covariance
+  if(nfactors>0) covariance = factors.getCovariance();
+  vec lower;
+  vec upper;
+  getBounds(lower, upper);
+  qp.setProblem(covariance, mu, lower, upper);
+}
+
+void Portfolio::basis(mat& w1, mat& w0) 
+{
+  int np = mu.n_cols;
+  border.set_size(np, 2);
+  for(int idx=0; idx<np; idx++) 
+  {
+    border(idx,0) = mu(0,idx);
+    border(idx,1) = 1.0;
+  }
+  if(0==nfactors) 
+  {
+    // small portfolios:  the fixed-size solve, unless S is singular
+    if(SmallKkt::basis(covariance, mu, w1, w0)) return;
+    getCholesky().solve(border, border_solve);
+  } else {
+    // S^-1 through the factor structure (Woodbury identity)
+    border_solve = factors.solve(border);
+  }
+  schurBasis(border, border_solve, w1, w0);
+}
+
+double Portfolio::quadratic(const mat& a, const mat& b) const 
+{
+  if(nfactors>0) return as_scalar(a*factors.multiply(b.t()));
+  // a*S*b', without temporaries
+  int np = covariance.n_rows;
+  double sum = 0;
+  for(int c=0; c<np; c++) 
+  {
+    const double* sc = covariance.colptr(c);
+    double dot = 0;
+    for(int r=0; r<np; r++) dot += a(0,r)*sc[r];
+    sum += dot*b(0,c);
+  }
+  return sum;
+}
+
+void Portfolio::solveBasis(const mat& s, const mat& mu, mat& w1, mat& w0) 
+{
+  if(SmallKkt::basis(s, mu, w1, w0)) return;
+  solveBasis(Cholesky(s), mu, w1, w0);
+}
+
+void Portfolio::solveBasis(const Cholesky& factor, const mat& mu, mat& w1, mat& w0) 
+{
   /*
    * Markowitz portfolio optimization with constraint on ROI
    *
@@ -132,54 +477,119 @@ void Portfolio::optimize(double rreturn_opt)
    *         0v      zero vector (size of portfolio)
    *         lambda1 Lagrange multiplier for target return
    *         lambda2 Lagrange multiplier for normalized weight constraint
+   *
+   * A does not depend on the target return, and b is linear in it:
+   *
+   *     b = mu_opt*e1 + e2,   so   x = mu_opt*A^-1*e1 + A^-1*e2
+   *
+   * Every point on the frontier is therefore a combination of two
+   * basis solutions:
+   *
+   *     w = mu_opt*w1 + w0
+   *
+   * The border M = [mu 1v] has rank 2, so rather than factoring A, 
+   * eliminate w with the Cholesky factor of S (S = R'*R) and solve 
+   * the 2 x 2 Schur complement for the multipliers:
+   *
+   *     Y = S^-1*M,   C = M'*Y,   [w1 w0] = Y*C^-1
    */
-  // Markowitz linear equations
-  int np = s.n_rows;
-  mat muT = mu.t();          // mu'
-  mat v1  = ones<mat>(np,1); // v1
-  mat v1T = ones<mat>(1,np); // v1'
+  int np = mu.n_cols;
+  mat m(np, 2);
+  for(int idx=0; idx<np; idx++) 
+  {
+    m(idx,0) = mu(0,idx);     // mu
+    m(idx,1) = 1.0;           // 1
+  }
+  schurBasis(m, factor.solve(m), w1, w0);
+}
+
+void Portfolio::schurBasis(const mat& m, const mat& y, mat& w1, mat& w0) 
+{
+  //
+  //         [ mu'*S^-1*mu  mu'*S^-1*1v ]   [ c  b ]
+  //     C = [ 1v'*S^-1*mu  1v'*S^-1*1v ] = [ b  a ],   d = a*c-b^2
   //
-  //     [ 2S   mu v1 ]
-  // A = [ mu'  0  0  ]
-  //     [ v1'  0  0  ]
+  //     w1 = (a*S^-1*mu - b*S^-1*1v)/d
+  //     w0 = (c*S^-1*1v - b*S^-1*mu)/d
   //
-  mat a = zeros<mat>(np+2, np+2);
-  for(int r=0; r<s.n_rows; r++) 
+  int np = m.n_rows;
+  double a = 0;
+  double b = 0;
+  double c = 0;
+  for(int idx=0; idx<np; idx++) 
   {
-    for(int c=0; c<s.n_cols; c++) 
-    {
-      a(r,c) = 2*s(r,c);
-    }
+    a += y(idx,1);
+    b += y(idx,0);
+    c += m(idx,0)*y(idx,0);
   }
+  double d = a*c-b*b;
+  if(0==d) throw runtime_error("Portfolio returns are degenerate.");
+  w1.set_size(1, np);
+  w0.set_size(1, np);
   for(int idx=0; idx<np; idx++) 
   {
-    a(idx,np)   = mu(0,idx);  // mu
-    a(np,idx)   = mu(0,idx);  // mu
-    a(idx,np+1) = 1.0;        // 1
-    a(np+1,idx) = 1.0;        // 1
+    w1(0,idx) = (a*y(idx,0) - b*y(idx,1))/d;
+    w0(0,idx) = (c*y(idx,1) - b*y(idx,0))/d;
+  }
+}
+
+void Portfolio::optimize(double rreturn_opt) 
+{
+  if(!isEstimated) estimate();
+  // volatility is a (1 x M) matrix of portfolio daily standard deviation
+  //   volatility = sqrt(diag(cov))
+  // convert target return to fractional daily
+  double mu_opt = rreturn_opt/(TIME_HORIZON*100); 
+  // save for the portfolio
+  rreturn.set_size(mu.n_rows, mu.n_cols);
+  volatility.set_size(sigma.n_rows, sigma.n_cols);
+  for(unsigned idx=0; idx<mu.n_elem; idx++) 
+  {
+    rreturn[idx]    = mu[idx];
+    volatility[idx] = sigma[idx];
   }
   //
-  //     [ 0v     ]
-  // b = [ mu_opt ]
-  //     [ 1      ]
-  //
-  mat b(np+2,1);
-  b(np,0)   = mu_opt;                     // mu_opt
-  b(np+1,0) = 1.0;                        // 1
-  //
-  // Az=b  -->  z = A^-1*b
+  // special case:  If there is only one stock in the portfolio,
+  //                the matrix solution representation is A_3x3 
+  //                singular matrix.  Handle a single-investment
+  //                portfolio as a special case;
   //
-  mat z = solve(a,b); // solve Ax=b
-  // first 1..Np elements are the weights
-  mat wT = z.rows(0,np-1);
-  mat w = wT.t();
-  weights = zeros<mat>(np,1);
-  weights = w;
+  if(1==stocks.size()) 
+  {
+    if(rreturn(0,0)!=rreturn_opt) 
+    {
+       // a single-stock portfolio has only one possible return
+       // (if not allowing for short-selling, or inclusion of a risk-free asset)
+       throw runtime_error("Portfolio cannot achieve specified estimated target ROI.");
+    }
+    // the return from 1 stock (annualized and reported as a percentage)
+    portfolio_rreturn    = mu_opt;
+    // the volatility of 1 stock (annualized and reported as a percentage)
+    portfolio_volatility = volatility(0,0)/sqrt(1/TIME_HORIZON)*100;
+    // the single investment weight is unity [1]
+    weights.resize(1,1); weights(0,0) = 1;
+    isOptimized = true;
+    return;
+  }
+  if(isBounded()) 
+  {
+    QUANT_TIMER("portfolio.solve.qp");
+    setProblem();
+    weights = qp.solve(mu_opt).t();
+  } else {
+    QUANT_TIMER("portfolio.solve.kkt");
+    basis(basis_w1, basis_w0);
+    weights.set_size(1, basis_w1.n_cols);
+    for(unsigned idx=0; idx<basis_w1.n_cols; idx++) 
+    {
+      weights(0,idx) = mu_opt*basis_w1(0,idx) + basis_w0(0,idx);
+    }
+  }
   // results:
   // portfolio variance
-  mat sig2_opt = w*s*wT; 
+  double sig2_opt = quadratic(weights, weights); 
   // portfolio standard deviation
-  mat sig_opt = sqrt(sig2_opt);
+  double sig_opt = sqrt(sig2_opt);
   // portfolio volatility
   //   mat mu_opt_sol = w*muT;
   //   portfolio_rreturn = annualize(mu_opt_sol(0,0));
@@ -187,18 +597,233 @@ void Portfolio::optimize(double rreturn_opt)
   // annualized as a percentage
   //   sig_a = sig/sqrt(1/T)*100
   portfolio_volatility = 
-    sig_opt(0,0)/sqrt(1/static_cast<double>(TIME_HORIZON))*100; 
+    sig_opt/sqrt(1/static_cast<double>(TIME_HORIZON))*100; 
   // annualized portfolio returns
   //   rreturn = ((1+mu).^T-1)*100;     
-  rreturn = annualizeRate(mu);
   // annualized portfolio volatilities
   //   volatility = sig/sqrt(1/T)*100
-  volatility = sigma;
-  volatility *= (1/sqrt(1/static_cast<double>(TIME_HORIZON)))*100; 
+  Kernels::annualizeRate(mu.memptr(), mu.n_elem, TIME_HORIZON, rreturn.memptr());
+  double scale = (1/sqrt(1/static_cast<double>(TIME_HORIZON)))*100;
+  for(unsigned idx=0; idx<sigma.n_elem; idx++) 
+  {
+    volatility[idx] = sigma[idx]*scale;
+  }
   isOptimized = true; // flag the calculation
 }
 
-mat& Portfolio::dailyRate(mat& x) 
+Frontier Portfolio::frontier(const vector<double>& targets) 
+{
+  if(stocks.size()<2) 
+  {
+    throw runtime_error("Efficient frontier requires at least two stocks.");
+  }
+  if(!isEstimated) estimate();
+  QUANT_TIMER("portfolio.frontier");
+  if(isBounded()) 
+  {
+    // one solve per target, each warm started from the previous
+    // (targets that are not attainable within the bounds are omitted)
+    setProblem();
+    Frontier f;
+    int np = stocks.size();
+    mat points(targets.size(), np);
+    int nIdx = 0;
+    for(size_t tIdx=0; tIdx<targets.size(); tIdx++) 
+    {
+      double mu_opt = targets.at(tIdx)/(TIME_HORIZON*100); 
+      mat w;
+      try 
+      {
+        w = qp.solve(mu_opt).t();
+      } catch(runtime_error& e) {
+        continue;
+      }
+      points.row(nIdx++) = w;
+      f.rreturn.push_back(targets.at(tIdx));
+      f.volatility.push_back(
+        sqrt(std::max(quadratic(w,w),0.0))/sqrt(1/static_cast<double>(TIME_HORIZON))*100);
+    }
+    f.weights = nIdx>0 ? mat(points.rows(0,nIdx-1)) : mat(0,np);
+    return f;
+  }
+  mat w1;
+  mat w0;
+  basis(w1, w0);
+  //
+  // portfolio variance is quadratic in the (daily) target return:
+  //
+  //   sig2(mu_opt) = mu_opt^2*w1'S*w1 + 2*mu_opt*w1'S*w0 + w0'S*w0
+  //
+  double g11 = quadratic(w1, w1);
+  double g10 = quadratic(w1, w0);
+  double g00 = quadratic(w0, w0);
+  int np = w1.n_cols;
+  int nt = targets.size();
+  Frontier f;
+  f.rreturn.reserve(nt);
+  f.volatility.reserve(nt);
+  f.weights.set_size(nt, np);
+  for(int tIdx=0; tIdx<nt; tIdx++) 
+  {
+    // convert target return to fractional daily
+    double mu_opt = targets.at(tIdx)/(TIME_HORIZON*100); 
+    f.weights.row(tIdx) = mu_opt*w1 + w0;
+    double sig2 = mu_opt*mu_opt*g11 + 2*mu_opt*g10 + g00;
+    f.rreturn.push_back(targets.at(tIdx));
+    // annualized as a percentage
+    f.volatility.push_back(
+      sqrt(std::max(sig2,0.0))/sqrt(1/static_cast<double>(TIME_HORIZON))*100);
+  }
+  return f;
+}
+
+Frontier Portfolio::resample(const vector<double>& targets, size_t nresamples,
+                            int block, uint64_t seed, int nthreads) 
+{
+  if(stocks.size()<2) 
+  {
+    throw runtime_error("Resampled frontier requires at least two stocks.");
+  }
+  if(!isEstimated) estimate();
+  Resampler resampler(returns, nfactors);
+  resampler.setResamples(nresamples);
+  resampler.setBlockLength(block);
+  resampler.setSeed(seed);
+  resampler.setThreads(nthreads);
+  if(isBounded()) 
+  {
+    vec lower;
+    vec upper;
+    getBounds(lower, upper);
+    resampler.setBounds(lower, upper);
+  }
+  vector<double> daily;
+  for(size_t tIdx=0; tIdx<targets.size(); tIdx++) 
+  {
+    // convert target return to fractional daily
+    daily.push_back(targets.at(tIdx)/(TIME_HORIZON*100));
+  }
+  vector<size_t> count;
+  mat average = resampler.run(daily, count);
+  // the averaged weights, valued with the estimate of the full window
+  Frontier f;
+  int np = stocks.size();
+  mat points(targets.size(), np);
+  int nIdx = 0;
+  for(size_t tIdx=0; tIdx<targets.size(); tIdx++) 
+  {
+    if(0==count[tIdx]) continue;
+    mat w = average.row(tIdx);
+    points.row(nIdx++) = w;
+    f.rreturn.push_back(as_scalar(w*mu.t())*TIME_HORIZON*100);
+    f.volatility.push_back(
+      sqrt(std::max(quadratic(w,w),0.0))/sqrt(1/static_cast<double>(TIME_HORIZON))*100);
+  }
+  f.weights = nIdx>0 ? mat(points.rows(0,nIdx-1)) : mat(0,np);
+  return f;
+}
+
+Backtest Portfolio::backtest(double rreturn_opt, int rebalance) 
+{
+  if(stocks.size()<2) 
+  {
+    throw runtime_error("Backtest requires at least two stocks.");
+  }
+  if(rebalance<1) 
+  {
+    throw runtime_error("Rebalance interval must be at least one day.");
+  }
+  QUANT_TIMER("portfolio.backtest");
+  const MomentIndex& history = getIndex();
+  const mat& x = history.getReturns();
+  const vector<time_t>& dates = history.getDates();
+  int np = x.n_rows;
+  int ns = x.n_cols;
+  int nw = window_length;
+  if(ns<=nw) 
+  {
+    throw runtime_error("Return history is too short for a walk-forward backtest.");
+  }
+  // convert target return to fractional daily
+  double mu_opt = rreturn_opt/(TIME_HORIZON*100); 
+  // the backtest always uses the sample covariance of the window,
+  // queried from the moment index at each rebalance
+  Backtest result;
+  int nr = (ns-nw+rebalance-1)/rebalance;
+  result.weights.set_size(nr, np);
+  result.date.reserve(ns-nw);
+  result.rreturn.reserve(ns-nw);
+  mat w;
+  mat w1;
+  mat w0;
+  mat m;
+  mat s;
+  bool bounded = isBounded();
+  vec lower;
+  vec upper;
+  getBounds(lower, upper);
+  for(int t=nw, rIdx=0; t<ns; t++) 
+  {
+    if(0==(t-nw)%rebalance) 
+    {
+      // re-optimize over the window [t-nw, t)
+      history.moments(t-nw, t, m, s);
+      if(bounded) 
+      {
+        // warm started from the previous rebalance
+        qp.setProblem(s, m, lower, upper);
+        w = qp.solve(mu_opt).t();
+      } else {
+        solveBasis(s, m, w1, w0);
+        w = mu_opt*w1 + w0;
+      }
+      result.weights.row(rIdx++) = w;
+      result.rebalance.push_back(dates[t]);
+    }
+    // out-of-sample return over day t, at the held weights
+    double r = 0;
+    const double* xt = x.colptr(t);
+    for(int sIdx=0; sIdx<np; sIdx++) r += w(0,sIdx)*xt[sIdx];
+    result.date.push_back(dates[t]);
+    result.rreturn.push_back(r);
+  }
+  // realized statistics (annualized, as percentages)
+  int nt = result.rreturn.size();
+  double mean = 0;
+  for(int tIdx=0; tIdx<nt; tIdx++) mean += result.rreturn[tIdx];
+  mean /= nt;
+  double var = 0;
+  for(int tIdx=0; tIdx<nt; tIdx++) 
+  {
+    double d = result.rreturn[tIdx]-mean;
+    var += d*d;
+  }
+  var = nt>1 ? var/(nt-1) : 0;
+  result.portfolio_rreturn = annualizeRate(mean);
+  result.portfolio_volatility = 
+    sqrt(var)/sqrt(1/static_cast<double>(TIME_HORIZON))*100; 
+  return result;
+}
+
+Risk Portfolio::risk(const vector<int>& horizons, const vector<double>& levels,
+                     size_t npaths, uint64_t seed, int nthreads) 
+{
+  // the weights must be optimized against the current estimate
+  if(!isEstimated || weights.n_elem!=stocks.size() || stocks.empty()) 
+  {
+    throw runtime_error("Risk requires an optimized portfolio.");
+  }
+  // paths share the factor of the estimate and the optimized weights
+  unique_ptr<MonteCarlo> mc(nfactors>0 
+    ? new MonteCarlo(mu, weights, factors) 
+    : new MonteCarlo(mu, weights, getCholesky()));
+  mc->setPaths(npaths);
+  mc->setSeed(seed);
+  mc->setThreads(nthreads);
+  return mc->run(horizons, levels);
+}
+
+mat Portfolio::dailyRate(const mat& x) 
 {
   //
   // annualized percentage:
@@ -209,17 +834,9 @@ mat& Portfolio::dailyRate(mat& x)
   //       x_a is matrix of annual samples matrix
   //       T   is the annual number of trading days
   //
-  int m = x.n_rows;
-  int n = x.n_cols;
-  mat *b = new mat(m,n);
-  for(int row=0; row<m; row++) 
-  {
-    for(int col=0; col<n; col++) 
-    {
-      (*b)(row,col) = dailyRate(x(row,col));
-    }
-  }
-  return *b;
+  mat b(x.n_rows,x.n_cols);
+  Kernels::dailyRate(x.memptr(), x.n_elem, TIME_HORIZON, b.memptr());
+  return b;
 }
 
 double Portfolio::dailyRate(double x) 
@@ -237,7 +854,7 @@ double Portfolio::dailyRate(double x)
           1.0/static_cast<long double>(TIME_HORIZON))-1;
 }
 
-mat& Portfolio::annualizeRate(mat& x) 
+mat Portfolio::annualizeRate(const mat& x) 
 {
   //
   // annualized percentage:
@@ -248,17 +865,9 @@ mat& Portfolio::annualizeRate(mat& x)
   //       x is matrix of daily samples matrix
   //       T is the annual number of trading days
   //
-  int m = x.n_rows;
-  int n = x.n_cols;
-  mat *b = new mat(m,n);
-  for(int row=0; row<m; row++) 
-  {
-    for(int col=0; col<n; col++) 
-    {
-      (*b)(row,col) = annualizeRate(x(row,col));
-    }
-  }
-  return *b;
+  mat b(x.n_rows,x.n_cols);
+  Kernels::annualizeRate(x.memptr(), x.n_elem, TIME_HORIZON, b.memptr());
+  return b;
 }
 
 double Portfolio::annualizeRate(double x) 
@@ -277,18 +886,7 @@ double Portfolio::annualizeRate(double x)
           *100.0;
 }
 
-void Portfolio::addSeries(string symbol) 
-{
-  //Series *series = new Series();
-  Series series;
-  string filename = datapath + "/";
-  filename += symbol + "/" + symbol + ".csv";
-  series.load(symbol,filename);
-  stocks.insert(pair<string,Series&>(symbol,series));
-  isOptimized = false;
-}
-
-void Portfolio::createReport(string directory) 
+vector<string> Portfolio::getDefaultFormats() 
 {
   vector<string> formats;
   formats.push_back("gnuplot");
@@ -298,8 +896,121 @@ void Portfolio::createReport(string directory)
   //formats.push_back("pdf");
   //formats.push_back("tif");
   formats.push_back("png");
+  return formats;
+}
+
+void Portfolio::setFormats(const vector<string>& formats) 
+{
+  BOOST_FOREACH(const string& fmt, formats) 
+  {
+    if(iequals(fmt,"dumb") || iequals(fmt,"gnuplot")) continue;
+    try 
+    {
+      Figure::getTerminal("report."+fmt);
+    } catch(runtime_error& e) {
+      throw runtime_error("Unsupported report format: "+fmt);
+    }
+  }
+  this->formats = formats;
+}
+
+vector<string> Portfolio::getSymbols() const 
+{
+  vector<string> symbols;
+  typedef map<string,SeriesPtr> stock_map;
+  BOOST_FOREACH(const stock_map::value_type& it, stocks) 
+  {
+    symbols.push_back(it.first);
+  }
+  return symbols;
+}
+
+string Portfolio::getFilename(const string& symbol) const 
+{
+  string filename = datapath + "/";
+  filename += symbol + "/" + symbol + ".csv";
+  return filename;
+}
+
+void Portfolio::addSeries(string symbol) 
+{
+  string filename = getFilename(symbol);
+  SeriesPtr series;
+  if(store) 
+  {
+    // the columns of the stock in the panel store, over the date range
+    if(NULL!=cache) 
+    {
+      series = cache->get(symbol, *store, first_date, last_date);
+    } else {
+      std::shared_ptr<Series> loaded(new Series());
+      store->read(symbol, first_date, last_date, *loaded);
+      series = loaded;
+    }
+  } else if(NULL!=cache) {
+    series = cache->get(symbol, filename, lazyLoading ? window_length+1 : 0);
+  } else {
+    std::shared_ptr<Series> loaded(new Series());
+    loaded->load(symbol, filename, lazyLoading ? window_length+1 : 0);
+    series = loaded;
+  }
+  stocks.insert(pair<string,SeriesPtr>(symbol,series));
+  isOptimized = false;
+  isEstimated = false;
+  isIndexed = false;
+}
+
+void Portfolio::setDateRange(time_t first, time_t last) 
+{
+  if(!store) throw runtime_error("Date ranges require a panel store database.");
+  if(first>last) throw runtime_error("Date range ends before it begins.");
+  first_date = first;
+  last_date = last;
+  vector<string> symbols = getSymbols();
+  stocks.clear();
+  BOOST_FOREACH(const string& symbol, symbols) 
+  {
+    addSeries(symbol);
+  }
+  isOptimized = false;
+  isEstimated = false;
+  isIndexed = false;
+}
+
+bool Portfolio::refresh() 
+{
+  // panel stores are read-only snapshots (imported again to update)
+  if(NULL==cache || store) return false;
+  bool changed = false;
+  typedef map<string,SeriesPtr> stock_map;
+  BOOST_FOREACH(stock_map::value_type& it, stocks) 
+  {
+    SeriesPtr series = cache->refresh(it.first, getFilename(it.first));
+    if(series==it.second) continue;
+    it.second = series;
+    changed = true;
+  }
+  if(changed) 
+  {
+    isOptimized = false;
+    isEstimated = false;
+    isIndexed = false;
+  }
+  return changed;
+}
+
+void Portfolio::createReport(string directory) 
+{
+  // render synchronously:  the renderer completes on destruction
+  Renderer renderer(1);
+  createReport(directory, renderer);
+}
+
+void Portfolio::createReport(string directory, Renderer& renderer) 
+{
+  QUANT_TIMER("portfolio.report");
   typedef vector<string> formats_vector;
-  typedef map<string,Series> stock_map;
+  typedef map<string,SeriesPtr> stock_map;
   vector<string> symbols;
   vector<double> roi;
   vector<double> std;
@@ -311,46 +1022,69 @@ void Portfolio::createReport(string directory)
     symbols.push_back(sit.first);
     sIdx++;
   }
+  // efficient frontier across the plotted return range
+  Frontier curve;
+  if(stocks.size()>1) 
+  {
+    vector<double> targets;
+    for(int tIdx=0; tIdx<=80; tIdx++) targets.push_back(0.5*tIdx);
+    curve = frontier(targets);
+  }
   string name = join(symbols,"_");
+  if(name.size()>128) 
+  {
+    // large portfolios:  a name within file system limits, kept 
+    // distinct by the fingerprint of the full name
+    stringstream shortened;
+    shortened << name.substr(0,111) << "_" << hex << setw(16) << setfill('0') 
+              << Renderer::getFingerprint(name);
+    name = shortened.str();
+  }
   stringstream rootdir;
   rootdir << directory << "/" << name;
   create_directory(rootdir.str());
-  BOOST_FOREACH(formats_vector::value_type& fmt, formats) {
-    BOOST_FOREACH(stock_map::value_type& sit, stocks) {
+  // each figure is composed once and rendered in every format
+  BOOST_FOREACH(stock_map::value_type& sit, stocks) {
     // candle plots
-      Figure figure;
-      figure.setTerminal("dumb");
-      figure.setTitle(sit.first);
-      figure.setXlabel("");
-      figure.setYlabel("");
-      figure.plotCandle(sit.second, WINDOW_LENGTH);
-      if(iequals(fmt,"dumb")) {
-        figure.show();
-      } else {
-        stringstream filename;
-        filename << rootdir.str() << "/" << sit.first << "." << fmt;
-        figure.save(filename.str());
-      }
-      figure.reset();
-    }
-    // risk/return plots
     Figure figure;
     figure.setTerminal("dumb");
-    figure.setTitle("Portfolio Performance");
-    figure.plotPortfolio(symbols, roi, std,
-                         portfolio_rreturn, portfolio_volatility);
-    if(iequals(fmt,"dumb")) {
-      figure.show();
-    } else {
+    figure.setTitle(sit.first);
+    figure.setXlabel("");
+    figure.setYlabel("");
+    // the window, or the whole of a shorter history
+    figure.plotCandle(*sit.second, min<int>(window_length, sit.second->getDate().size()));
+    BOOST_FOREACH(formats_vector::value_type& fmt, formats) {
       stringstream filename;
+      if(!iequals(fmt,"dumb")) {
+        filename << rootdir.str() << "/" << sit.first << "." << fmt;
+      }
+      renderer.render(figure, filename.str());
+    }
+  }
+  // risk/return plots
+  Figure figure;
+  figure.setTerminal("dumb");
+  figure.setTitle("Portfolio Performance");
+  figure.plotPortfolio(symbols, roi, std,
+                       portfolio_rreturn, portfolio_volatility,
+                       curve.rreturn, curve.volatility);
+  // the weights are not plotted, but the report depends on them
+  stringstream allocation;
+  allocation << "weights:";
+  for(size_t wIdx=0; wIdx<weights.n_elem && wIdx<symbols.size(); wIdx++) {
+    allocation << " " << symbols[wIdx] << "=" << weights[wIdx];
+  }
+  figure.comment(allocation.str());
+  BOOST_FOREACH(formats_vector::value_type& fmt, formats) {
+    stringstream filename;
+    if(!iequals(fmt,"dumb")) {
       filename << rootdir.str() << "/Portfolio" << "." << fmt;
-      figure.save(filename.str());
     }
-    figure.reset();
+    renderer.render(figure, filename.str());
   }
 }
 
-string& Portfolio::toString() const 
+string Portfolio::toString() const 
 {
   stringstream ss;
   if(!isOptimized) 
@@ -366,7 +1100,7 @@ string& Portfolio::toString() const
     ss << endl;
     ss << "\tSYMBOL\tWEIGHT\tRETURN\t VOLATILITY" << endl;
     int sIdx = 0;
-    typedef map<string,Series> stock_map;
+    typedef map<string,SeriesPtr> stock_map;
     BOOST_FOREACH(const stock_map::value_type& it, stocks) {
       string symbol(it.first);
       ss << setiosflags(ios::fixed) 
@@ -386,7 +1120,7 @@ string& Portfolio::toString() const
       sIdx++;
     }
   }
-  return *(new string(ss.str()));
+  return ss.str();
 }
 
 // *EOF*
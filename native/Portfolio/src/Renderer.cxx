@@ -0,0 +1,384 @@
+// Renderer.cxx
+// Mac Radigan
+
+#include "Renderer.hxx"
+#include "Instrumentation.hxx"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <boost/filesystem.hpp>
+
+USING_QUANT
+using namespace std;
+
+// seconds a session may take to confirm a figure
+const int Renderer::TIMEOUT = 300;
+
+namespace {
+
+// a tagged figure ends by printing the error number of the session
+// (to its standard error), read back to confirm the output
+const char* const CONFIRM = 
+  "print sprintf(\"rendered %d\", GPVAL_ERRNO)\nreset errors\n";
+const char* const CONFIRMED = "rendered ";
+
+// discard a SIGPIPE raised (and blocked) by a write to a session that
+// has exited
+void discardSigpipe()
+{
+  sigset_t pipe;
+  sigemptyset(&pipe);
+  sigaddset(&pipe, SIGPIPE);
+  struct timespec now = { 0, 0 };
+  while(sigtimedwait(&pipe, NULL, &now)>0);
+}
+
+}
+
+// a gnuplot process, reading commands on its standard input and 
+// printing to its standard error
+struct Renderer::Session
+{
+  pid_t pid;
+  int in;                           // gnuplot standard input
+  int out;                          // gnuplot standard error
+  std::string pending;              // output read past the last line
+  std::chrono::steady_clock::time_point started;
+  Session() : pid(-1), in(-1), out(-1) {}
+  inline bool isOpen() const { return pid>0; }
+  bool open();
+  // close the input and wait for gnuplot to exit (killed if it failed)
+  void close(bool failed);
+  bool send(const string& text);
+  // read to the confirmation of a figure (false if the session failed),
+  // with the error number of the session
+  bool confirm(int& error);
+};
+
+bool Renderer::Session::open()
+{
+  int input[2];
+  int output[2];
+  if(pipe2(input, O_CLOEXEC)<0) return false;
+  if(pipe2(output, O_CLOEXEC)<0)
+  {
+    ::close(input[0]);
+    ::close(input[1]);
+    return false;
+  }
+  pid = fork();
+  if(0==pid)
+  {
+    dup2(input[0], 0);
+    dup2(output[1], 2);
+    execlp("gnuplot", "gnuplot", (char*)NULL);
+    _exit(127);
+  }
+  ::close(input[0]);
+  ::close(output[1]);
+  if(pid<0)
+  {
+    ::close(input[1]);
+    ::close(output[0]);
+    return false;
+  }
+  in = input[1];
+  out = output[0];
+  pending.clear();
+  started = std::chrono::steady_clock::now();
+  return true;
+}
+
+void Renderer::Session::close(bool failed)
+{
+  if(!isOpen()) return;
+  if(failed) kill(pid, SIGKILL);
+  ::close(in);
+  // gnuplot exits once it has read (and rendered) every command
+  char buffer[4096];
+  ssize_t n;
+  while((n=read(out, buffer, sizeof(buffer)))!=0)
+  {
+    if(n<0 && EINTR!=errno) break;
+    if(n>0) cerr.write(buffer, n);
+  }
+  ::close(out);
+  int status;
+  while(waitpid(pid, &status, 0)<0 && EINTR==errno);
+  pid = -1;
+}
+
+bool Renderer::Session::send(const string& text)
+{
+  const char* p = text.data();
+  size_t n = text.size();
+  while(n>0)
+  {
+    ssize_t written = write(in, p, n);
+    if(written<0 && EINTR==errno) continue;
+    if(written<=0)
+    {
+      if(EPIPE==errno) discardSigpipe();
+      return false;
+    }
+    p += written;
+    n -= written;
+  }
+  return true;
+}
+
+bool Renderer::Session::confirm(int& error)
+{
+  std::chrono::steady_clock::time_point deadline = 
+    std::chrono::steady_clock::now()+std::chrono::seconds(TIMEOUT);
+  for(;;)
+  {
+    // other output (warnings, errors) is passed on
+    size_t eol;
+    while(string::npos!=(eol=pending.find('\n')))
+    {
+      string line = pending.substr(0, eol);
+      pending.erase(0, eol+1);
+      if(0==line.compare(0, strlen(CONFIRMED), CONFIRMED))
+      {
+        error = atoi(line.c_str()+strlen(CONFIRMED));
+        return true;
+      }
+      cerr << line << endl;
+    }
+    int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline-std::chrono::steady_clock::now()).count();
+    if(remaining<=0) return false;
+    struct pollfd fds = { out, POLLIN, 0 };
+    int ready = poll(&fds, 1, remaining);
+    if(ready<0 && EINTR==errno) continue;
+    if(ready<=0) return false;
+    char buffer[4096];
+    ssize_t n = read(out, buffer, sizeof(buffer));
+    if(n<0 && EINTR==errno) continue;
+    if(n<=0) return false;
+    pending.append(buffer, n);
+  }
+}
+
+Renderer::Renderer(int nsessions, bool incremental)
+  : stopping(false), incremental(incremental), rendered(0), skipped(0)
+{
+  if(nsessions<1) nsessions = 1;
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+  timeradd(&usage.ru_utime, &usage.ru_stime, &children);
+  for(int idx=0; idx<nsessions; idx++)
+  {
+    workers.push_back(thread(&Renderer::run, this));
+  }
+}
+
+Renderer::~Renderer()
+{
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  ready.notify_all();
+  for(size_t idx=0; idx<workers.size(); idx++)
+  {
+    workers[idx].join();
+  }
+  // gnuplot CPU time:  sessions are reaped by the workers, so their time
+  // is the growth of the child time over the life of the renderer (it
+  // includes any other child reaped meanwhile, e.g. by another renderer)
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+  struct timeval total;
+  struct timeval elapsed;
+  timeradd(&usage.ru_utime, &usage.ru_stime, &total);
+  timersub(&total, &children, &elapsed);
+  QUANT_DURATION("report.gnuplot.cpu", 
+    std::chrono::seconds(elapsed.tv_sec)+std::chrono::microseconds(elapsed.tv_usec));
+}
+
+uint64_t Renderer::getFingerprint(const string& text)
+{
+  // 64 bit FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t idx=0; idx<text.size(); idx++)
+  {
+    hash ^= static_cast<unsigned char>(text[idx]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+string Renderer::getTagName(const string& filename)
+{
+  // <dir>/<file>  -->  <dir>/.<file>.fingerprint
+  boost::filesystem::path file(filename);
+  return (file.parent_path() / ("."+file.filename().string()+".fingerprint")).string();
+}
+
+bool Renderer::isCurrent(const string& filename, uint64_t fingerprint)
+{
+  if(!boost::filesystem::exists(filename)) return false;
+  ifstream fin(getTagName(filename).c_str());
+  uint64_t previous = 0;
+  if(!(fin >> hex >> previous)) return false;
+  return previous==fingerprint;
+}
+
+void Renderer::tag(const string& tag, uint64_t fingerprint)
+{
+  // a missing tag only costs a render on the next run
+  std::ofstream fout(tag.c_str());
+  fout << hex << fingerprint << endl;
+}
+
+void Renderer::render(const Figure& figure, const string& filename)
+{
+  // resolve the terminal now, so unsupported formats fail in the caller
+  string extension = boost::filesystem::path(filename).extension().string();
+  bool script = ".gnuplot"==extension;
+  Job job;
+  job.commands = script ? string() : figure.getCommands(filename);
+  job.format = extension.empty() ? "terminal" : extension.substr(1);
+  job.fingerprint = 0;
+  if(filename.empty())
+  {
+    // to the terminal:  always rendered
+    enqueue(job);
+    return;
+  }
+  if(script)
+  {
+    stringstream text;
+    figure.saveScript(text);
+    job.fingerprint = getFingerprint(text.str());
+  } else {
+    job.fingerprint = getFingerprint(job.commands);
+  }
+  if(incremental && isCurrent(filename, job.fingerprint))
+  {
+    QUANT_COUNT("report.skipped", 1);
+    lock_guard<mutex> guard(lock);
+    skipped++;
+    return;
+  }
+  job.tag = getTagName(filename);
+  if(script)
+  {
+    // .gnuplot scripts need no session
+    QUANT_TIMER("report.render.gnuplot");
+    figure.saveScript(filename);
+    tag(job.tag, job.fingerprint);
+    return;
+  }
+  cerr << "save> " << filename << endl;
+  enqueue(job);
+}
+
+void Renderer::submit(const string& text)
+{
+  Job job;
+  job.commands = text;
+  job.format = "terminal";
+  job.fingerprint = 0;
+  enqueue(job);
+}
+
+void Renderer::enqueue(const Job& job)
+{
+  {
+    lock_guard<mutex> guard(lock);
+    jobs.push_back(job);
+  }
+  ready.notify_one();
+}
+
+size_t Renderer::getRendered()
+{
+  lock_guard<mutex> guard(lock);
+  return rendered;
+}
+
+size_t Renderer::getSkipped()
+{
+  lock_guard<mutex> guard(lock);
+  return skipped;
+}
+
+void Renderer::run()
+{
+  // a session that has exited fails the writes (EPIPE) of its worker,
+  // instead of raising a SIGPIPE that would end the process
+  sigset_t pipe;
+  sigemptyset(&pipe);
+  sigaddset(&pipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe, NULL);
+  Session session;
+  for(;;)
+  {
+    Job job;
+    {
+      unique_lock<mutex> guard(lock);
+      while(!stopping && jobs.empty()) ready.wait(guard);
+      if(jobs.empty()) break; // stopping, and the queue is drained
+      job = jobs.front();
+      jobs.pop_front();
+    }
+    // an output is tagged once gnuplot confirms it has rendered it
+    bool tagged = !job.tag.empty();
+    if(tagged) job.commands += CONFIRM;
+    // a failed session is closed, and the figure sent to a new one
+    bool delivered = false;
+    int error = 0;
+    for(int attempt=0; attempt<2 && !delivered; attempt++)
+    {
+      if(!session.isOpen() && !session.open())
+      {
+        cerr << "unable to start gnuplot" << endl;
+        break;
+      }
+      // time to deliver the figure (and render a tagged one)
+      QUANT_TIMER_NAMED("report.render."+job.format);
+      delivered = session.send(job.commands) && (!tagged || session.confirm(error));
+      if(!delivered)
+      {
+        cerr << "gnuplot session failed" << endl;
+        QUANT_COUNT("report.gnuplot.failed", 1);
+        session.close(true);
+      }
+    }
+    if(!delivered) continue;
+    if(tagged)
+    {
+      if(0==error) 
+      {
+        tag(job.tag, job.fingerprint);
+      } else {
+        // rendered again on the next run
+        cerr << "gnuplot failed to render a figure (error " << error << ")" << endl;
+        QUANT_COUNT("report.gnuplot.failed", 1);
+      }
+    }
+    lock_guard<mutex> guard(lock);
+    rendered++;
+  }
+  if(session.isOpen()) 
+  {
+    std::chrono::steady_clock::time_point started = session.started;
+    session.close(false);
+    QUANT_DURATION("report.gnuplot.session", std::chrono::steady_clock::now()-started);
+  }
+}
+
+// *EOF*
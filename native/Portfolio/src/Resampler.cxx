@@ -0,0 +1,209 @@
+// Resampler.cxx
+// Mac Radigan
+
+#include "Resampler.hxx"
+#include "RandomStream.hxx"
+#include "Portfolio.hxx"
+#include "Cholesky.hxx"
+#include "SmallKkt.hxx"
+#include "FactorModel.hxx"
+#include "ActiveSetSolver.hxx"
+#include "ThreadPool.hxx"
+#include "Kernels.hxx"
+#include "Instrumentation.hxx"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+
+USING_QUANT
+using namespace std;
+
+const size_t Resampler::BATCH_SIZE = 4;
+const size_t Resampler::DEFAULT_RESAMPLES = 1000;
+
+// per-worker scratch, sized on the first resample and reused
+struct Resampler::Scratch
+{
+  mat x;                                 // (M x N) resampled returns
+  mat mu;                                // (1 x N) mean returns
+  mat s;                                 // (N x N) covariance
+  mat sigma;                             // (1 x N) volatility
+  mat border;                            // (N x 2) [mu 1v]
+  mat y;                                 // (N x 2) S^-1*[mu 1v]
+  mat w1;                                // (1 x N) frontier basis
+  mat w0;
+  Cholesky cholesky;
+  FactorModel factors;
+  ActiveSetSolver qp;                    // warm started across resamples
+};
+
+Resampler::Resampler(const mat& returns, int nfactors)
+  : returns(returns), nfactors(nfactors), nresamples(DEFAULT_RESAMPLES), 
+    block(1), seed(1), nthreads(0)
+{
+}
+
+Resampler::~Resampler()
+{
+}
+
+void Resampler::setBounds(const vec& lower, const vec& upper)
+{
+  this->lower = lower;
+  this->upper = upper;
+}
+
+bool Resampler::resample(size_t idx, const vector<double>& targets, Scratch& scratch,
+                         double* weights, char* solved) const
+{
+  int ns = returns.n_rows;
+  int np = returns.n_cols;
+  int nt = targets.size();
+  // rows of the resample:  blocks of consecutive days, wrapping around
+  RandomStream stream(seed, idx);
+  mat& x = scratch.x;
+  x.set_size(ns, np);
+  for(int r=0; r<ns; ) 
+  {
+    int start = stream.uniform(ns);
+    for(int k=0; k<block && r<ns; k++, r++) 
+    {
+      int row = (start+k)%ns;
+      for(int c=0; c<np; c++) x(r,c) = returns(row,c);
+    }
+  }
+  // estimate:  sample covariance (Cholesky) or factor model (Woodbury)
+  scratch.mu.set_size(1, np);
+  scratch.sigma.set_size(1, np);
+  bool bounded = !lower.is_empty();
+  if(0==nfactors) 
+  {
+    scratch.s.set_size(np, np);
+    Kernels::moments(x.memptr(), ns, np, scratch.mu.memptr(), 
+                     scratch.s.memptr(), scratch.sigma.memptr());
+  } else {
+    for(int c=0; c<np; c++) 
+    {
+      const double* xc = x.colptr(c);
+      double sum = 0;
+      for(int r=0; r<ns; r++) sum += xc[r];
+      scratch.mu(0,c) = sum/ns;
+    }
+    scratch.factors.estimate(x, nfactors);
+    if(bounded) scratch.s = scratch.factors.getCovariance();
+  }
+  std::fill(solved, solved+nt, 0);
+  if(bounded) 
+  {
+    scratch.qp.setProblem(scratch.s, scratch.mu, lower, upper);
+    for(int t=0; t<nt; t++) 
+    {
+      try 
+      {
+        vec w = scratch.qp.solve(targets[t]);
+        for(int c=0; c<np; c++) weights[t*np+c] = w[c];
+        solved[t] = 1;
+      } catch(runtime_error& e) {
+        // not attainable within the bounds in this resample
+        scratch.qp.reset();
+      }
+    }
+    return true;
+  }
+  // unbounded:  every target is on the basis, w = mu_opt*w1+w0
+  // (small portfolios by the fixed-size solve, unless S is singular)
+  if(nfactors>0 || !SmallKkt::basis(scratch.s, scratch.mu, scratch.w1, scratch.w0)) 
+  {
+    scratch.border.set_size(np, 2);
+    for(int c=0; c<np; c++) 
+    {
+      scratch.border(c,0) = scratch.mu(0,c);
+      scratch.border(c,1) = 1.0;
+    }
+    if(0==nfactors) 
+    {
+      scratch.cholesky.factor(scratch.s);
+      scratch.cholesky.solve(scratch.border, scratch.y);
+    } else {
+      scratch.y = scratch.factors.solve(scratch.border);
+    }
+    Portfolio::schurBasis(scratch.border, scratch.y, scratch.w1, scratch.w0);
+  }
+  for(int t=0; t<nt; t++) 
+  {
+    for(int c=0; c<np; c++) weights[t*np+c] = targets[t]*scratch.w1(0,c) + scratch.w0(0,c);
+    solved[t] = 1;
+  }
+  return true;
+}
+
+mat Resampler::run(const vector<double>& targets, vector<size_t>& count) const
+{
+  QUANT_TIMER("portfolio.resample");
+  int ns = returns.n_rows;
+  int np = returns.n_cols;
+  int nt = targets.size();
+  if(nresamples<1) throw runtime_error("Resampling requires at least one resample.");
+  if(ns<2 || np<2) throw runtime_error("Resampling requires at least two stocks and two dates.");
+  const double* data = returns.memptr();
+  if(count_if(data, data+returns.n_elem, [](double v) { return isnan(v); })>0) 
+  {
+    throw runtime_error("Resampling requires complete returns (missing data drop or ffill).");
+  }
+  if(!lower.is_empty() && (lower.n_elem!=np || upper.n_elem!=np)) 
+  {
+    throw runtime_error("Inconsistent dimensions for the constrained portfolio.");
+  }
+  // weights of every resample, reduced in resample order afterwards
+  vector<double> weights(nresamples*nt*np);
+  vector<char> solved(nresamples*nt, 0);
+  atomic<size_t> next(0);
+  {
+    int nworkers = nthreads>0 ? nthreads : ThreadPool::concurrency();
+    nworkers = static_cast<int>(min<size_t>(nworkers, (nresamples+BATCH_SIZE-1)/BATCH_SIZE));
+    ThreadPool pool(nworkers);
+    for(int wIdx=0; wIdx<nworkers; wIdx++) 
+    {
+      pool.submit([this,&targets,&weights,&solved,&next,nt,np]() {
+        Scratch scratch;
+        for(;;) 
+        {
+          size_t first = next.fetch_add(BATCH_SIZE);
+          if(first>=nresamples) break;
+          size_t last = min(first+BATCH_SIZE, nresamples);
+          for(size_t idx=first; idx<last; idx++) 
+          {
+            try 
+            {
+              resample(idx, targets, scratch, &weights[idx*nt*np], &solved[idx*nt]);
+            } catch(exception& e) {
+              // degenerate resample (e.g. a repeated day):  not counted
+              std::fill(&solved[idx*nt], &solved[idx*nt]+nt, 0);
+            }
+          }
+        }
+      });
+    }
+  }
+  QUANT_COUNT("resample.count", nresamples);
+  mat average(nt, np, fill::zeros);
+  count.assign(nt, 0);
+  for(size_t idx=0; idx<nresamples; idx++) 
+  {
+    for(int t=0; t<nt; t++) 
+    {
+      if(!solved[idx*nt+t]) continue;
+      const double* w = &weights[(idx*nt+t)*np];
+      for(int c=0; c<np; c++) average(t,c) += w[c];
+      count[t]++;
+    }
+  }
+  for(int t=0; t<nt; t++) 
+  {
+    for(int c=0; c<np && count[t]>0; c++) average(t,c) /= count[t];
+  }
+  return average;
+}
+
+// *EOF*
@@ -2,18 +2,29 @@
 // Mac Radigan
 
 #include "Series.hxx"
+#include "MappedFile.hxx"
+#include "Kernels.hxx"
+#include "Instrumentation.hxx"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
 #include <iterator>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <boost/foreach.hpp>
 
 USING_QUANT
 using namespace std;
 
+bool Series::useSidecar = true;
+
 Series::Series() 
+  : parsed(0), inode(0), recent(0)
 {
 }
 
@@ -32,6 +43,25 @@ Series::Series(const Series &series)
   volume    = series.volume;
   adj_close = series.adj_close;
   rreturn   = series.rreturn;
+  parsed    = series.parsed;
+  inode     = series.inode;
+  recent    = series.recent;
+}
+
+Series::Series(Series &&series)
+  : symbol(std::move(series.symbol)),
+    date(std::move(series.date)),
+    close(std::move(series.close)),
+    open(std::move(series.open)),
+    high(std::move(series.high)),
+    low(std::move(series.low)),
+    volume(std::move(series.volume)),
+    adj_close(std::move(series.adj_close)),
+    rreturn(std::move(series.rreturn)),
+    parsed(series.parsed),
+    inode(series.inode),
+    recent(series.recent)
+{
 }
 
 int Series::operator<(const Series &rhs) const
@@ -43,6 +73,8 @@ int Series::operator<(const Series &rhs) const
 
 Series& Series::operator=(const Series &rhs)
 {
+  if(this==&rhs) return *this;
+  this->csv.clear();
   this->symbol    = rhs.symbol;
   this->date      = rhs.date;
   this->close     = rhs.close;
@@ -52,6 +84,28 @@ Series& Series::operator=(const Series &rhs)
   this->volume    = rhs.volume;
   this->adj_close = rhs.adj_close;
   this->rreturn   = rhs.rreturn;
+  this->parsed    = rhs.parsed;
+  this->inode     = rhs.inode;
+  this->recent    = rhs.recent;
+  return *this;
+}
+
+Series& Series::operator=(Series &&rhs)
+{
+  if(this==&rhs) return *this;
+  this->csv.clear();
+  this->symbol    = std::move(rhs.symbol);
+  this->date      = std::move(rhs.date);
+  this->close     = std::move(rhs.close);
+  this->open      = std::move(rhs.open);
+  this->high      = std::move(rhs.high);
+  this->low       = std::move(rhs.low);
+  this->volume    = std::move(rhs.volume);
+  this->adj_close = std::move(rhs.adj_close);
+  this->rreturn   = std::move(rhs.rreturn);
+  this->parsed    = rhs.parsed;
+  this->inode     = rhs.inode;
+  this->recent    = rhs.recent;
   return *this;
 }
 
@@ -69,14 +123,20 @@ int Series::operator==(const Series &rhs) const
   return 1;
 }
 
-string Series::getAsCsv(int nsamples) const 
+const string& Series::getAsCsv(int nsamples) const 
 {
+  lock_guard<mutex> guard(csvLock);
+  // no more records than the series holds
+  nsamples = min<int>(nsamples, date.size());
+  map<int,string>::iterator it = csv.find(nsamples);
+  if(csv.end()!=it) return it->second;
   stringstream ss;
   for(int idx=1; idx<nsamples; idx++) 
   {
     char strdate[11];
     time_t t = date.at(idx);
-    strftime(strdate,11,"%Y-%m-%d",localtime(&t));
+    struct tm tm;
+    strftime(strdate,11,"%Y-%m-%d",gmtime_r(&t,&tm));
     ss << strdate << ","
        << close.at(idx) << ","
        << open.at(idx) << ","
@@ -86,13 +146,417 @@ string Series::getAsCsv(int nsamples) const
        << adj_close.at(idx)
        << endl;
   }
-  return *(new string(ss.str()));
+  // map nodes are stable, the reference outlives the lock
+  return csv[nsamples] = ss.str();
+}
+
+namespace {
+
+// powers of ten exactly representable as a double
+const double pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit(char c) { return c>='0' && c<='9'; }
+
+// days since 1970-01-01 of a proleptic Gregorian civil date
+inline long daysFromCivil(long y, unsigned m, unsigned d)
+{
+  y -= m<=2;
+  const long era = (y>=0 ? y : y-399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era*400);
+  const unsigned doy = (153*(m>2 ? m-3 : m+9) + 2)/5 + d-1;
+  const unsigned doe = yoe*365 + yoe/4 - yoe/100 + doy;
+  return era*146097 + static_cast<long>(doe) - 719468;
+}
+
+// parse an ISO date (YYYY-MM-DD) as UTC midnight
+inline bool parseDate(const char*& p, const char* end, time_t& t)
+{
+  if(end-p<10) return false;
+  for(int idx=0; idx<10; idx++) {
+    if(4==idx || 7==idx) { if('-'!=p[idx]) return false; }
+    else if(!isDigit(p[idx])) return false;
+  }
+  long     y = (p[0]-'0')*1000 + (p[1]-'0')*100 + (p[2]-'0')*10 + (p[3]-'0');
+  unsigned m = (p[5]-'0')*10 + (p[6]-'0');
+  unsigned d = (p[8]-'0')*10 + (p[9]-'0');
+  if(m<1 || m>12 || d<1 || d>31) return false;
+  t = static_cast<time_t>(daysFromCivil(y,m,d))*86400;
+  p += 10;
+  return true;
+}
+
+// parse a decimal number; mantissas of up to 19 digits scaled by an
+// exactly representable power of ten are correctly rounded, anything
+// else is handed to strtod
+inline bool parseDouble(const char*& p, const char* end, double& x)
+{
+  const char* q = p;
+  bool negative = false;
+  if(q<end && ('-'==*q || '+'==*q)) { negative = '-'==*q; q++; }
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int scale = 0;
+  const char* first = q;
+  while(q<end && isDigit(*q)) {
+    if(digits<19) { mantissa = mantissa*10 + (*q-'0'); digits += mantissa>0; }
+    else scale++;
+    q++;
+  }
+  if(q<end && '.'==*q) {
+    q++;
+    while(q<end && isDigit(*q)) {
+      if(digits<19) { mantissa = mantissa*10 + (*q-'0'); digits += mantissa>0; scale--; }
+      q++;
+    }
+  }
+  if(q==first || (q==first+1 && '.'==*first)) return false;
+  if((q<end && ('e'==*q || 'E'==*q)) || scale<-22 || scale>22 || digits>=19
+     || mantissa>(1ULL<<53)) {
+    // slow path: exponents and long mantissas
+    char buffer[64];
+    const char* stop = q;
+    if(stop<end && ('e'==*stop || 'E'==*stop)) {
+      stop++;
+      if(stop<end && ('-'==*stop || '+'==*stop)) stop++;
+      while(stop<end && isDigit(*stop)) stop++;
+    }
+    size_t n = stop-p;
+    if(n>=sizeof(buffer)) return false;
+    memcpy(buffer,p,n); buffer[n] = '\0';
+    x = strtod(buffer,NULL);
+    p = stop;
+    return true;
+  }
+  double v = static_cast<double>(mantissa);
+  v = scale<0 ? v/pow10[-scale] : v*pow10[scale];
+  x = negative ? -v : v;
+  p = q;
+  return true;
+}
+
+inline bool parseInt(const char*& p, const char* end, int& x)
+{
+  const char* q = p;
+  bool negative = false;
+  if(q<end && '-'==*q) { negative = true; q++; }
+  long long v = 0;
+  const char* first = q;
+  while(q<end && isDigit(*q)) { v = v*10 + (*q-'0'); q++; }
+  if(q==first) return false;
+  // some feeds write the volume as a decimal number
+  if(q<end && '.'==*q) { q++; while(q<end && isDigit(*q)) q++; }
+  x = static_cast<int>(negative ? -v : v);
+  p = q;
+  return true;
+}
+
+inline bool expect(const char*& p, const char* end, char c)
+{
+  if(p<end && c==*p) { p++; return true; }
+  return false;
+}
+
+// insert records [from,to) of a column before (front) or after the records
+template <class Column>
+inline void splice(Column& column, const Column& tail, size_t from, size_t to, bool front)
+{
+  column.insert(front ? column.begin() : column.end(), tail.begin()+from, tail.begin()+to);
+}
+
+// reorder the records of a column, the record order[k] moving to k
+template <class Column>
+inline void permute(Column& column, const vector<size_t>& order)
+{
+  Column permuted(order.size());
+  for(size_t idx=0; idx<order.size(); idx++) permuted[idx] = column[order[idx]];
+  column.swap(permuted);
+}
+
 }
 
-void Series::load(string symbol, string filename) 
+void Series::load(string symbol, string filename, size_t nrecords) 
 {
+  QUANT_TIMER("series.load");
   this->symbol = symbol;
-  vector<string> results;
+  csv.clear();
+  recent = 0;
+  // every record is loaded again
+  date.clear();
+  open.clear();
+  high.clear();
+  low.clear();
+  close.clear();
+  volume.clear();
+  adj_close.clear();
+  struct stat st;
+  if(stat(filename.c_str(),&st)<0) {
+    string msg = "Unable to open file: ";
+    msg+=filename;
+    throw runtime_error(msg);
+  }
+  inode = st.st_ino;
+  QUANT_COUNT("series.load.bytes", st.st_size);
+  if(useSidecar) 
+  {
+    // a sidecar is valid only for the exact CSV it was built from
+    string sidecar = getSidecarName(filename);
+    if(loadSidecar(sidecar,st)) 
+    {
+      parsed = st.st_size;
+      QUANT_COUNT("series.load.sidecar", 1);
+      QUANT_COUNT("series.load.rows", date.size());
+      return;
+    }
+    parseCsv(filename, nrecords);
+    // a sidecar holds every record
+    if(0==recent) saveSidecar(sidecar,st);
+  } else {
+    parseCsv(filename, nrecords);
+  }
+  QUANT_COUNT("series.load.rows", date.size());
+}
+
+void Series::parseCsv(string filename, size_t nrecords) 
+{
+  MappedFile file(filename);
+  const char* p   = file.begin();
+  const char* end = file.end();
+  // skip the header line:  Date,Open,High,Low,Close,Volume,Adj Close
+  const char* eol = p ? static_cast<const char*>(memchr(p,'\n',end-p)) : NULL;
+  p = eol ? eol+1 : end;
+  const char* stop = end;
+  if(nrecords>0) 
+  {
+    // the end of the newest nrecords lines (blank lines are not counted)
+    size_t nlines = 0;
+    const char* q = p;
+    while(q<end && nlines<nrecords) 
+    {
+      const char* nl = static_cast<const char*>(memchr(q,'\n',end-q));
+      if(q<(nl ? nl : end) && '\r'!=*q) nlines++;
+      q = nl ? nl+1 : end;
+    }
+    // records of the head must be newer than the last record of the
+    // file:  an oldest first file is parsed in full
+    time_t first;
+    time_t last;
+    const char* r = p;
+    const char* tail = end;
+    while(tail>q && ('\n'==tail[-1] || '\r'==tail[-1])) tail--;
+    const char* nl = tail>q ? static_cast<const char*>(memrchr(q,'\n',tail-q)) : NULL;
+    tail = nl ? nl+1 : q;
+    if(q<end && nlines==nrecords && parseDate(r,end,first) 
+       && parseDate(tail,end,last) && first>last) 
+    {
+      stop = q;
+      recent = nlines;
+      QUANT_COUNT("series.load.partial", 1);
+    }
+  }
+  parseRecords(file.begin(), p, stop, filename);
+  normalize();
+  parsed = file.size();
+  computeReturns();
+}
+
+void Series::parseRecords(const char* origin, const char* p, const char* end,
+                          const string& filename) 
+{
+  // one record per line, reserve the columns up front
+  size_t nrows = 0;
+  for(const char* q=p; q<end; nrows++) {
+    const char* nl = static_cast<const char*>(memchr(q,'\n',end-q));
+    q = nl ? nl+1 : end;
+  }
+  date.reserve(date.size()+nrows);
+  open.reserve(open.size()+nrows);
+  high.reserve(high.size()+nrows);
+  low.reserve(low.size()+nrows);
+  close.reserve(close.size()+nrows);
+  volume.reserve(volume.size()+nrows);
+  adj_close.reserve(adj_close.size()+nrows);
+  while(p<end) 
+  {
+    if('\n'==*p || '\r'==*p) { p++; continue; } // blank line
+    const char* record = p;
+    time_t b_date;
+    double b_close;
+    double b_open;
+    double b_high;
+    double b_low;
+    int    b_volume;
+    double b_adj_close;
+    if(!( parseDate(p,end,b_date)          && expect(p,end,',')
+       && parseDouble(p,end,b_open)        && expect(p,end,',')
+       && parseDouble(p,end,b_high)        && expect(p,end,',')
+       && parseDouble(p,end,b_low)         && expect(p,end,',')
+       && parseDouble(p,end,b_close)       && expect(p,end,',')
+       && parseInt(p,end,b_volume)         && expect(p,end,',')
+       && parseDouble(p,end,b_adj_close) )) 
+    {
+      stringstream msg;
+      msg << "Malformed record at line " << 1+count(origin,record,'\n') 
+          << " of file: " << filename;
+      throw runtime_error(msg.str());
+    }
+    date.push_back(b_date);
+    open.push_back(b_open);
+    high.push_back(b_high);
+    low.push_back(b_low);
+    close.push_back(b_close);
+    volume.push_back(b_volume);
+    adj_close.push_back(b_adj_close);
+    const char* eol = static_cast<const char*>(memchr(p,'\n',end-p));
+    p = eol ? eol+1 : end;
+  }
+}
+
+void Series::normalize() 
+{
+  size_t n = date.size();
+  bool descending = true;
+  bool ascending = true;
+  for(size_t idx=1; idx<n; idx++) 
+  {
+    if(date[idx]>=date[idx-1]) descending = false;
+    if(date[idx]<=date[idx-1]) ascending = false;
+  }
+  if(descending) return;
+  if(ascending) 
+  {
+    reverse();
+    return;
+  }
+  // neither:  sort newest first, keeping the first record of a date
+  QUANT_COUNT("series.load.sorted", 1);
+  vector<size_t> order(n);
+  for(size_t idx=0; idx<n; idx++) order[idx] = idx;
+  const TimeColumn& d = date;
+  stable_sort(order.begin(), order.end(), 
+              [&d](size_t a, size_t b) { return d[a]>d[b]; });
+  order.erase(unique(order.begin(), order.end(), 
+                     [&d](size_t a, size_t b) { return d[a]==d[b]; }), order.end());
+  permute(date, order);
+  permute(open, order);
+  permute(high, order);
+  permute(low, order);
+  permute(close, order);
+  permute(volume, order);
+  permute(adj_close, order);
+}
+
+void Series::reverse() 
+{
+  std::reverse(date.begin(), date.end());
+  std::reverse(open.begin(), open.end());
+  std::reverse(high.begin(), high.end());
+  std::reverse(low.begin(), low.end());
+  std::reverse(close.begin(), close.end());
+  std::reverse(volume.begin(), volume.end());
+  std::reverse(adj_close.begin(), adj_close.end());
+}
+
+bool Series::isStale(const string& filename) const 
+{
+  struct stat st;
+  if(stat(filename.c_str(),&st)<0) return true;
+  return st.st_ino!=inode || st.st_size!=parsed;
+}
+
+size_t Series::update(const string& filename) 
+{
+  QUANT_TIMER("series.update");
+  struct stat st;
+  if(stat(filename.c_str(),&st)<0) {
+    string msg = "Unable to open file: ";
+    msg+=filename;
+    throw runtime_error(msg);
+  }
+  if(recent>0) 
+  {
+    // a partial series:  reload the newest records
+    if(st.st_ino==inode && st.st_size==parsed) return 0;
+    Series reloaded;
+    reloaded.load(symbol, filename, recent);
+    size_t added = 0;
+    if(!date.empty()) {
+      while(added<reloaded.date.size() && reloaded.date[added]>date.front()) added++;
+    } else {
+      added = reloaded.date.size();
+    }
+    *this = std::move(reloaded);
+    return added;
+  }
+  if(st.st_ino!=inode || st.st_size<parsed || 0==parsed) 
+  {
+    // replaced or truncated:  reload
+    Series reloaded;
+    reloaded.load(symbol, filename);
+    *this = std::move(reloaded);
+    return date.size();
+  }
+  if(st.st_size==parsed) return 0;
+  MappedFile file(filename);
+  if(file.size()<=static_cast<size_t>(parsed)) return 0;
+  // only complete lines, a writer may be part way through the last one
+  const char* begin = file.begin()+parsed;
+  const char* last = static_cast<const char*>(memrchr(begin,'\n',file.end()-begin));
+  if(NULL==last) return 0;
+  // the parsed bytes end on a line, unless the file was rewritten in place
+  bool appended = '\n'==begin[-1];
+  Series tail;
+  if(appended) 
+  {
+    try 
+    {
+      tail.parseRecords(file.begin(), begin, last+1, filename);
+    } catch(runtime_error& e) {
+      appended = false;
+    }
+  }
+  // appended records (in any order, as a load orders them) are either 
+  // newer than every loaded record or older (history)
+  tail.normalize();
+  size_t from = 0;
+  size_t to = tail.date.size();
+  if(to>0 && !date.empty()) 
+  {
+    // a boundary record written again by the feed is skipped
+    if(tail.date[to-1]==date.front()) to--;
+    else if(tail.date[from]==date.back()) from++;
+  }
+  bool newer = from==to || date.empty() || tail.date[to-1]>date.front();
+  bool older = from<to && !date.empty() && tail.date[from]<date.back();
+  if(!appended || !(newer || older)) 
+  {
+    // rewritten or out of order:  reload
+    Series reloaded;
+    reloaded.load(symbol, filename);
+    *this = std::move(reloaded);
+    return date.size();
+  }
+  splice(date, tail.date, from, to, newer);
+  splice(open, tail.open, from, to, newer);
+  splice(high, tail.high, from, to, newer);
+  splice(low, tail.low, from, to, newer);
+  splice(close, tail.close, from, to, newer);
+  splice(volume, tail.volume, from, to, newer);
+  splice(adj_close, tail.adj_close, from, to, newer);
+  computeReturns();
+  csv.clear();
+  parsed = last+1-file.begin();
+  if(useSidecar && st.st_size==parsed) saveSidecar(getSidecarName(filename),st);
+  QUANT_COUNT("series.update.rows", to-from);
+  return to-from;
+}
+
+void Series::loadStream(string symbol, string filename) 
+{
+  this->symbol = symbol;
+  csv.clear();
   string line;
   string header;
   ifstream file(filename.c_str());
@@ -102,38 +566,260 @@ void Series::load(string symbol, string filename)
     throw runtime_error(msg);
   }
   // allocate buffers for reading
-  char  *b_date = (char*)calloc(11,sizeof(char));
+  char   b_date[11] = { 0 };
   double b_close;
   double b_open;
   double b_high;
   double b_low;
   int    b_volume;
   double b_adj_close;
-  double b_rreturn;
   getline(file,header);
   while(getline(file,line)) 
   {
     sscanf(line.c_str(),"%10c,%lf,%lf,%lf,%lf,%d,%lf\n",
       b_date,&b_open,&b_high,&b_low,&b_close,&b_volume,&b_adj_close);
     struct tm t;
+    memset(&t,0,sizeof(t));
     strptime(b_date,"%Y-%m-%d",&t);
-    date.push_back(mktime(&t));
+    date.push_back(timegm(&t));
     open.push_back(b_open);
     high.push_back(b_high);
     low.push_back(b_low);
     close.push_back(b_close);
     volume.push_back(b_volume);
     adj_close.push_back(b_adj_close);
-    /* fprintf(stdout,"%s\t%f\t%f,%f\t%f\t%d\t%f\n",
-         b_date,b_close,b_open,b_high,b_low,b_volume,b_adj_close); */
   }
+  file.close();
+  normalize();
+  computeReturns();
+}
+
+void Series::computeReturns() 
+{
   // rate of return (daily):
   //   r[n] = ( c[n]-c[n-1] ) / c[n-1]  with c closing price
-  for(int idx=0; idx<close.size()-1; idx++) 
+  //   (records are ordered newest first)
+  rreturn.clear();
+  if(close.size()<2) return;
+  rreturn.resize(close.size()-1);
+  Kernels::simpleReturns(&close[0], close.size(), &rreturn[0]);
+}
+
+void Series::getLogReturn(DoubleColumn& r) const 
+{
+  r.clear();
+  if(close.size()<2) return;
+  r.resize(close.size()-1);
+  Kernels::logReturns(&close[0], close.size(), &r[0]);
+}
+
+void Series::getAdjReturn(DoubleColumn& r) const 
+{
+  // rate of return net of splits and dividends
+  r.clear();
+  if(adj_close.size()<2) return;
+  r.resize(adj_close.size()-1);
+  Kernels::simpleReturns(&adj_close[0], adj_close.size(), &r[0]);
+}
+
+void Series::getRollingMean(int window, DoubleColumn& y) const 
+{
+  y.clear();
+  if(window<1 || rreturn.size()<static_cast<size_t>(window)) return;
+  y.resize(rreturn.size()-window+1);
+  Kernels::rollingMean(&rreturn[0], rreturn.size(), window, &y[0]);
+}
+
+void Series::getRollingVolatility(int window, DoubleColumn& y) const 
+{
+  y.clear();
+  if(window<2 || rreturn.size()<static_cast<size_t>(window)) return;
+  y.resize(rreturn.size()-window+1);
+  Kernels::rollingVolatility(&rreturn[0], rreturn.size(), window, &y[0]);
+}
+
+namespace {
+
+//
+// binary sidecar layout (native byte order):
+//
+//   SidecarHeader         fixed 256 byte header
+//   date[rows]            int64  seconds since epoch (UTC)
+//   open[rows]            double
+//   high[rows]            double
+//   low[rows]             double
+//   close[rows]           double
+//   volume[rows]          int32
+//   adj_close[rows]       double
+//   rreturn[rows-1]       double
+//
+// every column starts on a SIDECAR_ALIGNMENT byte boundary
+//
+const char     SIDECAR_MAGIC[8]  = { 'Q','S','E','R','I','E','S','\0' };
+const uint32_t SIDECAR_VERSION   = 2;    // 2: records newest first
+const uint32_t SIDECAR_BYTEORDER = 0x01020304;
+const size_t   SIDECAR_ALIGNMENT = 64;
+enum { COL_DATE, COL_OPEN, COL_HIGH, COL_LOW, COL_CLOSE, 
+       COL_VOLUME, COL_ADJ_CLOSE, COL_RRETURN, NCOLUMNS };
+
+struct SidecarHeader 
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteorder;
+  uint64_t rows;
+  uint64_t nreturns;
+  int64_t  source_mtime_sec;      // st_mtime of the source CSV
+  int64_t  source_mtime_nsec;
+  uint64_t source_size;           // st_size of the source CSV
+  uint64_t offset[NCOLUMNS];      // byte offset of each column
+  uint64_t length[NCOLUMNS];      // byte length of each column
+  char     reserved[256-56-16*NCOLUMNS];
+};
+static_assert(256==sizeof(SidecarHeader), "sidecar header must be 256 bytes");
+
+inline size_t align(size_t n) 
+{
+  return (n+SIDECAR_ALIGNMENT-1) & ~(SIDECAR_ALIGNMENT-1);
+}
+
+inline int64_t mtimeNsec(const struct stat& st) 
+{
+  return static_cast<int64_t>(st.st_mtim.tv_nsec);
+}
+
+bool writeFully(FILE* fp, const void* p, size_t n, size_t& position) 
+{
+  if(n>0 && 1!=fwrite(p,n,1,fp)) return false;
+  position += n;
+  return true;
+}
+
+bool pad(FILE* fp, size_t& position) 
+{
+  static const char zeros[SIDECAR_ALIGNMENT] = { 0 };
+  return writeFully(fp, zeros, align(position)-position, position);
+}
+
+}
+
+string Series::getSidecarName(const string& filename) 
+{
+  // <database>/<SYM>/<SYM>.csv  -->  <database>/<SYM>/<SYM>.qbin
+  size_t slash = filename.rfind('/');
+  size_t dot = filename.rfind('.');
+  if(string::npos!=dot && (string::npos==slash || dot>slash)) 
   {
-    rreturn.push_back( (close.at(idx)-close.at(idx+1))/close.at(idx+1) );
+    return filename.substr(0,dot) + ".qbin";
   }
-  file.close();
+  return filename + ".qbin";
+}
+
+bool Series::loadSidecar(const string& sidecar, const struct stat& source) 
+{
+  if(access(sidecar.c_str(),R_OK)<0) return false;
+  try 
+  {
+    MappedFile file(sidecar);
+    if(file.size()<sizeof(SidecarHeader)) return false;
+    const SidecarHeader* h = reinterpret_cast<const SidecarHeader*>(file.begin());
+    if(0!=memcmp(h->magic,SIDECAR_MAGIC,sizeof(SIDECAR_MAGIC))) return false;
+    if(SIDECAR_VERSION!=h->version || SIDECAR_BYTEORDER!=h->byteorder) return false;
+    if(static_cast<uint64_t>(source.st_size)!=h->source_size) return false;
+    if(static_cast<int64_t>(source.st_mtime)!=h->source_mtime_sec) return false;
+    if(mtimeNsec(source)!=h->source_mtime_nsec) return false;
+    const size_t widths[NCOLUMNS] = { 
+      sizeof(int64_t), sizeof(double), sizeof(double), sizeof(double), 
+      sizeof(double), sizeof(int32_t), sizeof(double), sizeof(double) };
+    for(int col=0; col<NCOLUMNS; col++) 
+    {
+      uint64_t n = COL_RRETURN==col ? h->nreturns : h->rows;
+      if(h->length[col]!=n*widths[col]) return false;
+      if(h->offset[col]%SIDECAR_ALIGNMENT) return false;
+      if(h->offset[col]+h->length[col]>file.size()) return false;
+    }
+    const size_t n = h->rows;
+    const char* base = file.begin();
+    const int64_t* p_date = reinterpret_cast<const int64_t*>(base+h->offset[COL_DATE]);
+    date.assign(p_date, p_date+n);
+    const double* p_open = reinterpret_cast<const double*>(base+h->offset[COL_OPEN]);
+    open.assign(p_open, p_open+n);
+    const double* p_high = reinterpret_cast<const double*>(base+h->offset[COL_HIGH]);
+    high.assign(p_high, p_high+n);
+    const double* p_low = reinterpret_cast<const double*>(base+h->offset[COL_LOW]);
+    low.assign(p_low, p_low+n);
+    const double* p_close = reinterpret_cast<const double*>(base+h->offset[COL_CLOSE]);
+    close.assign(p_close, p_close+n);
+    const int32_t* p_volume = reinterpret_cast<const int32_t*>(base+h->offset[COL_VOLUME]);
+    volume.assign(p_volume, p_volume+n);
+    const double* p_adj_close = reinterpret_cast<const double*>(base+h->offset[COL_ADJ_CLOSE]);
+    adj_close.assign(p_adj_close, p_adj_close+n);
+    const double* p_rreturn = reinterpret_cast<const double*>(base+h->offset[COL_RRETURN]);
+    rreturn.assign(p_rreturn, p_rreturn+h->nreturns);
+  } catch(runtime_error& e) {
+    return false;
+  }
+  return true;
+}
+
+bool Series::saveSidecar(const string& sidecar, const struct stat& source) const 
+{
+  // the sidecar is an optimization only:  failure to write it 
+  // (e.g. a read-only database) is not an error
+  SidecarHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,SIDECAR_MAGIC,sizeof(SIDECAR_MAGIC));
+  h.version           = SIDECAR_VERSION;
+  h.byteorder         = SIDECAR_BYTEORDER;
+  h.rows              = date.size();
+  h.nreturns          = rreturn.size();
+  h.source_mtime_sec  = static_cast<int64_t>(source.st_mtime);
+  h.source_mtime_nsec = mtimeNsec(source);
+  h.source_size       = static_cast<uint64_t>(source.st_size);
+  h.length[COL_DATE]      = h.rows*sizeof(int64_t);
+  h.length[COL_OPEN]      = h.rows*sizeof(double);
+  h.length[COL_HIGH]      = h.rows*sizeof(double);
+  h.length[COL_LOW]       = h.rows*sizeof(double);
+  h.length[COL_CLOSE]     = h.rows*sizeof(double);
+  h.length[COL_VOLUME]    = h.rows*sizeof(int32_t);
+  h.length[COL_ADJ_CLOSE] = h.rows*sizeof(double);
+  h.length[COL_RRETURN]   = h.nreturns*sizeof(double);
+  size_t position = align(sizeof(h));
+  for(int col=0; col<NCOLUMNS; col++) 
+  {
+    h.offset[col] = position;
+    position = align(position+h.length[col]);
+  }
+  // time_t is not guaranteed to be 64 bits wide
+  vector<int64_t> dates(date.begin(), date.end());
+  const void* columns[NCOLUMNS] = {
+    dates.empty() ? NULL : &dates[0],
+    open.empty() ? NULL : &open[0],
+    high.empty() ? NULL : &high[0],
+    low.empty() ? NULL : &low[0],
+    close.empty() ? NULL : &close[0],
+    volume.empty() ? NULL : &volume[0],
+    adj_close.empty() ? NULL : &adj_close[0],
+    rreturn.empty() ? NULL : &rreturn[0] };
+  // write to a temporary file and rename, so that concurrent 
+  // readers never observe a partially written sidecar
+  stringstream temporary;
+  temporary << sidecar << ".tmp." << getpid();
+  FILE* fp = fopen(temporary.str().c_str(),"wb");
+  if(NULL==fp) return false;
+  position = 0;
+  bool ok = writeFully(fp,&h,sizeof(h),position) && pad(fp,position);
+  for(int col=0; ok && col<NCOLUMNS; col++) 
+  {
+    ok = writeFully(fp,columns[col],h.length[col],position) && pad(fp,position);
+  }
+  ok = (0==fclose(fp)) && ok;
+  if(!ok || rename(temporary.str().c_str(),sidecar.c_str())<0) 
+  {
+    unlink(temporary.str().c_str());
+    return false;
+  }
+  return true;
 }
 
 // *EOF*
@@ -0,0 +1,130 @@
+// SeriesCache.cxx
+// Mac Radigan
+
+#include "SeriesCache.hxx"
+#include <stdexcept>
+#include <sstream>
+
+USING_QUANT
+using namespace std;
+
+SeriesCache::SeriesCache() 
+{
+}
+
+SeriesCache::~SeriesCache() 
+{
+}
+
+SeriesPtr SeriesCache::get(string symbol, string filename, size_t nrecords) 
+{
+  function<void(Series&)> read = [&](Series& series) { series.load(symbol,filename,nrecords); };
+  SeriesPtr series = load(filename, read);
+  // a partial series of fewer records is replaced
+  while(!series->covers(nrecords)) series = replace(filename, series, read);
+  return series;
+}
+
+SeriesPtr SeriesCache::get(string symbol, const PanelStore& store, time_t first, time_t last) 
+{
+  ostringstream key;
+  key << store.getFilename() << "#" << symbol << "@" << first << ":" << last;
+  return load(key.str(), [&](Series& series) { store.read(symbol, first, last, series); });
+}
+
+shared_ptr<const PanelStore> SeriesCache::getStore(const string& filename) 
+{
+  lock_guard<mutex> guard(lock);
+  shared_ptr<const PanelStore>& store = stores[filename];
+  if(!store) store.reset(new PanelStore(filename));
+  return store;
+}
+
+SeriesPtr SeriesCache::load(const string& key, const function<void(Series&)>& read) 
+{
+  promise<SeriesPtr> loader;
+  entry_type entry;
+  bool owner = false;
+  {
+    lock_guard<mutex> guard(lock);
+    map<string,entry_type>::iterator it = entries.find(key);
+    if(entries.end()!=it) 
+    {
+      entry = it->second;
+    } else {
+      entry = loader.get_future().share();
+      entries.insert(make_pair(key,entry));
+      owner = true;
+    }
+  }
+  if(owner) 
+  {
+    // load outside of the lock, so that distinct files load concurrently
+    try 
+    {
+      shared_ptr<Series> series(new Series());
+      read(*series);
+      loader.set_value(series);
+    } catch(...) {
+      {
+        // a failed load is not kept, the next caller loads again;  the
+        // entry is still this pending one (only a ready entry is replaced)
+        lock_guard<mutex> guard(lock);
+        entries.erase(key);
+      }
+      loader.set_exception(current_exception());
+    }
+  }
+  // waits for the owner's load, rethrows its exception on failure
+  return entry.get();
+}
+
+SeriesPtr SeriesCache::refresh(string symbol, string filename) 
+{
+  // the cached series, whether partial or not
+  SeriesPtr current = load(filename, [&](Series& series) { series.load(symbol,filename); });
+  if(!current->isStale(filename)) return current;
+  return replace(filename, current, [&](Series& series) { series.update(filename); });
+}
+
+SeriesPtr SeriesCache::replace(const string& key, const SeriesPtr& current,
+                               const function<void(Series&)>& update) 
+{
+  promise<SeriesPtr> loader;
+  entry_type entry;
+  bool owner = false;
+  {
+    lock_guard<mutex> guard(lock);
+    entry_type& cached = entries[key];
+    if(cached.valid() && future_status::ready==cached.wait_for(chrono::seconds(0))
+       && cached.get()==current) 
+    {
+      cached = loader.get_future().share();
+      owner = true;
+    } else {
+      // another caller is updating (or has updated) the series
+      entry = cached;
+    }
+  }
+  if(!owner) return entry.get();
+  // update a copy outside of the lock, readers keep the current series
+  try 
+  {
+    shared_ptr<Series> series(new Series(*current));
+    update(*series);
+    loader.set_value(series);
+    return series;
+  } catch(...) {
+    // keep serving the current series, the next caller retries
+    loader.set_value(current);
+    throw;
+  }
+}
+
+size_t SeriesCache::size() 
+{
+  lock_guard<mutex> guard(lock);
+  return entries.size();
+}
+
+// *EOF*
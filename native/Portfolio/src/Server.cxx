@@ -0,0 +1,194 @@
+// Server.cxx
+// Mac Radigan
+
+#include "Server.hxx"
+#include <stdexcept>
+#include <limits>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+USING_QUANT
+using namespace std;
+
+const size_t Server::MAX_REQUEST = 1<<20;
+const int Server::TIMEOUT = 30;
+
+namespace {
+
+string describe(const string& what, const string& path)
+{
+  return what + ": " + path + ": " + strerror(errno);
+}
+
+void address(const string& path, struct sockaddr_un& addr)
+{
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(path.empty() || path.size()>=sizeof(addr.sun_path))
+  {
+    throw runtime_error("Invalid socket path: "+path);
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size());
+}
+
+int connectTo(const string& path)
+{
+  struct sockaddr_un addr;
+  address(path, addr);
+  int fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+  if(fd<0) throw runtime_error(describe("Unable to create socket", path));
+  if(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))<0)
+  {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+bool sendFully(int fd, const char* p, size_t n)
+{
+  while(n>0)
+  {
+    ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);
+    if(sent<0 && EINTR==errno) continue;
+    if(sent<=0) return false;
+    p += sent;
+    n -= sent;
+  }
+  return true;
+}
+
+// read to end of stream, at most limit bytes (false if exceeded or failed)
+bool receiveFully(int fd, string& text, size_t limit)
+{
+  char buffer[65536];
+  for(;;)
+  {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if(n<0 && EINTR==errno) continue;
+    if(n<0) return false;
+    if(0==n) return true;
+    if(text.size()+n>limit) return false;
+    text.append(buffer, n);
+  }
+}
+
+}
+
+Server::Server(const string& path, const handler_type& handler, int nthreads,
+               int timeout)
+  : path(path), handler(handler), listener(-1), timeout(timeout), pool(nthreads)
+{
+  struct sockaddr_un addr;
+  address(path, addr);
+  // a socket file nobody is listening on is left over from a previous run
+  struct stat st;
+  if(0==lstat(path.c_str(), &st) && S_ISSOCK(st.st_mode))
+  {
+    int fd = connectTo(path);
+    if(fd>=0)
+    {
+      close(fd);
+      throw runtime_error("Socket is already in use: "+path);
+    }
+    unlink(path.c_str());
+  }
+  listener = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+  if(listener<0) throw runtime_error(describe("Unable to create socket", path));
+  if(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))<0
+     || listen(listener, SOMAXCONN)<0)
+  {
+    string msg = describe("Unable to listen on socket", path);
+    close(listener);
+    throw runtime_error(msg);
+  }
+  if(pipe2(wakeup, O_CLOEXEC|O_NONBLOCK)<0)
+  {
+    string msg = describe("Unable to create pipe", path);
+    close(listener);
+    unlink(path.c_str());
+    throw runtime_error(msg);
+  }
+}
+
+Server::~Server()
+{
+  close(listener);
+  unlink(path.c_str());
+  close(wakeup[0]);
+  close(wakeup[1]);
+}
+
+void Server::run()
+{
+  for(;;)
+  {
+    struct pollfd fds[2] = { { listener, POLLIN, 0 }, { wakeup[0], POLLIN, 0 } };
+    if(poll(fds, 2, -1)<0)
+    {
+      if(EINTR==errno) continue;
+      throw runtime_error(describe("Unable to poll socket", path));
+    }
+    if(fds[1].revents) break;
+    if(!(fds[0].revents & POLLIN)) continue;
+    int connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    if(connection<0) continue; // e.g. the client has gone away
+    // a stalled client times out instead of blocking a worker
+    struct timeval tv = { timeout, 0 };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    pool.submit([this,connection]() { serve(connection); });
+  }
+}
+
+void Server::stop()
+{
+  char c = 0;
+  ssize_t n = write(wakeup[1], &c, 1);
+  (void)n;
+}
+
+void Server::serve(int connection)
+{
+  string request;
+  string reply;
+  if(!receiveFully(connection, request, MAX_REQUEST))
+  {
+    reply = "error: request is too large, incomplete or timed out\n";
+  } else {
+    try
+    {
+      reply = handler(request);
+    } catch(exception& e) {
+      reply = string("error: ") + e.what() + "\n";
+    }
+  }
+  // a client that has gone away is not an error of the server
+  sendFully(connection, reply.data(), reply.size());
+  close(connection);
+}
+
+string Server::query(const string& path, const string& request)
+{
+  int fd = connectTo(path);
+  if(fd<0) throw runtime_error(describe("Unable to connect to socket", path));
+  string reply;
+  bool ok = sendFully(fd, request.data(), request.size())
+            && 0==shutdown(fd, SHUT_WR)
+            && receiveFully(fd, reply, numeric_limits<size_t>::max());
+  string msg = ok ? string() : describe("Request failed on socket", path);
+  close(fd);
+  if(!ok) throw runtime_error(msg);
+  return reply;
+}
+
+// *EOF*
@@ -0,0 +1,36 @@
+// SmallKkt.cxx
+// Mac Radigan
+
+#include "SmallKkt.hxx"
+
+USING_QUANT
+using namespace std;
+
+const int SmallKkt::MAX_STOCKS = 8;
+
+bool SmallKkt::basis(int n, const double* s, const double* mu,
+                     double* w1, double* w0, double* minimum)
+{
+  switch(n) 
+  {
+    case 2: return FixedKkt<2>::basis(s, mu, w1, w0, minimum);
+    case 3: return FixedKkt<3>::basis(s, mu, w1, w0, minimum);
+    case 4: return FixedKkt<4>::basis(s, mu, w1, w0, minimum);
+    case 5: return FixedKkt<5>::basis(s, mu, w1, w0, minimum);
+    case 6: return FixedKkt<6>::basis(s, mu, w1, w0, minimum);
+    case 7: return FixedKkt<7>::basis(s, mu, w1, w0, minimum);
+    case 8: return FixedKkt<8>::basis(s, mu, w1, w0, minimum);
+    default: return false;
+  }
+}
+
+bool SmallKkt::basis(const mat& s, const mat& mu, mat& w1, mat& w0)
+{
+  int n = mu.n_elem;
+  if(n<2 || n>MAX_STOCKS || s.n_rows!=n || s.n_cols!=n) return false;
+  w1.set_size(1, n);
+  w0.set_size(1, n);
+  return basis(n, s.memptr(), mu.memptr(), w1.memptr(), w0.memptr());
+}
+
+// *EOF*
@@ -0,0 +1,173 @@
+// SyntheticMarket.cxx
+// Mac Radigan
+
+#include "SyntheticMarket.hxx"
+#include "RandomStream.hxx"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <boost/filesystem.hpp>
+
+USING_QUANT
+using namespace std;
+
+const int SyntheticMarket::DAYS_PER_YEAR = 252;
+
+namespace {
+
+// splitmix64 streams, with Box-Muller normal deviates:  the sequence
+// is fully specified, unlike the distributions of <random>
+class Random
+{
+  private:
+    uint64_t state;
+    bool cached;
+    double spare;
+  public:
+    Random(uint64_t seed, uint64_t stream)
+      : state(seed*GOLDEN_GAMMA ^ (stream+1)*0xD1B54A32D192ED03ULL),
+        cached(false), spare(0)
+    {
+    }
+    uint64_t next() { return RandomStream::mix(state += GOLDEN_GAMMA); }
+    // uniform on [0,1)
+    double uniform() { return (next()>>11)*(1.0/9007199254740992.0); }
+    double uniform(double a, double b) { return a+(b-a)*uniform(); }
+    double normal()
+    {
+      if(cached) { cached = false; return spare; }
+      double r = sqrt(-2*log(1-uniform()));
+      double theta = 2*M_PI*uniform();
+      spare = r*sin(theta);
+      cached = true;
+      return r*cos(theta);
+    }
+};
+
+// daily volatility of the market and of the style factors
+const double MARKET_VOLATILITY = 0.010;
+const double STYLE_VOLATILITY  = 0.005;
+
+}
+
+SyntheticMarket::SyntheticMarket(int nsymbols, int ndays, uint64_t seed, int nfactors)
+  : ndays(ndays), nfactors(nfactors), seed(seed)
+{
+  if(nsymbols<1) throw runtime_error("Synthetic market requires at least one stock.");
+  for(int idx=0; idx<nsymbols; idx++)
+  {
+    char symbol[32];
+    snprintf(symbol, sizeof(symbol), "SYN%04d", idx);
+    symbols.push_back(symbol);
+  }
+  generate();
+}
+
+SyntheticMarket::SyntheticMarket(const vector<string>& symbols, int ndays,
+                                 uint64_t seed, int nfactors)
+  : ndays(ndays), nfactors(nfactors), seed(seed), symbols(symbols)
+{
+  if(symbols.empty()) throw runtime_error("Synthetic market requires at least one stock.");
+  generate();
+}
+
+SyntheticMarket::~SyntheticMarket()
+{
+}
+
+void SyntheticMarket::generate()
+{
+  if(ndays<2) throw runtime_error("Synthetic market requires at least two days.");
+  if(nfactors<1) throw runtime_error("Synthetic market requires at least one factor.");
+  // weekdays, back from 2013-12-31 (a Tuesday)
+  dates.resize(ndays);
+  time_t date = 1388448000;
+  for(int dIdx=ndays-1; dIdx>=0; dIdx--)
+  {
+    dates[dIdx] = date;
+    do {
+      date -= 86400;
+    } while(date/86400%7==2 || date/86400%7==3);  // 1970-01-01 was a Thursday
+  }
+  Random random(seed, 0);
+  factors.resize(ndays*nfactors);
+  for(int dIdx=0; dIdx<ndays; dIdx++)
+  {
+    factors[dIdx*nfactors] = MARKET_VOLATILITY*random.normal();
+    for(int k=1; k<nfactors; k++)
+    {
+      factors[dIdx*nfactors+k] = STYLE_VOLATILITY*random.normal();
+    }
+  }
+}
+
+void SyntheticMarket::writeSeries(int idx, const string& filename) const
+{
+  Random random(seed, idx+1);
+  double mu = random.uniform(-0.05, 0.25)/DAYS_PER_YEAR;
+  vector<double> beta(nfactors);
+  beta[0] = random.uniform(0.5, 1.5);
+  for(int k=1; k<nfactors; k++) beta[k] = 0.5*random.normal();
+  double specific = random.uniform(0.008, 0.025);
+  double price = random.uniform(10, 200);
+  // generated oldest first, written newest first
+  vector<string> lines(ndays);
+  for(int dIdx=0; dIdx<ndays; dIdx++)
+  {
+    double r = mu + specific*random.normal();
+    for(int k=0; k<nfactors; k++) r += beta[k]*factors[dIdx*nfactors+k];
+    double open  = price*(1+0.002*random.normal());
+    double close = max(price*(1+r), 0.01);
+    double high  = max(open, close)*(1+0.01*random.uniform());
+    double low   = min(open, close)*(1-0.01*random.uniform());
+    int volume   = static_cast<int>(random.uniform(1e5, 1e7));
+    price = close;
+    char date[11];
+    struct tm tm;
+    strftime(date, sizeof(date), "%Y-%m-%d", gmtime_r(&dates[dIdx], &tm));
+    char line[160];
+    snprintf(line, sizeof(line), "%s,%.2f,%.2f,%.2f,%.2f,%d,%.2f\n",
+             date, open, high, low, close, volume, close);
+    lines[dIdx] = line;
+  }
+  FILE* fp = fopen(filename.c_str(), "w");
+  if(NULL==fp) throw runtime_error("Unable to write file: "+filename);
+  fputs("Date,Open,High,Low,Close,Volume,Adj Close\n", fp);
+  for(int dIdx=ndays-1; dIdx>=0; dIdx--) fputs(lines[dIdx].c_str(), fp);
+  if(0!=fclose(fp)) throw runtime_error("Unable to write file: "+filename);
+}
+
+void SyntheticMarket::write(const string& database) const
+{
+  for(size_t idx=0; idx<symbols.size(); idx++)
+  {
+    // <database>/<SYM>/<SYM>.csv
+    boost::filesystem::path dir = boost::filesystem::path(database) / symbols[idx];
+    boost::filesystem::create_directories(dir);
+    writeSeries(idx, (dir / (symbols[idx]+".csv")).string());
+  }
+}
+
+void SyntheticMarket::writePortfolio(const string& filename, const string& database,
+                                     const string& output, int nstocks, double roi) const
+{
+  std::ofstream ofs(filename.c_str());
+  if(!ofs.is_open()) throw runtime_error("Unable to write file: "+filename);
+  ofs << "<?xml version=\"1.0\" standalone=\"yes\"?>" << endl
+      << "<portfolio>" << endl
+      << "  <database>" << database << "</database>" << endl
+      << "  <output>" << output << "</output>" << endl
+      << "  <stocks>" << endl;
+  for(int idx=0; idx<nstocks && idx<static_cast<int>(symbols.size()); idx++)
+  {
+    ofs << "    <stock>" << symbols[idx] << "</stock>" << endl;
+  }
+  ofs << "  </stocks>" << endl
+      << "  <roi>" << roi << "</roi>" << endl
+      << "</portfolio>" << endl;
+}
+
+// *EOF*
@@ -0,0 +1,63 @@
+// ThreadPool.cxx
+// Mac Radigan
+
+#include "ThreadPool.hxx"
+
+USING_QUANT
+using namespace std;
+
+ThreadPool::ThreadPool(int nthreads) 
+  : stopping(false)
+{
+  if(nthreads<1) nthreads = 1;
+  for(int idx=0; idx<nthreads; idx++) 
+  {
+    workers.push_back(thread(&ThreadPool::run, this));
+  }
+}
+
+ThreadPool::~ThreadPool() 
+{
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  ready.notify_all();
+  for(size_t idx=0; idx<workers.size(); idx++) 
+  {
+    workers[idx].join();
+  }
+}
+
+void ThreadPool::submit(const function<void()>& task) 
+{
+  {
+    lock_guard<mutex> guard(lock);
+    tasks.push_back(task);
+  }
+  ready.notify_one();
+}
+
+void ThreadPool::run() 
+{
+  for(;;) 
+  {
+    function<void()> task;
+    {
+      unique_lock<mutex> guard(lock);
+      while(!stopping && tasks.empty()) ready.wait(guard);
+      if(tasks.empty()) return; // stopping, and the queue is drained
+      task = tasks.front();
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+int ThreadPool::concurrency() 
+{
+  int n = thread::hardware_concurrency();
+  return n>0 ? n : 1;
+}
+
+// *EOF*
@@ -0,0 +1,337 @@
+// Universe.cxx
+// Mac Radigan
+
+#include "Universe.hxx"
+#include "RandomStream.hxx"
+#include "Portfolio.hxx"
+#include "Cholesky.hxx"
+#include "SmallKkt.hxx"
+#include "Kernels.hxx"
+#include "ThreadPool.hxx"
+#include "Instrumentation.hxx"
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <math.h>
+#include <boost/algorithm/string.hpp>
+
+USING_QUANT
+using namespace std;
+
+const size_t Universe::BATCH_SIZE = 256;
+
+namespace {
+
+// a subset ranked by variance, then by members
+typedef pair<double, vector<int> > ranked_type;
+
+// the best ntop distinct subsets (a max-heap:  the worst kept on top)
+void keep(vector<ranked_type>& top, size_t ntop, double variance, const vector<int>& members)
+{
+  if(top.size()==ntop && !(ranked_type(variance, members)<top.front())) return;
+  for(size_t idx=0; idx<top.size(); idx++) 
+  {
+    if(top[idx].second==members) return;   // drawn again
+  }
+  top.push_back(ranked_type(variance, members));
+  push_heap(top.begin(), top.end());
+  if(top.size()>ntop) 
+  {
+    pop_heap(top.begin(), top.end());
+    top.pop_back();
+  }
+}
+
+}
+
+// per-worker scratch, reused for every subset
+struct Universe::Scratch
+{
+  std::vector<int> members;
+  mat s;                                 // (k x k) covariance block
+  mat m;                                 // (k x 2) [mu 1v]
+  mat y;                                 // (k x 2) S^-1*[mu 1v]
+  mat w1;                                // (1 x k) frontier basis
+  mat w0;
+  Cholesky cholesky;
+};
+
+Universe::Universe(string datapath)
+  : datapath(datapath), cache(&local), missing(MISSING_DROP), isEstimated(false)
+{
+  if(PanelStore::isStore(datapath)) store = local.getStore(datapath);
+}
+
+Universe::Universe(string datapath, SeriesCache& cache)
+  : datapath(datapath), cache(&cache), missing(MISSING_DROP), isEstimated(false)
+{
+  if(PanelStore::isStore(datapath)) store = cache.getStore(datapath);
+}
+
+Universe::~Universe()
+{
+}
+
+void Universe::addSeries(string symbol)
+{
+  if(indexOf(symbol)>=0) return;
+  if(store) 
+  {
+    series.push_back(cache->get(symbol, *store, numeric_limits<time_t>::min(),
+                                numeric_limits<time_t>::max()));
+  } else {
+    series.push_back(cache->get(symbol, getFilename(symbol)));
+  }
+  symbols.push_back(symbol);
+  isEstimated = false;
+}
+
+bool Universe::refresh()
+{
+  if(store) return false;
+  bool changed = false;
+  for(size_t sIdx=0; sIdx<symbols.size(); sIdx++) 
+  {
+    SeriesPtr updated = cache->refresh(symbols[sIdx], getFilename(symbols[sIdx]));
+    if(updated==series[sIdx]) continue;
+    series[sIdx] = updated;
+    changed = true;
+  }
+  if(changed) isEstimated = false;
+  return changed;
+}
+
+string Universe::getFilename(const string& symbol) const
+{
+  return datapath + "/" + symbol + "/" + symbol + ".csv";
+}
+
+vector<string> Universe::readSymbols(const string& filename)
+{
+  ifstream list(filename.c_str());
+  if(!list.is_open()) throw runtime_error("Unable to open symbol list: "+filename);
+  vector<string> symbols;
+  string line;
+  while(getline(list,line)) 
+  {
+    boost::algorithm::trim(line);
+    if(line.empty() || '#'==line[0]) continue;
+    symbols.push_back(line);
+  }
+  return symbols;
+}
+
+int Universe::indexOf(const string& symbol) const
+{
+  vector<string>::const_iterator it = find(symbols.begin(), symbols.end(), symbol);
+  return symbols.end()==it ? -1 : it-symbols.begin();
+}
+
+void Universe::estimate()
+{
+  QUANT_TIMER("universe.estimate");
+  if(symbols.size()<2) throw runtime_error("Universe requires at least two stocks.");
+  vector<const Series*> members;
+  for(size_t idx=0; idx<series.size(); idx++) members.push_back(series[idx].get());
+  alignment.align(members, missing, Portfolio::getDefaultWindowLength(), returns, window);
+  int ns = returns.n_rows;
+  int np = returns.n_cols;
+  if(ns<2) throw runtime_error("Universe series have too few common dates.");
+  mu.set_size(1, np);
+  covariance.set_size(np, np);
+  mat sigma(1, np);
+  if(0==alignment.getMissing()) 
+  {
+    Kernels::moments(returns.memptr(), ns, np, mu.memptr(), covariance.memptr(), sigma.memptr());
+  } else {
+    Portfolio::pairwiseMoments(returns, mu, covariance, sigma);
+  }
+  isEstimated = true;
+}
+
+void Universe::extract(const vector<int>& members, mat& mu, mat& s) const
+{
+  int k = members.size();
+  mu.set_size(1, k);
+  s.set_size(k, k);
+  for(int c=0; c<k; c++) 
+  {
+    mu(0,c) = this->mu(0,members[c]);
+    const double* sc = covariance.colptr(members[c]);
+    for(int r=0; r<k; r++) s(r,c) = sc[members[r]];
+  }
+}
+
+bool Universe::evaluate(const vector<int>& members, double mu_opt, Scratch& scratch,
+                        double& variance, double& minimum) const
+{
+  int k = members.size();
+  scratch.s.set_size(k, k);
+  scratch.m.set_size(k, 2);
+  for(int c=0; c<k; c++) 
+  {
+    const double* sc = covariance.colptr(members[c]);
+    for(int r=0; r<k; r++) scratch.s(r,c) = sc[members[r]];
+    scratch.m(c,0) = mu(0,members[c]);
+    scratch.m(c,1) = 1;
+  }
+  // small subsets by the fixed-size solve, unless S is singular;
+  // global minimum variance 1/(1v'*S^-1*1v)
+  scratch.w1.set_size(1, k);
+  scratch.w0.set_size(1, k);
+  if(!SmallKkt::basis(k, scratch.s.memptr(), scratch.m.colptr(0),
+                      scratch.w1.memptr(), scratch.w0.memptr(), &minimum)) 
+  {
+    try 
+    {
+      scratch.cholesky.factor(scratch.s);
+      scratch.cholesky.solve(scratch.m, scratch.y);
+      Portfolio::schurBasis(scratch.m, scratch.y, scratch.w1, scratch.w0);
+    } catch(runtime_error& e) {
+      return false;
+    }
+    double a = 0;
+    for(int c=0; c<k; c++) a += scratch.y(c,1);
+    minimum = a>0 ? 1/a : numeric_limits<double>::infinity();
+  }
+  // w = mu_opt*w1+w0,  variance w'*S*w
+  variance = 0;
+  for(int c=0; c<k; c++) 
+  {
+    const double* sc = scratch.s.colptr(c);
+    double wc = mu_opt*scratch.w1(0,c) + scratch.w0(0,c);
+    double dot = 0;
+    for(int r=0; r<k; r++) dot += (mu_opt*scratch.w1(0,r) + scratch.w0(0,r))*sc[r];
+    variance += dot*wc;
+  }
+  return isfinite(variance);
+}
+
+Candidate Universe::evaluate(const vector<int>& members, double rreturn_opt) const
+{
+  if(!isEstimated) throw runtime_error("Universe has not been estimated.");
+  if(members.size()<2) throw runtime_error("Portfolio requires at least two stocks.");
+  for(size_t idx=0; idx<members.size(); idx++) 
+  {
+    if(members[idx]<0 || members[idx]>=size()) throw runtime_error("Stock is not in the universe.");
+  }
+  int horizon = Portfolio::getTimeHorizon();
+  double mu_opt = rreturn_opt/(horizon*100);
+  Scratch scratch;
+  double variance = 0;
+  double minimum = 0;
+  if(!evaluate(members, mu_opt, scratch, variance, minimum)) 
+  {
+    throw runtime_error("Portfolio returns are degenerate.");
+  }
+  Candidate candidate;
+  candidate.members = members;
+  for(size_t idx=0; idx<members.size(); idx++) candidate.symbols.push_back(symbols[members[idx]]);
+  candidate.volatility = sqrt(max(variance,0.0))*sqrt(static_cast<double>(horizon))*100;
+  candidate.minimum = sqrt(minimum)*sqrt(static_cast<double>(horizon))*100;
+  candidate.weights = mu_opt*scratch.w1 + scratch.w0;
+  return candidate;
+}
+
+uint64_t Universe::choose(int n, int k)
+{
+  if(k<0 || k>n) return 0;
+  k = min(k, n-k);
+  unsigned __int128 c = 1;
+  for(int i=1; i<=k; i++) 
+  {
+    c = c*(n-k+i)/i;
+    if(c>static_cast<unsigned __int128>(numeric_limits<int64_t>::max())) return 0;
+  }
+  return static_cast<uint64_t>(c);
+}
+
+vector<Candidate> Universe::search(int k, double rreturn_opt, size_t ntop,
+                                   size_t nsamples, uint64_t seed, int nthreads) const
+{
+  QUANT_TIMER("universe.search");
+  if(!isEstimated) throw runtime_error("Universe has not been estimated.");
+  int nu = size();
+  if(k<2 || k>nu) throw runtime_error("Subset size must be between two and the universe size.");
+  if(ntop<1) ntop = 1;
+  uint64_t total = choose(nu, k);
+  bool enumerate = 0==nsamples;
+  if(enumerate && 0==total) throw runtime_error("Too many subsets to enumerate, sample them.");
+  uint64_t n = enumerate ? total : nsamples;
+  // binomials of the enumeration:  subset idx is the idx-th in 
+  // lexicographic order (combinatorial number system)
+  vector<uint64_t> binomial;
+  if(enumerate) 
+  {
+    binomial.resize((nu+1)*(k+1));
+    for(int a=0; a<=nu; a++) for(int b=0; b<=k; b++) binomial[a*(k+1)+b] = choose(a, b);
+  }
+  double mu_opt = rreturn_opt/(Portfolio::getTimeHorizon()*100);
+  atomic<uint64_t> next(0);
+  vector<ranked_type> best;
+  mutex lock;
+  {
+    int nworkers = nthreads>0 ? nthreads : ThreadPool::concurrency();
+    nworkers = static_cast<int>(min<uint64_t>(nworkers, (n+BATCH_SIZE-1)/BATCH_SIZE));
+    ThreadPool pool(nworkers);
+    for(int wIdx=0; wIdx<nworkers; wIdx++) 
+    {
+      pool.submit([&,k,nu,n,ntop,mu_opt,seed,enumerate]() {
+        Scratch scratch;
+        vector<int>& members = scratch.members;
+        vector<ranked_type> top;
+        for(;;) 
+        {
+          uint64_t first = next.fetch_add(BATCH_SIZE);
+          if(first>=n) break;
+          uint64_t last = min<uint64_t>(first+BATCH_SIZE, n);
+          for(uint64_t idx=first; idx<last; idx++) 
+          {
+            members.clear();
+            if(enumerate) 
+            {
+              uint64_t rank = idx;
+              for(int p=0, c=0; p<k; c++) 
+              {
+                uint64_t count = binomial[(nu-c-1)*(k+1)+(k-p-1)];
+                if(rank<count) { members.push_back(c); p++; } else rank -= count;
+              }
+            } else {
+              // Floyd's algorithm, from a stream keyed by the sample
+              RandomStream stream(seed, idx);
+              for(int j=nu-k; j<nu; j++) 
+              {
+                int t = static_cast<int>(stream.uniform(j+1));
+                if(find(members.begin(), members.end(), t)!=members.end()) t = j;
+                members.push_back(t);
+              }
+              sort(members.begin(), members.end());
+            }
+            double variance = 0;
+            double minimum = 0;
+            if(evaluate(members, mu_opt, scratch, variance, minimum)) 
+            {
+              keep(top, ntop, variance, members);
+            }
+          }
+        }
+        lock_guard<mutex> guard(lock);
+        best.insert(best.end(), top.begin(), top.end());
+      });
+    }
+  }
+  QUANT_COUNT("universe.subsets", n);
+  sort(best.begin(), best.end());
+  vector<Candidate> ranked;
+  for(size_t idx=0; idx<best.size() && ranked.size()<ntop; idx++) 
+  {
+    if(idx>0 && best[idx].second==best[idx-1].second) continue;
+    ranked.push_back(evaluate(best[idx].second, rreturn_opt));
+  }
+  return ranked;
+}
+
+// *EOF*
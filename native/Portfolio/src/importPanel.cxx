@@ -0,0 +1,73 @@
+// importPanel.cxx
+// Mac Radigan
+//
+// Description:  Imports a quote database of CSV files (one per stock,
+//               <database>/<SYM>/<SYM>.csv) into a panel store, a
+//               single HDF5 file of chunked, compressed (date x stock)
+//               panels, which may then be given as the database of
+//               input data files.
+//
+// Usage:        ./bin/importPanel -d database -o store.h5
+//                                 [-S AAPL,JPM | -l symbols.list]
+//
+// See Also:     PanelStore
+//
+
+#include "quant.hxx"
+#include "PanelStore.hxx"
+#include "Universe.hxx"
+#include "Instrumentation.hxx"
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+USING_QUANT
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+  po::options_description desc("options");
+  desc.add_options()
+    ("database,d", po::value<string>(), "quote database directory (CSV files)")
+    ("output,o", po::value<string>(), "panel store to write (*.h5)")
+    ("names,S", po::value<string>(), "comma separated stock symbols (default: every stock)")
+    ("list,l", po::value<string>(), "symbol list file, one per line (# comments)")
+    ("help,h", "print this help message")
+  ;
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc,argv,desc),vm);
+  po::notify(vm);
+  if(vm.count("help") || !vm.count("database") || !vm.count("output")) 
+  {
+    cout << desc << endl; 
+    return 1;
+  }
+  try
+  {
+    vector<string> symbols;
+    if(vm.count("names"))
+    {
+      boost::algorithm::split(symbols, vm["names"].as<string>(), boost::algorithm::is_any_of(", "),
+                              boost::algorithm::token_compress_on);
+    }
+    if(vm.count("list"))
+    {
+      vector<string> listed = Universe::readSymbols(vm["list"].as<string>());
+      symbols.insert(symbols.end(), listed.begin(), listed.end());
+    }
+    string output = vm["output"].as<string>();
+    PanelStore::import(vm["database"].as<string>(), symbols, output);
+    PanelStore store(output);
+    cout << output << ": " << store.getSymbols().size() << " stocks, "
+         << store.getDates().size() << " dates" << endl;
+  } catch(exception& e) {
+    cerr << "exception: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// *EOF*
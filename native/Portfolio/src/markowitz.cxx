@@ -7,8 +7,35 @@
 //
 //               In the current implementation, a target return 
 //               on investments is specified, short selling is 
-//               permitted, and there is no inclusion of a risk-free
-//               asset.
+//               permitted unless weight bounds are given, and there
+//               is no inclusion of a risk-free asset.
+//
+//               In daemon mode (-d), portfolio requests are served
+//               over a local socket, with the loaded series and
+//               estimates kept in memory between requests.
+//
+//               Input data files may request the Monte Carlo VaR
+//               and CVaR of the optimized portfolio (<risk>), and
+//               a resampled (bootstrap averaged) portfolio for the
+//               same target return (<resample>).
+//
+//               An input data file with a <search> element ranks
+//               the k-stock subsets of a universe of stocks by the
+//               volatility of their portfolio for the target return,
+//               from a single estimate of the universe.
+//
+//               The time spent in each stage of a run (and the
+//               bytes and rows loaded) is written as a JSON summary
+//               with --metrics, and logged with --log-metrics.
+//
+//               The database of an input data file may be a panel
+//               store (*.h5, see importPanel), read over a date range
+//               (<dates>).
+//
+//               The estimate window (<window>) may be of any length, 
+//               ending on any date, and the moments of stocks over
+//               other windows are listed with <moments> (queried from
+//               an index of the return history).
 //
 // See Also:     http://wikipedia.org/wiki/Modern_portfolio_theory
 //               for more information on the Markowitz portfolio
@@ -20,19 +47,39 @@
 #include "quant.hxx"
 #include "Portfolio.hxx"
 #include "Series.hxx"
+#include "SeriesCache.hxx"
+#include "ThreadPool.hxx"
+#include "Renderer.hxx"
+#include "Server.hxx"
+#include "Instrumentation.hxx"
+#include "Universe.hxx"
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/program_options.hpp>
 #include <boost/foreach.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <map>
 #include <streambuf>
 #include <exception>
 #include <stdio.h>
 #include <execinfo.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <time.h>
 #include "log4cxx/logger.h"
 #include "log4cxx/basicconfigurator.h"
 #include "log4cxx/helpers/exception.h"
@@ -43,6 +90,470 @@ int usage(int argc, char* argv[], boost::program_options::options_description &d
   std::cout << desc << std::endl;
   return 1;
 }
+
+// report formats from a comma or space separated list
+std::vector<std::string> parseFormats(std::string list) 
+{
+  std::vector<std::string> formats;
+  boost::algorithm::split(formats, list, boost::algorithm::is_any_of(", "),
+                          boost::algorithm::token_compress_on);
+  formats.erase(std::remove(formats.begin(), formats.end(), std::string()), formats.end());
+  return formats;
+}
+
+// numbers from a comma or space separated list
+template<typename T>
+std::vector<T> parseList(std::string list) 
+{
+  std::vector<T> values;
+  BOOST_FOREACH(const std::string& item, parseFormats(list)) 
+  {
+    values.push_back(boost::lexical_cast<T>(item));
+  }
+  return values;
+}
+
+// a date (YYYY-MM-DD), as the quote dates (midnight UTC)
+time_t parseDate(const std::string& date) 
+{
+  struct tm tm = {};
+  const char* end = strptime(date.c_str(), "%Y-%m-%d", &tm);
+  if(NULL==end || '\0'!=*end) throw std::runtime_error("Invalid date: "+date);
+  return timegm(&tm);
+}
+
+// configure a portfolio from the fields of an input data file:  
+// covariance model, missing data policy, weight bounds and stocks
+void configurePortfolio(const boost::property_tree::ptree& pt, Portfolio& portfolio) 
+{
+  using namespace boost::property_tree;
+  // optional date range of a panel store database (*.h5):
+  //   <dates><first>2012-01-01</first><last>2013-12-31</last></dates>
+  if(pt.get_child_optional("portfolio.dates")) 
+  {
+    portfolio.setDateRange(
+      parseDate(pt.get<std::string>("portfolio.dates.first", "1970-01-01")),
+      parseDate(pt.get<std::string>("portfolio.dates.last", "9999-12-31")));
+  }
+  // optional estimate window, days of returns ending on a date
+  // (by default, the newest):
+  //   <window><length>120</length><end>2013-06-28</end></window>
+  if(pt.get_child_optional("portfolio.window")) 
+  {
+    boost::optional<std::string> end = pt.get_optional<std::string>("portfolio.window.end");
+    portfolio.setWindow(
+      pt.get<int>("portfolio.window.length", Portfolio::getDefaultWindowLength()),
+      end ? parseDate(*end) : std::numeric_limits<time_t>::max());
+  }
+  // optional covariance model:
+  //   <covariance><model>factor</model><factors>K</factors></covariance>
+  std::string model = pt.get<std::string>("portfolio.covariance.model", "sample");
+  if(boost::algorithm::iequals(model, "factor")) 
+  {
+    portfolio.setFactorModel(pt.get<int>("portfolio.covariance.factors", 3));
+  } else if(!boost::algorithm::iequals(model, "sample")) {
+    throw std::runtime_error("Unknown covariance model: "+model);
+  }
+  // optional missing data policy for dates not quoted by every stock:
+  //   <missing>drop|ffill|pairwise</missing>
+  portfolio.setMissingData(Alignment::parsePolicy(
+    pt.get<std::string>("portfolio.missing", "drop")));
+  // optional weight bounds (e.g. lower=0 for long-only):
+  //   <bounds><lower>0</lower><upper>0.5</upper></bounds>
+  //   <stock lower="0" upper="0.25">AAPL</stock>
+  double lower = pt.get<double>("portfolio.bounds.lower", -std::numeric_limits<double>::infinity());
+  double upper = pt.get<double>("portfolio.bounds.upper",  std::numeric_limits<double>::infinity());
+  portfolio.setBounds(lower, upper);
+  BOOST_FOREACH(const ptree::value_type &v, pt.get_child("portfolio.stocks")) 
+  {
+    std::string symbol = v.second.data();
+    portfolio.addSeries(symbol);
+    if(v.second.get_child_optional("<xmlattr>")) 
+    {
+      portfolio.setBounds(symbol,
+        v.second.get<double>("<xmlattr>.lower", lower),
+        v.second.get<double>("<xmlattr>.upper", upper));
+    }
+  }
+}
+
+// optimize a configured portfolio for the target return of an input 
+// data file, and write its summary to out;  a positive rebalance 
+// interval (days) adds a walk-forward backtest;  the report figures
+// (if an output directory is given) are queued on the renderer, in 
+// the given formats (if any), else those of the file, else the defaults
+void optimizePortfolio(const boost::property_tree::ptree& pt, Portfolio& portfolio,
+                       Renderer& renderer, std::ostream& out, int rebalance, 
+                       const std::vector<std::string>& formats) 
+{
+  double roi = pt.get<double>("portfolio.roi");
+  // optional report formats:  <formats>png,eps</formats>
+  if(!formats.empty()) 
+  {
+    portfolio.setFormats(formats);
+  } else if(pt.get_optional<std::string>("portfolio.formats")) {
+    portfolio.setFormats(parseFormats(pt.get<std::string>("portfolio.formats")));
+  } else {
+    portfolio.setFormats(Portfolio::getDefaultFormats());
+  }
+  // optional backtest interval:  <rebalance>days</rebalance>
+  rebalance = pt.get<int>("portfolio.rebalance", rebalance);
+  portfolio.optimize(roi);
+  out << portfolio << std::endl;
+  if(rebalance>0) 
+  {
+    Backtest bt = portfolio.backtest(roi, rebalance);
+    out << std::setiosflags(std::ios::fixed) << std::setprecision(3)
+        << "walk-forward backtest: "
+        << "rebalance=" << rebalance << " days, "
+        << "periods=" << bt.rebalance.size() << ", "
+        << "days=" << bt.rreturn.size() << ", "
+        << "return=" << bt.portfolio_rreturn << "%, "
+        << "volatility=" << bt.portfolio_volatility << "%"
+        << std::endl << std::endl;
+  }
+  // optional resampled portfolio for the target return:
+  //   <resample><count>1000</count><block>1</block><seed>1</seed></resample>
+  if(pt.get_child_optional("portfolio.resample")) 
+  {
+    int block = pt.get<int>("portfolio.resample.block", 1);
+    Frontier resampled = portfolio.resample(std::vector<double>(1, roi),
+      pt.get<size_t>("portfolio.resample.count", Resampler::DEFAULT_RESAMPLES), block,
+      pt.get<uint64_t>("portfolio.resample.seed", 1));
+    if(resampled.rreturn.empty()) 
+    {
+      throw std::runtime_error("Portfolio cannot achieve specified estimated target ROI in any resample.");
+    }
+    out << std::setiosflags(std::ios::fixed) << std::setprecision(3)
+        << "resampled portfolio: "
+        << "resamples=" << pt.get<size_t>("portfolio.resample.count", Resampler::DEFAULT_RESAMPLES) << ", "
+        << "block=" << block << " days, "
+        << "return=" << resampled.rreturn[0] << "%, "
+        << "volatility=" << resampled.volatility[0] << "%"
+        << std::endl;
+    std::vector<std::string> symbols = portfolio.getSymbols();
+    for(size_t sIdx=0; sIdx<symbols.size(); sIdx++) 
+    {
+      out << "\t" << symbols[sIdx] << "\t" << resampled.weights(0,sIdx) << std::endl;
+    }
+    out << std::endl;
+  }
+  // optional Monte Carlo risk of the optimized weights:
+  //   <risk><paths>1000000</paths><horizons>1,10,21</horizons>
+  //         <levels>0.95,0.99</levels><seed>1</seed></risk>
+  if(pt.get_child_optional("portfolio.risk")) 
+  {
+    Risk risk = portfolio.risk(
+      parseList<int>(pt.get<std::string>("portfolio.risk.horizons", "1,10,21")),
+      parseList<double>(pt.get<std::string>("portfolio.risk.levels", "0.95,0.99")),
+      pt.get<size_t>("portfolio.risk.paths", MonteCarlo::DEFAULT_PATHS),
+      pt.get<uint64_t>("portfolio.risk.seed", 1));
+    out << "monte carlo risk: paths=" << risk.paths << " (loss, percent of value)" << std::endl;
+    for(size_t hIdx=0; hIdx<risk.horizon.size(); hIdx++) 
+    {
+      out << std::setiosflags(std::ios::fixed) << std::setprecision(3)
+          << "  horizon=" << risk.horizon[hIdx] << " days: "
+          << "mean=" << risk.mean[hIdx] << "%";
+      for(size_t lIdx=0; lIdx<risk.level.size(); lIdx++) 
+      {
+        std::string level = boost::lexical_cast<std::string>(100*risk.level[lIdx]);
+        out << ", VaR(" << level << "%)=" << risk.var(hIdx,lIdx) << "%"
+            << ", CVaR(" << level << "%)=" << risk.cvar(hIdx,lIdx) << "%";
+      }
+      out << std::endl;
+    }
+    out << std::endl;
+  }
+  // optional moments of each stock over windows of several lengths
+  // ending on a date (by default, the newest):
+  //   <moments><lengths>60,120,250</lengths><end>2013-06-28</end></moments>
+  if(pt.get_child_optional("portfolio.moments")) 
+  {
+    boost::optional<std::string> end = pt.get_optional<std::string>("portfolio.moments.end");
+    time_t last = end ? parseDate(*end) : std::numeric_limits<time_t>::max();
+    std::vector<std::string> symbols = portfolio.getSymbols();
+    const double horizon = Portfolio::getTimeHorizon();
+    BOOST_FOREACH(int length, parseList<int>(pt.get<std::string>("portfolio.moments.lengths", "250"))) 
+    {
+      mat mean;
+      mat covariance;
+      int days = portfolio.moments(length, last, mean, covariance);
+      out << "window moments: days=" << days << ", end=" << (end ? *end : "newest")
+          << " (annualized, percent)" << std::endl;
+      for(size_t sIdx=0; sIdx<symbols.size(); sIdx++) 
+      {
+        out << std::setiosflags(std::ios::fixed) << std::setprecision(3)
+            << "\t" << symbols[sIdx] 
+            << "\treturn=" << (pow(1+mean(0,sIdx), horizon)-1)*100 << "%"
+            << "\tvolatility=" << sqrt(std::max(covariance(sIdx,sIdx), 0.0)*horizon)*100 << "%"
+            << std::endl;
+      }
+    }
+    out << std::endl;
+  }
+  boost::optional<std::string> reportpath = pt.get_optional<std::string>("portfolio.output");
+  if(reportpath) portfolio.createReport(*reportpath, renderer);
+}
+
+// rank the subsets of a universe for the target return, and write 
+// the best of them to out:
+//   <search><size>4</size><top>10</top><samples>0</samples><seed>1</seed>
+//           <universe>symbols.list</universe></search>
+// the universe is the stocks of the file and of the symbol list (if 
+// any);  every subset is evaluated unless samples are given
+void searchUniverse(const boost::property_tree::ptree& pt, SeriesCache& cache, std::ostream& out) 
+{
+  using namespace boost::property_tree;
+  double roi = pt.get<double>("portfolio.roi");
+  Universe universe(pt.get<std::string>("portfolio.database"), cache);
+  universe.setMissingData(Alignment::parsePolicy(pt.get<std::string>("portfolio.missing", "drop")));
+  if(pt.get_child_optional("portfolio.stocks")) 
+  {
+    BOOST_FOREACH(const ptree::value_type &v, pt.get_child("portfolio.stocks")) 
+    {
+      universe.addSeries(v.second.data());
+    }
+  }
+  boost::optional<std::string> list = pt.get_optional<std::string>("portfolio.search.universe");
+  if(list) 
+  {
+    BOOST_FOREACH(const std::string& symbol, Universe::readSymbols(*list)) 
+    {
+      universe.addSeries(symbol);
+    }
+  }
+  // series cached by earlier requests (daemon mode) pick up new records
+  universe.refresh();
+  universe.estimate();
+  int k = pt.get<int>("portfolio.search.size", 4);
+  size_t nsamples = pt.get<size_t>("portfolio.search.samples", 0);
+  std::vector<Candidate> ranked = universe.search(k, roi,
+    pt.get<size_t>("portfolio.search.top", 10), nsamples,
+    pt.get<uint64_t>("portfolio.search.seed", 1));
+  out << std::setiosflags(std::ios::fixed) << std::setprecision(3)
+      << "subset search: "
+      << "universe=" << universe.size() << " stocks, "
+      << "size=" << k << ", "
+      << "subsets=" << (nsamples>0 ? nsamples : Universe::choose(universe.size(), k))
+      << (nsamples>0 ? " (sampled), " : ", ")
+      << "return=" << roi << "%"
+      << std::endl;
+  for(size_t cIdx=0; cIdx<ranked.size(); cIdx++) 
+  {
+    const Candidate& candidate = ranked[cIdx];
+    out << std::setw(4) << cIdx+1 << ".  "
+        << "volatility=" << candidate.volatility << "%, "
+        << "minimum=" << candidate.minimum << "%" << std::endl;
+    for(size_t sIdx=0; sIdx<candidate.symbols.size(); sIdx++) 
+    {
+      out << "\t" << candidate.symbols[sIdx] << "\t" << candidate.weights(0,sIdx) << std::endl;
+    }
+  }
+  out << std::endl;
+}
+
+// optimize one portfolio XML file, and write its summary to out
+void runPortfolio(std::string filename, SeriesCache& cache, Renderer& renderer,
+                  std::ostream& out, int rebalance, 
+                  const std::vector<std::string>& formats) 
+{
+  using namespace boost::property_tree;
+  ptree pt;
+  {
+    QUANT_TIMER("xml.parse");
+    read_xml(filename.c_str(), pt);
+  }
+  if(pt.get_child_optional("portfolio.search")) 
+  {
+    searchUniverse(pt, cache, out);
+    return;
+  }
+  Portfolio portfolio(pt.get<std::string>("portfolio.database"), cache);
+  configurePortfolio(pt, portfolio);
+  optimizePortfolio(pt, portfolio, renderer, out, rebalance, formats);
+}
+
+// optimization service of the daemon:  series stay loaded between 
+// requests (and pick up appended records), and requests that differ
+// only in target return, backtest or report share a portfolio, so 
+// its estimate is reused until the data changes;  the least recently
+// used portfolios are dropped beyond a capacity
+class Service 
+{
+  private:
+    struct Entry 
+    {
+      std::mutex lock;                   // one request at a time
+      std::unique_ptr<Portfolio> portfolio;
+      uint64_t used;                     // request count at last use
+    };
+    typedef std::map<std::string,std::shared_ptr<Entry> > entry_map;
+    SeriesCache cache;
+    Renderer& renderer;
+    int rebalance;
+    std::vector<std::string> formats;
+    size_t capacity;
+    uint64_t requests;
+    entry_map portfolios;
+    std::mutex lock;
+    // the entry of a configuration, created (and the least recently 
+    // used entry dropped, if over capacity) on first use
+    std::shared_ptr<Entry> acquire(const std::string& key) 
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      std::shared_ptr<Entry>& cached = portfolios[key];
+      if(!cached) cached.reset(new Entry());
+      cached->used = ++requests;
+      std::shared_ptr<Entry> entry = cached;
+      if(portfolios.size()>capacity) 
+      {
+        // requests in progress keep their entry until they complete
+        entry_map::iterator oldest = portfolios.begin();
+        for(entry_map::iterator it=portfolios.begin(); portfolios.end()!=it; ++it) 
+        {
+          if(it->second->used<oldest->second->used) oldest = it;
+        }
+        portfolios.erase(oldest);
+      }
+      return entry;
+    }
+    // drop the entry of a configuration that failed
+    void release(const std::string& key, const std::shared_ptr<Entry>& entry) 
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      entry_map::iterator it = portfolios.find(key);
+      if(portfolios.end()!=it && it->second==entry) portfolios.erase(it);
+    }
+  public:
+    Service(Renderer& renderer, int rebalance, const std::vector<std::string>& formats,
+            size_t capacity) 
+      : renderer(renderer), rebalance(rebalance), formats(formats), 
+        capacity(std::max<size_t>(capacity, 1)), requests(0) 
+    {
+    }
+    // a request is an input data file (XML), the reply its summary
+    std::string handle(const std::string& request) 
+    {
+      using namespace boost::property_tree;
+      QUANT_TIMER("server.request");
+      ptree pt;
+      {
+        QUANT_TIMER("xml.parse");
+        std::istringstream in(request);
+        read_xml(in, pt);
+      }
+      if(pt.get_child_optional("portfolio.search")) 
+      {
+        std::stringstream out;
+        searchUniverse(pt, cache, out);
+        return out.str();
+      }
+      ptree configuration = pt.get_child("portfolio");
+      configuration.erase("roi");
+      configuration.erase("rebalance");
+      configuration.erase("output");
+      configuration.erase("formats");
+      std::ostringstream key;
+      write_xml(key, configuration);
+      std::shared_ptr<Entry> entry = acquire(key.str());
+      std::lock_guard<std::mutex> guard(entry->lock);
+      try 
+      {
+        if(!entry->portfolio) 
+        {
+          std::unique_ptr<Portfolio> portfolio(
+            new Portfolio(pt.get<std::string>("portfolio.database"), cache));
+          configurePortfolio(pt, *portfolio);
+          entry->portfolio = std::move(portfolio);
+        }
+        // cached series may predate this request, whether or not the 
+        // portfolio is new
+        entry->portfolio->refresh();
+      } catch(...) {
+        if(!entry->portfolio) release(key.str(), entry);
+        throw;
+      }
+      std::stringstream out;
+      optimizePortfolio(pt, *entry->portfolio, renderer, out, rebalance, formats);
+      return out.str();
+    }
+};
+
+// portfolio XML files of a batch:  either every *.xml file of a
+// directory (in name order), or a list file with one path per line
+std::vector<std::string> listPortfolios(std::string batch) 
+{
+  using namespace boost::filesystem;
+  std::vector<std::string> files;
+  if(is_directory(batch)) 
+  {
+    for(directory_iterator it(batch); directory_iterator()!=it; ++it) 
+    {
+      if(is_regular_file(it->status()) && ".xml"==it->path().extension()) 
+      {
+        files.push_back(it->path().string());
+      }
+    }
+    std::sort(files.begin(), files.end());
+  } else {
+    std::ifstream list(batch.c_str());
+    if(!list.is_open()) 
+    {
+      throw std::runtime_error("Unable to open batch file: "+batch);
+    }
+    std::string line;
+    while(getline(list,line)) 
+    {
+      boost::algorithm::trim(line);
+      if(line.empty() || '#'==line[0]) continue;
+      files.push_back(line);
+    }
+  }
+  return files;
+}
+
+// optimize a batch of portfolios on a thread pool, sharing loaded
+// series between them;  results are written in input order
+int runBatch(std::string batch, Renderer& renderer, int nthreads, int rebalance,
+             const std::vector<std::string>& formats) 
+{
+  std::vector<std::string> files = listPortfolios(batch);
+  SeriesCache cache;
+  std::vector< std::shared_ptr< std::packaged_task<std::string()> > > jobs;
+  std::vector< std::future<std::string> > results;
+  BOOST_FOREACH(const std::string& filename, files) 
+  {
+    std::shared_ptr< std::packaged_task<std::string()> > job(
+      new std::packaged_task<std::string()>([filename,&cache,&renderer,rebalance,&formats]() {
+        std::stringstream out;
+        runPortfolio(filename, cache, renderer, out, rebalance, formats);
+        return out.str();
+      }));
+    results.push_back(job->get_future());
+    jobs.push_back(job);
+  }
+  int status = 0;
+  {
+    ThreadPool pool(nthreads);
+    for(size_t idx=0; idx<jobs.size(); idx++) 
+    {
+      std::shared_ptr< std::packaged_task<std::string()> > job = jobs[idx];
+      pool.submit([job]() { (*job)(); });
+    }
+    for(size_t idx=0; idx<results.size(); idx++) 
+    {
+      std::cout << "portfolio: " << files[idx] << std::endl;
+      try 
+      {
+        std::cout << results[idx].get() << std::flush;
+      } catch(std::exception& e) {
+        std::cerr << "exception: " << files[idx] << ": " << e.what() << std::endl;
+        status = 1;
+      }
+    }
+  }
+  return status;
+}
 NS_QUANT_END
 
 using namespace std;
@@ -56,6 +567,46 @@ using namespace log4cxx::helpers;
 
 LoggerPtr logger(Logger::getLogger("Markowitz"));
 
+// the per-stage summary of a run:  as JSON to a file (- for stdout),
+// and one log record per metric
+void reportMetrics(const variables_map& vm) 
+{
+  if(vm.count("metrics")) 
+  {
+    string json = Instrumentation::toJson();
+    if("-"==vm["metrics"].as<string>()) 
+    {
+      cout << json << flush;
+    } else {
+      std::ofstream out(vm["metrics"].as<string>().c_str());
+      if(!(out << json)) cerr << "unable to write " << vm["metrics"].as<string>() << endl;
+    }
+  }
+  if(vm.count("log-metrics")) 
+  {
+    BOOST_FOREACH(const Metric* metric, Instrumentation::getMetrics()) 
+    {
+      if(0==metric->getCount()) continue;
+      stringstream ss;
+      ss << metric->getName() << ": count=" << metric->getCount();
+      if(Metric::TIMER==metric->getKind()) 
+      {
+        ss << " total=" << metric->getTotal()*1e-9 << "s max=" << metric->getMax()*1e-9 << "s";
+      } else {
+        ss << " total=" << metric->getTotal() << " max=" << metric->getMax();
+      }
+      LOG4CXX_INFO(logger, ss.str());
+    }
+  }
+}
+
+// the daemon stops on SIGINT or SIGTERM
+Server* daemon_server = NULL;
+void shutdown_handler(int sig) 
+{
+  if(NULL!=daemon_server) daemon_server->stop();
+}
+
 
 #if 0
 //void bt_sighandler(int sig, struct sigcontext ctx) 
@@ -117,31 +668,83 @@ int main(int argc, char* argv[])
    po::notify(vm);
    desc.add_options()
      ("file,f", po::value<string>(), "input data file")
+     ("batch,b", po::value<string>(), "directory or list file of input data files")
+     ("threads,j", po::value<int>()->default_value(ThreadPool::concurrency()), 
+        "number of worker threads (batch or daemon mode)")
+     ("rebalance,r", po::value<int>()->default_value(0), 
+        "walk-forward backtest, rebalancing every arg days")
+     ("sessions,s", po::value<int>()->default_value(2), 
+        "number of gnuplot sessions rendering reports")
+     ("formats,F", po::value<string>(), 
+        "report formats, e.g. png,eps (default: as in the input data file)")
+     ("force", "render every report, even if its inputs are unchanged")
+     ("lazy", "load only the newest records of each stock, the rest when needed")
+     ("daemon,d", po::value<string>(), 
+        "serve input data files sent to the socket arg (daemon mode)")
+     ("portfolios", po::value<size_t>()->default_value(64), 
+        "number of portfolios kept between requests (daemon mode)")
+     ("connect,c", po::value<string>(), 
+        "send the input data file to the daemon on socket arg")
+     ("metrics", po::value<string>(), 
+        "write per-stage timers and counters as JSON to file arg (- for stdout)")
+     ("log-metrics", "log per-stage timers and counters")
      ("help,h", "print this help message")
    ;
    po::store(po::parse_command_line(argc,argv,desc),vm);
    if(vm.count("help")) { return usage(argc,argv,desc); exit(0); }
-   if(!vm.count("file")) { cerr << "no input file specified" << endl; exit(1); }
+   if(!vm.count("file") && !vm.count("batch") && !vm.count("daemon")) { cerr << "no input file specified" << endl; exit(1); }
+   if(vm.count("log-metrics")) BasicConfigurator::configure();
+   if(vm.count("lazy")) Portfolio::setLazyLoading(true);
+   if((vm.count("metrics") || vm.count("log-metrics")) && !Instrumentation::isEnabled()) 
+   {
+     cerr << "metrics are not available (built with INSTRUMENT=OFF)" << endl;
+   }
    int status = 1;
    try 
    {
-     Portfolio* portfolio;
-     ptree pt;
-     read_xml(vm["file"].as<string>().c_str(), pt);
-     string datapath = pt.get<string>("portfolio.database");
-     string reportpath = pt.get<string>("portfolio.output");
-     double roi = pt.get<double>("portfolio.roi");
-     portfolio = new Portfolio(datapath);
-     BOOST_FOREACH(const ptree::value_type &v, pt.get_child("portfolio.stocks")) 
+     QUANT_TIMER("markowitz.run");
+     if(vm.count("connect")) 
+     {
+       // the daemon resolves relative paths in its own working directory
+       if(!vm.count("file")) { cerr << "no input file specified" << endl; exit(1); }
+       ifstream in(vm["file"].as<string>().c_str());
+       if(!in.is_open()) throw runtime_error("Unable to open file: "+vm["file"].as<string>());
+       string request((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+       string reply = Server::query(vm["connect"].as<string>(), request);
+       cout << reply << flush;
+       return 0==reply.compare(0, 6, "error:") ? 1 : 0;
+     }
+     // results are written as soon as they are known, the reports 
+     // finish rendering in the background before the program exits
+     Renderer renderer(vm["sessions"].as<int>(), !vm.count("force"));
+     vector<string> formats;
+     if(vm.count("formats")) formats = parseFormats(vm["formats"].as<string>());
+     if(vm.count("daemon")) 
+     {
+       Service service(renderer, vm["rebalance"].as<int>(), formats,
+                       vm["portfolios"].as<size_t>());
+       Server server(vm["daemon"].as<string>(), 
+                     [&service](const string& request) { return service.handle(request); },
+                     vm["threads"].as<int>());
+       daemon_server = &server;
+       signal(SIGINT, shutdown_handler);
+       signal(SIGTERM, shutdown_handler);
+       server.run();
+       daemon_server = NULL;
+       status = 0;
+     } else if(vm.count("batch")) 
      {
-       string symbol = v.second.data();
-       portfolio->addSeries(symbol);
+       status = runBatch(vm["batch"].as<string>(), renderer, 
+                         vm["threads"].as<int>(), vm["rebalance"].as<int>(),
+                         formats);
+     } else {
+       SeriesCache cache;
+       runPortfolio(vm["file"].as<string>(), cache, renderer, cout, 
+                    vm["rebalance"].as<int>(), formats);
+       status = 0;
      }
-     portfolio->optimize(roi);
-     cout << *portfolio << endl;
-     portfolio->createReport(reportpath);
-     status = 0;
    } catch(exception& e) {
+      cerr << "exception: " << e.what() << endl;
       void *array[10];
       size_t size;
       size = backtrace(array, 10);
@@ -150,6 +753,8 @@ int main(int argc, char* argv[])
      cerr << "exception: " << e.what() << endl;
      throw;
    }
+   // after the renderer is destroyed, so the reports are complete
+   reportMetrics(vm);
    return status;
 }
 
@@ -0,0 +1,509 @@
+// pyMarkowitz.cxx
+// Mac Radigan
+//
+// Description:  This is the Python interface (Boost.Python) to the
+//               Series, Portfolio and the optimizer.
+//
+//               The price, return and date columns of a Series (newest
+//               first) are read-only NumPy views of the C++ columns,
+//               without copying.  A view holds the snapshot of the
+//               series it was taken from:  load and update replace the
+//               snapshot rather than modify it, so views stay valid
+//               (and unchanged).  The weights, returns window and
+//               estimates of a Portfolio are copied, as the portfolio
+//               reuses their buffers on the next estimate or optimize.
+//               Results (frontier, backtest, risk) own their buffers.
+//
+//               A NumPy returns matrix is optimized directly with
+//               optimize(returns, roi), without copying a float64
+//               Fortran-ordered (column-major) array.
+//
+//               Loading, estimation and solves release the GIL, so
+//               Python threads may run alongside them (an object is
+//               not to be used from two threads at once).
+//
+// Usage:        import pyMarkowitz
+//               p = pyMarkowitz.Portfolio('./data')
+//               p.addSeries('AAPL'); p.addSeries('XOM')
+//               p.optimize(20);  print(p.symbols, p.weights)
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include "Portfolio.hxx"
+#include "Kernels.hxx"
+#include "Cholesky.hxx"
+#include "FactorModel.hxx"
+#include "ActiveSetSolver.hxx"
+#include <boost/python.hpp>
+#include <boost/python/numpy.hpp>
+#include <boost/python/stl_iterator.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+namespace bp = boost::python;
+namespace np = boost::python::numpy;
+
+namespace {
+
+// the GIL is released for the life of a scope
+class ReleaseGil
+{
+  private:
+    PyThreadState* state;
+    ReleaseGil(const ReleaseGil& gil);
+    ReleaseGil& operator=(const ReleaseGil& gil);
+  public:
+    ReleaseGil() : state(PyEval_SaveThread()) {}
+    ~ReleaseGil() { PyEval_RestoreThread(state); }
+};
+
+// a Python object owning a heap object (the owner of result arrays)
+template<typename T>
+void release(PyObject* capsule)
+{
+  delete static_cast<T*>(PyCapsule_GetPointer(capsule, NULL));
+}
+
+template<typename T>
+bp::object own(T* p)
+{
+  PyObject* capsule = PyCapsule_New(p, NULL, &release<T>);
+  if(NULL==capsule) { delete p; bp::throw_error_already_set(); }
+  return bp::object(bp::handle<>(capsule));
+}
+
+// read-only views of buffers owned by owner
+template<typename T>
+np::ndarray view(const T* data, size_t n, bp::object owner)
+{
+  return np::from_data(data, np::dtype::get_builtin<T>(), bp::make_tuple(n),
+                       bp::make_tuple(sizeof(T)), owner);
+}
+
+np::ndarray view(const mat& m, bp::object owner)
+{
+  // column-major:  Fortran order
+  return np::from_data(m.memptr(), np::dtype::get_builtin<double>(),
+                       bp::make_tuple(m.n_rows, m.n_cols),
+                       bp::make_tuple(sizeof(double), sizeof(double)*m.n_rows), owner);
+}
+
+template<typename T>
+np::ndarray result(vector<T>* v)
+{
+  bp::object owner = own(v);
+  return view(v->data(), v->size(), owner);
+}
+
+np::ndarray result(mat* m)
+{
+  bp::object owner = own(m);
+  return view(*m, owner);
+}
+
+template<typename T>
+vector<T> toVector(bp::object sequence)
+{
+  return vector<T>(bp::stl_input_iterator<T>(sequence), bp::stl_input_iterator<T>());
+}
+
+// ---- Series ----
+
+// a Python series:  the current snapshot of a series, replaced (not
+// modified) while views of it are held
+class PySeries
+{
+  private:
+    std::shared_ptr<Series> series;
+    // the series to modify:  the snapshot itself if no view holds it,
+    // else a copy of it
+    std::shared_ptr<Series> modify(bool copy) const
+    {
+      if(1==series.use_count()) return series;
+      return std::shared_ptr<Series>(copy ? new Series(*series) : new Series());
+    }
+  public:
+    PySeries() : series(new Series()) {}
+    inline SeriesPtr get() const { return series; }
+    inline const Series& operator*() const { return *series; }
+    void load(const string& symbol, const string& filename)
+    {
+      std::shared_ptr<Series> s = modify(false);
+      {
+        ReleaseGil gil;
+        s->load(symbol, filename);
+      }
+      series = s;
+    }
+    size_t update(const string& filename)
+    {
+      std::shared_ptr<Series> s = modify(true);
+      size_t n = 0;
+      {
+        ReleaseGil gil;
+        n = s->update(filename);
+      }
+      series = s;
+      return n;
+    }
+};
+
+np::ndarray seriesDate(const PySeries& self)
+{
+  SeriesPtr s = self.get();
+  return view(s->getDate().data(), s->getDate().size(), own(new SeriesPtr(s)));
+}
+
+#define SERIES_COLUMN(name, getter) \
+np::ndarray name(const PySeries& self) \
+{ \
+  SeriesPtr s = self.get(); \
+  return view(s->getter().data(), s->getter().size(), own(new SeriesPtr(s))); \
+}
+SERIES_COLUMN(seriesOpen, getOpen)
+SERIES_COLUMN(seriesHigh, getHigh)
+SERIES_COLUMN(seriesLow, getLow)
+SERIES_COLUMN(seriesClose, getClose)
+SERIES_COLUMN(seriesVolume, getVolume)
+SERIES_COLUMN(seriesAdjClose, getAdjClose)
+SERIES_COLUMN(seriesReturn, getRreturn)
+#undef SERIES_COLUMN
+
+void seriesLoad(PySeries& s, const string& symbol, const string& filename)
+{
+  s.load(symbol, filename);
+}
+
+size_t seriesUpdate(PySeries& s, const string& filename)
+{
+  return s.update(filename);
+}
+
+bool seriesIsStale(const PySeries& s, const string& filename)
+{
+  return (*s).isStale(filename);
+}
+
+size_t seriesSize(const PySeries& s)
+{
+  return (*s).getDate().size();
+}
+
+string seriesSymbol(const PySeries& s)
+{
+  return (*s).getSymbol();
+}
+
+// ---- Portfolio ----
+
+void portfolioAddSeries(Portfolio& p, const string& symbol)
+{
+  ReleaseGil gil;
+  p.addSeries(symbol);
+}
+
+bool portfolioRefresh(Portfolio& p)
+{
+  ReleaseGil gil;
+  return p.refresh();
+}
+
+void portfolioOptimize(Portfolio& p, double roi)
+{
+  ReleaseGil gil;
+  p.optimize(roi);
+}
+
+void portfolioSetBounds(Portfolio& p, double lower, double upper)
+{
+  p.setBounds(lower, upper);
+}
+
+void portfolioSetSymbolBounds(Portfolio& p, const string& symbol, double lower, double upper)
+{
+  p.setBounds(symbol, lower, upper);
+}
+
+void portfolioSetMissingData(Portfolio& p, const string& policy)
+{
+  p.setMissingData(Alignment::parsePolicy(policy));
+}
+
+bp::list portfolioSymbols(const Portfolio& p)
+{
+  bp::list symbols;
+  vector<string> names = p.getSymbols();
+  for(size_t idx=0; idx<names.size(); idx++) symbols.append(names[idx]);
+  return symbols;
+}
+
+// (1 x N) rows of a portfolio, as vectors
+np::ndarray row(const mat& m, bp::object owner)
+{
+  return view(m.memptr(), m.n_elem, owner);
+}
+
+// a copy of a (1 x N) row of a portfolio
+np::ndarray copyRow(const mat& m)
+{
+  mat* copy = new mat(m);
+  bp::object owner = own(copy);
+  return row(*copy, owner);
+}
+
+np::ndarray portfolioWeights(const Portfolio& p)
+{
+  return copyRow(p.getWeights());
+}
+
+np::ndarray portfolioReturn(const Portfolio& p)
+{
+  return copyRow(p.getReturn());
+}
+
+np::ndarray portfolioVolatility(const Portfolio& p)
+{
+  return copyRow(p.getVolatility());
+}
+
+np::ndarray portfolioReturnWindow(const Portfolio& p)
+{
+  return result(new mat(p.getReturnWindow()));
+}
+
+bp::dict portfolioMoments(Portfolio& p, int length, time_t last)
+{
+  unique_ptr<mat> mean(new mat());
+  unique_ptr<mat> covariance(new mat());
+  int days = 0;
+  {
+    ReleaseGil gil;
+    days = p.moments(length, last, *mean, *covariance);
+  }
+  bp::dict d;
+  const mat* m = mean.get();
+  bp::object owner = own(mean.release());
+  d["mean"] = row(*m, owner);
+  d["covariance"] = result(covariance.release());
+  d["days"] = days;
+  return d;
+}
+
+bp::dict frontierDict(Frontier& f)
+{
+  bp::dict d;
+  d["rreturn"] = result(new vector<double>(std::move(f.rreturn)));
+  d["volatility"] = result(new vector<double>(std::move(f.volatility)));
+  d["weights"] = result(new mat(std::move(f.weights)));
+  return d;
+}
+
+bp::dict portfolioFrontier(Portfolio& p, bp::object targets)
+{
+  vector<double> t = toVector<double>(targets);
+  Frontier f;
+  {
+    ReleaseGil gil;
+    f = p.frontier(t);
+  }
+  return frontierDict(f);
+}
+
+bp::dict portfolioResample(Portfolio& p, bp::object targets, size_t nresamples,
+                           int block, uint64_t seed)
+{
+  vector<double> t = toVector<double>(targets);
+  Frontier f;
+  {
+    ReleaseGil gil;
+    f = p.resample(t, nresamples, block, seed);
+  }
+  return frontierDict(f);
+}
+
+bp::dict portfolioBacktest(Portfolio& p, double roi, int rebalance)
+{
+  Backtest bt;
+  {
+    ReleaseGil gil;
+    bt = p.backtest(roi, rebalance);
+  }
+  bp::dict d;
+  d["date"] = result(new vector<time_t>(bt.date.begin(), bt.date.end()));
+  d["rreturn"] = result(new vector<double>(std::move(bt.rreturn)));
+  d["rebalance"] = result(new vector<time_t>(bt.rebalance.begin(), bt.rebalance.end()));
+  d["weights"] = result(new mat(std::move(bt.weights)));
+  d["portfolio_rreturn"] = bt.portfolio_rreturn;
+  d["portfolio_volatility"] = bt.portfolio_volatility;
+  return d;
+}
+
+bp::dict portfolioRisk(Portfolio& p, bp::object horizons, bp::object levels,
+                       size_t npaths, uint64_t seed)
+{
+  vector<int> h = toVector<int>(horizons);
+  vector<double> l = toVector<double>(levels);
+  Risk risk;
+  {
+    ReleaseGil gil;
+    risk = p.risk(h, l, npaths, seed);
+  }
+  bp::dict d;
+  d["horizon"] = result(new vector<int>(risk.horizon));
+  d["level"] = result(new vector<double>(risk.level));
+  d["var"] = result(new mat(std::move(risk.var)));
+  d["cvar"] = result(new mat(std::move(risk.cvar)));
+  d["mean"] = result(new vector<double>(risk.mean));
+  d["paths"] = risk.paths;
+  return d;
+}
+
+// ---- optimizer of a returns matrix ----
+
+// minimum-variance weights for an annualized target return (percent),
+// from an (M x N) matrix of daily returns (one column per stock);
+// float64 Fortran-ordered arrays are used in place, others are copied
+bp::dict optimizeReturns(np::ndarray returns, double roi, int nfactors,
+                         double lower, double upper)
+{
+  if(2!=returns.get_nd()) throw runtime_error("Returns must be a two dimensional array.");
+  if(np::dtype::get_builtin<double>()!=returns.get_dtype()) 
+  {
+    returns = returns.astype(np::dtype::get_builtin<double>());
+  }
+  int ns = returns.shape(0);
+  int np_ = returns.shape(1);
+  if(ns<2 || np_<2) throw runtime_error("Optimization requires at least two stocks and two dates.");
+  unique_ptr<mat> x;
+  if(returns.get_flags() & np::ndarray::F_CONTIGUOUS) 
+  {
+    x.reset(new mat(reinterpret_cast<double*>(returns.get_data()), ns, np_, false, true));
+  } else {
+    x.reset(new mat(ns, np_));
+    const char* data = returns.get_data();
+    Py_intptr_t const* strides = returns.get_strides();
+    for(int c=0; c<np_; c++) 
+    {
+      for(int r=0; r<ns; r++) 
+      {
+        (*x)(r,c) = *reinterpret_cast<const double*>(data + r*strides[0] + c*strides[1]);
+      }
+    }
+  }
+  const int horizon = Portfolio::getTimeHorizon();
+  double mu_opt = roi/(horizon*100);
+  unique_ptr<mat> w(new mat());
+  double variance = 0;
+  {
+    ReleaseGil gil;
+    mat mu(1, np_);
+    mat s(np_, np_);
+    mat sigma(1, np_);
+    Kernels::moments(x->memptr(), ns, np_, mu.memptr(), s.memptr(), sigma.memptr());
+    FactorModel factors;
+    if(nfactors>0) 
+    {
+      factors.estimate(*x, nfactors);
+      s = factors.getCovariance();
+    }
+    if(isfinite(lower) || isfinite(upper)) 
+    {
+      vec lo(np_);
+      vec hi(np_);
+      lo.fill(lower);
+      hi.fill(upper);
+      ActiveSetSolver qp;
+      qp.setProblem(s, mu, lo, hi);
+      *w = qp.solve(mu_opt).t();
+    } else {
+      mat w1;
+      mat w0;
+      if(nfactors>0) 
+      {
+        mat m(np_, 2);
+        for(int c=0; c<np_; c++) { m(c,0) = mu(0,c); m(c,1) = 1; }
+        Portfolio::schurBasis(m, factors.solve(m), w1, w0);
+      } else {
+        Portfolio::solveBasis(s, mu, w1, w0);
+      }
+      *w = mu_opt*w1 + w0;
+    }
+    variance = as_scalar((*w)*s*w->t());
+  }
+  bp::dict d;
+  const mat* weights = w.get();
+  bp::object owner = own(w.release());
+  d["weights"] = row(*weights, owner);
+  d["rreturn"] = roi;
+  d["volatility"] = sqrt(max(variance, 0.0))*sqrt(static_cast<double>(horizon))*100;
+  return d;
+}
+
+}
+
+BOOST_PYTHON_MODULE(pyMarkowitz)
+{
+  np::initialize();
+  bp::class_<PySeries, boost::noncopyable>("Series")
+    .def("load", &seriesLoad, (bp::arg("symbol"), bp::arg("filename")),
+         "load a Yahoo! Finance CSV file")
+    .def("update", &seriesUpdate, (bp::arg("filename")),
+         "add the records appended to the CSV file, returns their number")
+    .def("isStale", &seriesIsStale)
+    .def("__len__", &seriesSize)
+    .add_property("symbol", &seriesSymbol)
+    .add_property("date", &seriesDate)
+    .add_property("open", &seriesOpen)
+    .add_property("high", &seriesHigh)
+    .add_property("low", &seriesLow)
+    .add_property("close", &seriesClose)
+    .add_property("volume", &seriesVolume)
+    .add_property("adj_close", &seriesAdjClose)
+    .add_property("rreturn", &seriesReturn)
+  ;
+  bp::class_<Portfolio, boost::noncopyable>("Portfolio", bp::init<string>(
+      (bp::arg("datapath")=string("."))))
+    .def("addSeries", &portfolioAddSeries)
+    .def("refresh", &portfolioRefresh)
+    .def("setFactorModel", &Portfolio::setFactorModel)
+    .def("setBounds", &portfolioSetBounds)
+    .def("setBounds", &portfolioSetSymbolBounds)
+    .def("setMissingData", &portfolioSetMissingData)
+    .def("setWindow", &Portfolio::setWindow, 
+         (bp::arg("length"), bp::arg("last")=numeric_limits<time_t>::max()))
+    .def("moments", &portfolioMoments, 
+         (bp::arg("length"), bp::arg("last")=numeric_limits<time_t>::max()),
+         "daily mean and covariance of the length days of returns ending on last")
+    .def("optimize", &portfolioOptimize, (bp::arg("roi")))
+    .def("frontier", &portfolioFrontier, (bp::arg("targets")))
+    .def("resample", &portfolioResample, 
+         (bp::arg("targets"), bp::arg("resamples")=Resampler::DEFAULT_RESAMPLES, 
+          bp::arg("block")=1, bp::arg("seed")=1))
+    .def("backtest", &portfolioBacktest, (bp::arg("roi"), bp::arg("rebalance")))
+    .def("risk", &portfolioRisk, 
+         (bp::arg("horizons"), bp::arg("levels"), 
+          bp::arg("paths")=MonteCarlo::DEFAULT_PATHS, bp::arg("seed")=1))
+    .def("__str__", &Portfolio::toString)
+    .add_property("symbols", &portfolioSymbols)
+    .add_property("weights", &portfolioWeights)
+    .add_property("rreturn", &portfolioReturn)
+    .add_property("volatility", &portfolioVolatility)
+    .add_property("returns", &portfolioReturnWindow)
+    .add_property("portfolio_rreturn", &Portfolio::getPortfolioReturn)
+    .add_property("portfolio_volatility", &Portfolio::getPortfolioVolatility)
+  ;
+  bp::def("optimize", &optimizeReturns, 
+          (bp::arg("returns"), bp::arg("roi"), bp::arg("factors")=0,
+           bp::arg("lower")=-numeric_limits<double>::infinity(),
+           bp::arg("upper")=numeric_limits<double>::infinity()),
+          "minimum-variance weights of an (M x N) matrix of daily returns");
+}
+
+// *EOF*
@@ -0,0 +1,47 @@
+// SyntheticDatabase.hxx
+// Mac Radigan
+//
+// Description:  A test fixture holding a synthetic quote database:  the
+//               CSV files of a synthetic market, written under a
+//               temporary directory named for the test and the process,
+//               and removed at the end of a test.
+//
+
+#include "quant.hxx"
+#include "SyntheticMarket.hxx"
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <string>
+#include <unistd.h>
+
+#ifndef SYNTHETICDATABASE_HXX
+#define SYNTHETICDATABASE_HXX
+
+NS_QUANT_BEGIN
+
+struct SyntheticDatabase
+{
+  boost::filesystem::path root;       // temporary directory
+  boost::filesystem::path database;   // quote database (under root)
+  SyntheticMarket market;
+  // nsymbols stocks of ndays quotes, written to root/directory
+  SyntheticDatabase(const std::string& name, int nsymbols, int ndays,
+                    const std::string& directory="")
+    : root(boost::filesystem::temp_directory_path() /
+           (name+"."+boost::lexical_cast<std::string>(getpid()))),
+      database(directory.empty() ? root : root / directory),
+      market(nsymbols, ndays)
+  {
+    market.write(database.string());
+  }
+  ~SyntheticDatabase()
+  {
+    boost::filesystem::remove_all(root);
+  }
+};
+
+NS_QUANT_END
+
+#endif
+
+// *EOF*
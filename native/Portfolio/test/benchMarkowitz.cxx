@@ -0,0 +1,338 @@
+// benchMarkowitz.cxx
+// Mac Radigan
+//
+// Description:  Benchmarks the stages of a portfolio optimization on
+//               synthetic markets of increasing size:  quote parsing
+//               (CSV, newest window only, and sidecar), date alignment,
+//               covariance moments (of the window, and of any window
+//               from a moment index), the KKT (Cholesky) solve (and its fixed-size form for
+//               small portfolios), cold and warm optimization
+//               (sample and factor covariance), the resampled frontier,
+//               the universe subset search and report rendering.
+//
+//               Results are written as JSON lines, one record per
+//               benchmark and market size, with the minimum and median
+//               time of the repetitions;  an output file is appended
+//               to, so that a file of runs can be tracked over time.
+//
+// Usage:        ./bin/benchMarkowitz [-n 4,50,500,5000] [-y years]
+//                                    [-r repetitions] [-b budget]
+//                                    [-F formats] [-o results.jsonl]
+//
+
+#include "quant.hxx"
+#include "SyntheticMarket.hxx"
+#include "Series.hxx"
+#include "SeriesCache.hxx"
+#include "Alignment.hxx"
+#include "Kernels.hxx"
+#include "Cholesky.hxx"
+#include "SmallKkt.hxx"
+#include "MomentIndex.hxx"
+#include "Portfolio.hxx"
+#include "Renderer.hxx"
+#include "Universe.hxx"
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <time.h>
+#include <unistd.h>
+
+USING_QUANT
+using namespace std;
+namespace po = boost::program_options;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// seconds per call of f, in up to reps repetitions (fewer once budget 
+// seconds are spent);  the first call warms up and calibrates the calls
+// per repetition, so that a repetition takes at least a millisecond
+static vector<double> measure(int reps, double budget, const function<void()>& f)
+{
+  double t0 = now();
+  f();
+  double once = now()-t0;
+  int ncalls = once>=1e-3 ? 1 : static_cast<int>(min(1e-3/max(once,1e-9), 1e6))+1;
+  vector<double> seconds;
+  double total = once;
+  for(int rIdx=0; rIdx<reps && (0==rIdx || total<budget); rIdx++)
+  {
+    t0 = now();
+    for(int cIdx=0; cIdx<ncalls; cIdx++) f();
+    double elapsed = now()-t0;
+    seconds.push_back(elapsed/ncalls);
+    total += elapsed;
+  }
+  return seconds;
+}
+
+struct Context
+{
+  ostream* out;
+  string timestamp;
+  int days;
+};
+
+// one JSON record:  items processed per repetition, in units
+static void emit(const Context& context, const string& name, int nsymbols,
+                 vector<double> seconds, double items, const string& unit)
+{
+  sort(seconds.begin(), seconds.end());
+  double best = seconds.front();
+  double median = seconds[seconds.size()/2];
+  *context.out << setprecision(6)
+               << "{\"benchmark\":\"" << name << "\""
+               << ",\"symbols\":" << nsymbols
+               << ",\"days\":" << context.days
+               << ",\"isa\":\"" << Kernels::getIsa() << "\""
+               << ",\"timestamp\":\"" << context.timestamp << "\""
+               << ",\"repetitions\":" << seconds.size()
+               << ",\"min_s\":" << best
+               << ",\"median_s\":" << median
+               << ",\"items\":" << items
+               << ",\"unit\":\"" << unit << "\""
+               << ",\"items_per_s\":" << (best>0 ? items/best : 0)
+               << "}" << endl;
+}
+
+static void bench(const Context& context, int nsymbols, int reps, double budget,
+                  const vector<string>& formats, const boost::filesystem::path& root)
+{
+  boost::filesystem::path database = root / ("market-"+boost::lexical_cast<string>(nsymbols));
+  boost::filesystem::path results = root / ("results-"+boost::lexical_cast<string>(nsymbols));
+  boost::filesystem::create_directories(results);
+  int ndays = context.days;
+  double rows = static_cast<double>(nsymbols)*ndays;
+  SyntheticMarket market(nsymbols, ndays);
+  const vector<string>& symbols = market.getSymbols();
+  vector<string> files;
+  for(int sIdx=0; sIdx<nsymbols; sIdx++)
+  {
+    files.push_back((database / symbols[sIdx] / (symbols[sIdx]+".csv")).string());
+  }
+  double t0 = now();
+  market.write(database.string());
+  emit(context, "generate", nsymbols, vector<double>(1, now()-t0), rows, "rows");
+  // quote parsing
+  vector<Series> series(nsymbols);
+  Series::setSidecarEnabled(false);
+  emit(context, "parse", nsymbols, measure(reps, budget, [&]() {
+    for(int sIdx=0; sIdx<nsymbols; sIdx++) series[sIdx].load(symbols[sIdx], files[sIdx]);
+  }), rows, "rows");
+  // only the newest records of a window (lazy loading)
+  size_t nrecent = Portfolio::getDefaultWindowLength()+1;
+  vector<Series> recent(nsymbols);
+  emit(context, "parse/lazy", nsymbols, measure(reps, budget, [&]() {
+    for(int sIdx=0; sIdx<nsymbols; sIdx++) recent[sIdx].load(symbols[sIdx], files[sIdx], nrecent);
+  }), static_cast<double>(nsymbols)*min(nrecent, static_cast<size_t>(ndays)), "rows");
+  Series::setSidecarEnabled(true);
+  for(int sIdx=0; sIdx<nsymbols; sIdx++) series[sIdx].load(symbols[sIdx], files[sIdx]);
+  emit(context, "sidecar", nsymbols, measure(reps, budget, [&]() {
+    for(int sIdx=0; sIdx<nsymbols; sIdx++) series[sIdx].load(symbols[sIdx], files[sIdx]);
+  }), rows, "rows");
+  // date alignment of the newest window
+  vector<const Series*> members;
+  for(int sIdx=0; sIdx<nsymbols; sIdx++) members.push_back(&series[sIdx]);
+  Alignment alignment;
+  mat x;
+  vector<time_t> dates;
+  const int nwindow = 250;
+  vector<double> seconds = measure(reps, budget, [&]() {
+    alignment.align(members, MISSING_DROP, nwindow, x, dates);
+  });
+  emit(context, "align", nsymbols, seconds, static_cast<double>(x.n_rows)*nsymbols, "returns");
+  // covariance:  mean, upper triangle of the covariance and volatility
+  int ns = x.n_rows;
+  mat mu(1, nsymbols);
+  mat covariance(nsymbols, nsymbols);
+  mat sigma(1, nsymbols);
+  emit(context, "moments", nsymbols, measure(reps, budget, [&]() {
+    Kernels::moments(x.memptr(), ns, nsymbols, mu.memptr(), covariance.memptr(), sigma.memptr());
+  }), 0.5*ns*nsymbols*(nsymbols+1.0), "madd");
+  // moments of any window from an index of the whole history (which
+  // holds (T/stride)*N^2/2 doubles, so the largest markets are skipped)
+  if(nsymbols<=500)
+  {
+    mat panel;
+    vector<time_t> newest;
+    alignment.align(members, MISSING_DROP, 0, panel, newest);
+    int nt = panel.n_rows;
+    mat history(nsymbols, nt);
+    for(int t=0; t<nt; t++)
+    {
+      for(int sIdx=0; sIdx<nsymbols; sIdx++) history(sIdx, nt-1-t) = panel(t, sIdx);
+    }
+    vector<time_t> oldest(newest.rbegin(), newest.rend());
+    MomentIndex index;
+    emit(context, "moments/index", nsymbols, measure(reps, budget, [&]() {
+      index.build(history, oldest);
+    }), 0.5*nt*nsymbols*(nsymbols+1.0), "madd");
+    // windows of 60, 120 and 250 days, ending on every 10th date
+    const int lengths[] = { 60, 120, 250 };
+    double nqueries = 0;
+    for(int lIdx=0; lIdx<3; lIdx++)
+    {
+      for(int end=lengths[lIdx]; end<=nt; end+=10) nqueries++;
+    }
+    mat m;
+    mat s;
+    emit(context, "moments/query", nsymbols, measure(reps, budget, [&]() {
+      for(int lIdx=0; lIdx<3; lIdx++)
+      {
+        for(int end=lengths[lIdx]; end<=nt; end+=10) index.moments(end-lengths[lIdx], end, m, s);
+      }
+    }), nqueries, "windows");
+  }
+  // KKT solve S^-1*[mu 1v] by Cholesky;  the covariance is shrunk
+  // toward its diagonal, so it is definite when nsymbols>=ndays
+  mat s = 0.9*covariance;
+  for(int sIdx=0; sIdx<nsymbols; sIdx++) s(sIdx,sIdx) += 0.1*covariance(sIdx,sIdx);
+  mat border(nsymbols, 2);
+  for(int sIdx=0; sIdx<nsymbols; sIdx++) { border(sIdx,0) = mu(0,sIdx); border(sIdx,1) = 1; }
+  Cholesky cholesky;
+  mat y;
+  emit(context, "kkt", nsymbols, measure(reps, budget, [&]() {
+    cholesky.factor(s);
+    cholesky.solve(border, y);
+  }), nsymbols*static_cast<double>(nsymbols)*nsymbols/3, "flop");
+  // the same solve, specialized on the number of stocks
+  if(nsymbols<=SmallKkt::MAX_STOCKS)
+  {
+    mat w1(1, nsymbols);
+    mat w0(1, nsymbols);
+    emit(context, "kkt/fixed", nsymbols, measure(reps, budget, [&]() {
+      SmallKkt::basis(nsymbols, s.memptr(), mu.memptr(), w1.memptr(), w0.memptr());
+    }), nsymbols*static_cast<double>(nsymbols)*nsymbols/3, "flop");
+  }
+  // optimization:  cold (align, estimate and solve) and warm (solve)
+  SeriesCache cache;
+  for(int nfactors=0; nfactors<=3; nfactors+=3)
+  {
+    string model = nfactors>0 ? "factor" : "sample";
+    unique_ptr<Portfolio> portfolio;
+    emit(context, "optimize/"+model, nsymbols, measure(reps, budget, [&]() {
+      portfolio.reset(new Portfolio(database.string(), cache));
+      portfolio->setFactorModel(nfactors);
+      for(int sIdx=0; sIdx<nsymbols; sIdx++) portfolio->addSeries(symbols[sIdx]);
+      portfolio->optimize(20);
+    }), nsymbols, "symbols");
+    double roi = 10;
+    emit(context, "resolve/"+model, nsymbols, measure(reps, budget, [&]() {
+      portfolio->optimize(roi);
+      roi += 0.5;
+    }), nsymbols, "symbols");
+    if(nfactors>0) continue;
+    // resampled frontier:  bootstrap resamples of the window, each
+    // estimated and solved for every target
+    const size_t nresamples = 1000;
+    vector<double> targets;
+    for(int tIdx=0; tIdx<=10; tIdx++) targets.push_back(2.0*tIdx);
+    emit(context, "resample", nsymbols, measure(reps, budget, [&]() {
+      portfolio->resample(targets, nresamples);
+    }), nresamples, "resamples");
+    // universe subset search:  4-stock subsets, every subset of the 
+    // smaller markets, a sample of the larger
+    if(nsymbols>=4)
+    {
+      Universe universe(database.string(), cache);
+      for(int sIdx=0; sIdx<nsymbols; sIdx++) universe.addSeries(symbols[sIdx]);
+      universe.estimate();
+      const uint64_t nsubsets = Universe::choose(nsymbols, 4);
+      const size_t nsamples = nsubsets>100000 ? 100000 : 0;
+      emit(context, "search", nsymbols, measure(reps, budget, [&]() {
+        universe.search(4, 20, 10, nsamples);
+      }), nsamples>0 ? nsamples : nsubsets, "subsets");
+    }
+    // report:  figures composed, rendered and written
+    portfolio->setFormats(formats);
+    emit(context, "report", nsymbols, measure(reps, budget, [&]() {
+      Renderer renderer(1, false);
+      portfolio->createReport(results.string(), renderer);
+    }), nsymbols+1, "figures");
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  po::options_description desc("options");
+  desc.add_options()
+    ("symbols,n", po::value<string>()->default_value("4,50,500,5000"),
+       "comma separated market sizes (number of stocks)")
+    ("years,y", po::value<double>()->default_value(2), "years of daily quotes")
+    ("repetitions,r", po::value<int>()->default_value(5), "repetitions of each benchmark")
+    ("budget,b", po::value<double>()->default_value(2),
+       "seconds after which a benchmark is not repeated")
+    ("formats,F", po::value<string>()->default_value("gnuplot"),
+       "report formats (gnuplot scripts need no gnuplot session)")
+    ("directory,d", po::value<string>(), "working directory (default: temporary)")
+    ("output,o", po::value<string>(), "append results to a file (default: stdout)")
+    ("help,h", "print this help message")
+  ;
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc,argv,desc),vm);
+  po::notify(vm);
+  if(vm.count("help")) { cout << desc << endl; return 1; }
+  vector<string> sizes;
+  vector<string> formats;
+  boost::algorithm::split(sizes, vm["symbols"].as<string>(), boost::algorithm::is_any_of(", "),
+                          boost::algorithm::token_compress_on);
+  boost::algorithm::split(formats, vm["formats"].as<string>(), boost::algorithm::is_any_of(", "),
+                          boost::algorithm::token_compress_on);
+  boost::filesystem::path root;
+  bool temporary = !vm.count("directory");
+  if(temporary)
+  {
+    stringstream ss;
+    ss << "benchMarkowitz." << getpid();
+    root = boost::filesystem::temp_directory_path() / ss.str();
+  } else {
+    root = vm["directory"].as<string>();
+  }
+  std::ofstream file;
+  Context context;
+  context.out = &cout;
+  if(vm.count("output"))
+  {
+    file.open(vm["output"].as<string>().c_str(), ios::app);
+    if(!file.is_open()) { cerr << "unable to open " << vm["output"].as<string>() << endl; return 1; }
+    context.out = &file;
+  }
+  char timestamp[32];
+  time_t t = time(NULL);
+  struct tm tm;
+  strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&t, &tm));
+  context.timestamp = timestamp;
+  context.days = static_cast<int>(vm["years"].as<double>()*SyntheticMarket::DAYS_PER_YEAR);
+  int status = 0;
+  try
+  {
+    BOOST_FOREACH(const string& size, sizes)
+    {
+      bench(context, boost::lexical_cast<int>(size), vm["repetitions"].as<int>(),
+            vm["budget"].as<double>(), formats, root);
+    }
+  } catch(exception& e) {
+    cerr << "exception: " << e.what() << endl;
+    status = 1;
+  }
+  if(temporary) boost::filesystem::remove_all(root);
+  return status;
+}
+
+// *EOF*
@@ -0,0 +1,89 @@
+// benchSeries.cxx
+// Mac Radigan
+//
+// Description:  Compares the load throughput (rows/sec) of the
+//               memory-mapped quote parser and the binary sidecar
+//               against the stream parser, on a Yahoo! Finance 
+//               CSV file, and the throughput of the return kernels
+//               (scalar and vector).
+//
+// Usage:        ./bin/benchSeries file.csv [repetitions]
+//
+
+#include "quant.hxx"
+#include "Series.hxx"
+#include "Kernels.hxx"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <sys/time.h>
+
+USING_QUANT
+using namespace std;
+
+static double now() 
+{
+  struct timeval tv;
+  gettimeofday(&tv,NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+static void report(const char* name, size_t rows, int reps, double seconds) 
+{
+  cout << setiosflags(ios::fixed) << setprecision(0)
+       << name << "\t" 
+       << rows << " rows x " << reps << "\t"
+       << setprecision(3) << seconds << " s\t"
+       << setprecision(0) << (rows*reps)/seconds << " rows/sec"
+       << endl;
+}
+
+int main(int argc, char* argv[]) 
+{
+  if(argc<2) { cerr << "usage: " << argv[0] << " file.csv [repetitions]" << endl; return 1; }
+  string filename(argv[1]);
+  int reps = argc>2 ? atoi(argv[2]) : 20;
+  size_t rows = 0;
+  double t0 = now();
+  for(int idx=0; idx<reps; idx++) {
+    Series series;
+    series.loadStream("BENCH",filename);
+    rows = series.getClose().size();
+  }
+  report("stream", rows, reps, now()-t0);
+  Series::setSidecarEnabled(false);
+  t0 = now();
+  for(int idx=0; idx<reps; idx++) {
+    Series series;
+    series.load("BENCH",filename);
+    rows = series.getClose().size();
+  }
+  report("mmap  ", rows, reps, now()-t0);
+  Series::setSidecarEnabled(true);
+  { Series series; series.load("BENCH",filename); } // build the sidecar
+  t0 = now();
+  for(int idx=0; idx<reps; idx++) {
+    Series series;
+    series.load("BENCH",filename);
+    rows = series.getClose().size();
+  }
+  report("sidecar", rows, reps, now()-t0);
+  Series series;
+  series.load("BENCH",filename);
+  const DoubleColumn& close = series.getClose();
+  DoubleColumn r(close.size());
+  int kreps = reps*100;
+  for(int vectorized=0; vectorized<2; vectorized++) {
+    Kernels::setVectorized(vectorized);
+    t0 = now();
+    for(int idx=0; idx<kreps; idx++) {
+      Kernels::simpleReturns(&close[0], close.size(), &r[0]);
+    }
+    string name = string("returns/") + Kernels::getIsa();
+    report(name.c_str(), rows, kreps, now()-t0);
+  }
+  return 0;
+}
+
+// *EOF*
@@ -0,0 +1,78 @@
+// genMarket.cxx
+// Mac Radigan
+//
+// Description:  Writes a deterministic synthetic quote database of
+//               correlated stocks (and optionally an input data file
+//               for a portfolio of its first stocks), for tests and
+//               benchmarks.
+//
+// Usage:        ./bin/genMarket -d database [-n symbols | -S AAA,BBB]
+//                               [-y years] [--seed seed] [-k factors]
+//                               [-p portfolio.xml [-o output] [--stocks n]]
+//
+
+#include "quant.hxx"
+#include "SyntheticMarket.hxx"
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+USING_QUANT
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+  po::options_description desc("options");
+  desc.add_options()
+    ("database,d", po::value<string>(), "quote database directory")
+    ("symbols,n", po::value<int>()->default_value(4), "number of stocks")
+    ("names,S", po::value<string>(), "comma separated stock symbols")
+    ("years,y", po::value<double>()->default_value(2), "years of daily quotes")
+    ("seed", po::value<uint64_t>()->default_value(1), "random seed")
+    ("factors,k", po::value<int>()->default_value(3), "number of return factors")
+    ("portfolio,p", po::value<string>(), "write an input data file")
+    ("output,o", po::value<string>()->default_value("./results"),
+       "report directory of the input data file")
+    ("stocks", po::value<int>()->default_value(4), "stocks of the input data file")
+    ("roi", po::value<double>()->default_value(20), "target return of the input data file")
+    ("help,h", "print this help message")
+  ;
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc,argv,desc),vm);
+  po::notify(vm);
+  if(vm.count("help") || !vm.count("database")) { cout << desc << endl; return 1; }
+  try
+  {
+    int ndays = static_cast<int>(vm["years"].as<double>()*SyntheticMarket::DAYS_PER_YEAR);
+    uint64_t seed = vm["seed"].as<uint64_t>();
+    int nfactors = vm["factors"].as<int>();
+    string database = vm["database"].as<string>();
+    vector<string> names;
+    if(vm.count("names"))
+    {
+      boost::algorithm::split(names, vm["names"].as<string>(), boost::algorithm::is_any_of(", "),
+                              boost::algorithm::token_compress_on);
+    }
+    SyntheticMarket market = names.empty()
+      ? SyntheticMarket(vm["symbols"].as<int>(), ndays, seed, nfactors)
+      : SyntheticMarket(names, ndays, seed, nfactors);
+    market.write(database);
+    if(vm.count("portfolio"))
+    {
+      boost::filesystem::create_directories(vm["output"].as<string>());
+      market.writePortfolio(vm["portfolio"].as<string>(), database,
+                            vm["output"].as<string>(), vm["stocks"].as<int>(),
+                            vm["roi"].as<double>());
+    }
+  } catch(exception& e) {
+    cerr << "exception: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// *EOF*
@@ -3,8 +3,173 @@
 ## Mac Radigan
 #
 ## Unit tests through Boost Python interface
+#
+#    PYTHONPATH=./lib python ./test/test2.py
 
+import os
+import shutil
+import tempfile
+import threading
+import unittest
+import math
+import random
+import numpy
 import pyMarkowitz
-markowitz = pyMarkowitz.Portfolio()
+
+SYMBOLS = ['AAA', 'BBB', 'CCC', 'DDD']
+DAYS = 300
+
+def writeDatabase(path):
+  ## <database>/<SYM>/<SYM>.csv, newest first
+  rng = random.Random(3)
+  for sIdx, symbol in enumerate(SYMBOLS):
+    os.makedirs(os.path.join(path, symbol))
+    price = 50.0 + 10*sIdx
+    lines = []
+    for day in range(DAYS):
+      price *= 1 + 0.0004*(sIdx+1) + rng.gauss(0, 0.01+0.003*sIdx)
+      date = '%d-%02d-%02d' % (2010 + day//336, 1 + day//28 % 12, 1 + day%28)
+      lines.append('%s,%.2f,%.2f,%.2f,%.2f,%d,%.2f\n' % (date, price, price, price, price, 1000, price))
+    with open(os.path.join(path, symbol, symbol+'.csv'), 'w') as f:
+      f.write('Date,Open,High,Low,Close,Volume,Adj Close\n')
+      f.writelines(reversed(lines))
+
+class TestMarkowitz(unittest.TestCase):
+
+  @classmethod
+  def setUpClass(cls):
+    cls.database = tempfile.mkdtemp()
+    writeDatabase(cls.database)
+
+  @classmethod
+  def tearDownClass(cls):
+    shutil.rmtree(cls.database)
+
+  def portfolio(self):
+    p = pyMarkowitz.Portfolio(self.database)
+    for symbol in SYMBOLS:
+      p.addSeries(symbol)
+    return p
+
+  def testConstruct(self):
+    markowitz = pyMarkowitz.Portfolio()
+    self.assertIn('arbitrary portfolio', str(markowitz))
+
+  def testSeries(self):
+    s = pyMarkowitz.Series()
+    s.load('AAA', os.path.join(self.database, 'AAA', 'AAA.csv'))
+    self.assertEqual(len(s), DAYS)
+    self.assertEqual(s.symbol, 'AAA')
+    close = s.close
+    self.assertEqual(close.shape, (DAYS,))
+    self.assertEqual(close.dtype, numpy.float64)
+    ## views of the C++ columns, read-only
+    self.assertFalse(close.flags.owndata)
+    self.assertFalse(close.flags.writeable)
+    self.assertEqual(s.date.shape, (DAYS,))
+    self.assertTrue(s.date[0] > s.date[-1])   # newest first
+    r = s.rreturn
+    self.assertAlmostEqual(r[0], (close[0]-close[1])/close[1], 12)
+    ## a load replaces the series:  views of the previous one are unchanged
+    previous = close.copy()
+    s.load('BBB', os.path.join(self.database, 'BBB', 'BBB.csv'))
+    self.assertEqual(s.symbol, 'BBB')
+    self.assertTrue((close == previous).all())
+    self.assertFalse((s.close == previous).all())
+    ## the view keeps the series alive
+    del s
+    self.assertEqual(close.shape, (DAYS,))
+    self.assertTrue((close == previous).all())
+
+  def testOptimize(self):
+    p = self.portfolio()
+    p.optimize(20)
+    w = p.weights
+    self.assertEqual(w.shape, (len(SYMBOLS),))
+    self.assertFalse(w.flags.owndata)
+    self.assertAlmostEqual(w.sum(), 1.0, 9)
+    self.assertEqual(p.symbols, SYMBOLS)
+    self.assertAlmostEqual(p.portfolio_rreturn, 20)
+    ## results are not changed by the next optimization
+    previous = w.copy()
+    p.optimize(10)
+    self.assertTrue((w == previous).all())
+    self.assertFalse(numpy.allclose(p.weights, previous))
+    p.optimize(20)
+    x = p.returns
+    self.assertEqual(x.shape[1], len(SYMBOLS))
+    self.assertTrue(x.flags.f_contiguous)
+    ## the optimizer of a returns matrix agrees with the portfolio
+    for matrix in (numpy.asfortranarray(x), numpy.ascontiguousarray(x)):
+      result = pyMarkowitz.optimize(matrix, 20)
+      self.assertTrue(numpy.allclose(result['weights'], w, atol=1e-9))
+      self.assertAlmostEqual(result['volatility'], p.portfolio_volatility, 6)
+
+  def testBounded(self):
+    x = self.portfolio()
+    x.optimize(10)
+    result = pyMarkowitz.optimize(numpy.asfortranarray(x.returns), 10, lower=0)
+    self.assertTrue((result['weights'] >= -1e-9).all())
+    self.assertAlmostEqual(result['weights'].sum(), 1.0, 9)
+
+  def testResults(self):
+    p = self.portfolio()
+    p.optimize(20)
+    f = p.frontier([5, 10, 20])
+    self.assertEqual(f['weights'].shape, (3, len(SYMBOLS)))
+    self.assertTrue(numpy.allclose(f['weights'][2], p.weights))
+    risk = p.risk([1, 10], [0.95, 0.99], paths=20000)
+    self.assertEqual(risk['var'].shape, (2, 2))
+    self.assertTrue((risk['cvar'] >= risk['var']).all())
+    resampled = p.resample([20], resamples=50)
+    self.assertAlmostEqual(resampled['weights'][0].sum(), 1.0, 9)
+
+  def testWindow(self):
+    p = self.portfolio()
+    p.setWindow(60)
+    p.optimize(20)
+    x = p.returns
+    self.assertEqual(x.shape, (60, len(SYMBOLS)))
+    ## the moment index agrees with the estimate window
+    m = p.moments(60)
+    self.assertEqual(m['days'], 60)
+    self.assertTrue(numpy.allclose(m['mean'], x.mean(axis=0), rtol=0, atol=1e-14))
+    self.assertTrue(numpy.allclose(m['covariance'], numpy.cov(x, rowvar=False), rtol=0, atol=1e-14))
+    self.assertRaises(RuntimeError, p.setWindow, 1)
+
+  def testErrors(self):
+    p = pyMarkowitz.Portfolio(self.database)
+    self.assertRaises(RuntimeError, p.addSeries, 'MISSING')
+    self.assertRaises(RuntimeError, pyMarkowitz.optimize, numpy.zeros(5), 20)
+
+  def testThreads(self):
+    ## solves release the GIL:  portfolios optimize concurrently, with
+    ## the results of the same portfolios optimized one at a time
+    targets = [5, 10, 15, 20, 25, 30]
+    def run(p, roi):
+      p.optimize(roi)
+      return p.weights, p.portfolio_volatility, p.risk([1, 10], [0.99], 20000, 7)
+    expected = [run(self.portfolio(), roi) for roi in targets]
+    results = [None]*len(targets)
+    errors = []
+    def worker(idx):
+      try:
+        results[idx] = run(self.portfolio(), targets[idx])
+      except Exception as e:
+        errors.append(e)
+    threads = [threading.Thread(target=worker, args=(idx,)) for idx in range(len(targets))]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    self.assertEqual(errors, [])
+    for (w, volatility, risk), (ew, evolatility, erisk) in zip(results, expected):
+      self.assertTrue(numpy.allclose(w, ew, rtol=0, atol=1e-12))
+      self.assertAlmostEqual(volatility, evolatility, 9)
+      self.assertTrue(numpy.allclose(risk['var'], erisk['var'], rtol=0, atol=1e-12))
+      self.assertTrue(numpy.allclose(risk['cvar'], erisk['cvar'], rtol=0, atol=1e-12))
+
+if __name__ == '__main__':
+  unittest.main()
 
 ## *EOF*
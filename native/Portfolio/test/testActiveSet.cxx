@@ -0,0 +1,218 @@
+// testActiveSet.cxx
+// Mac Radigan
+//
+// Description:  Checks the bound-constrained active-set solver:  its
+//               weights are the optimum found by enumerating every
+//               working set (long-only and box-constrained), targets
+//               outside the bounds are refused, and a solve warm
+//               started from a nearby target converges to the same
+//               weights in fewer iterations than a cold start.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testActiveSet
+#include <boost/test/unit_test.hpp>
+#include "ActiveSetSolver.hxx"
+#include <random>
+#include <limits>
+#include <vector>
+
+USING_QUANT
+using namespace std;
+
+// (N x N) covariance of correlated daily returns, and their means
+static void moments(int np, mat& s, mat& mu)
+{
+  mt19937 engine(np);
+  normal_distribution<double> normal(0, 1);
+  mat x(250, np);
+  for(int t=0; t<250; t++)
+  {
+    double market = 0.01*normal(engine);
+    for(int c=0; c<np; c++) x(t,c) = 0.0002*(c+1) + (0.5+0.1*c)*market + 0.01*normal(engine);
+  }
+  mu = mean(x);
+  s = cov(x);
+}
+
+// minimum variance within the bounds, by enumerating every working
+// set:  each stock free, at its lower or at its upper bound (the free
+// stocks solve the equality-constrained problem);  empty if none is
+// feasible
+static vec enumerate(const mat& s, const mat& mu, const vec& lower, const vec& upper, double target)
+{
+  int np = s.n_rows;
+  vec best;
+  double variance = numeric_limits<double>::infinity();
+  int nsets = 1;
+  for(int idx=0; idx<np; idx++) nsets *= 3;
+  for(int set=0; set<nsets; set++)
+  {
+    vector<int> state(np);
+    vector<int> free;
+    vec w(np);
+    w.fill(0);
+    double rreturn = target;
+    double budget = 1;
+    bool bounded = true;
+    for(int idx=0, code=set; idx<np; idx++, code/=3)
+    {
+      state[idx] = code%3;
+      if(0==state[idx]) { free.push_back(idx); continue; }
+      w[idx] = 1==state[idx] ? lower[idx] : upper[idx];
+      if(!std::isfinite(w[idx])) bounded = false;
+      rreturn -= w[idx]*mu(idx);
+      budget -= w[idx];
+    }
+    if(!bounded || free.size()<2) continue;
+    // bordered system of the free stocks
+    int nf = free.size();
+    mat a(nf+2, nf+2);
+    mat b(nf+2, 1);
+    a.fill(0);
+    b.fill(0);
+    for(int r=0; r<nf; r++)
+    {
+      double g = 0;
+      for(int c=0; c<np; c++) if(0!=state[c]) g += s(free[r],c)*w[c];
+      for(int c=0; c<nf; c++) a(r,c) = 2*s(free[r],free[c]);
+      a(r,nf) = a(nf,r) = mu(free[r]);
+      a(r,nf+1) = a(nf+1,r) = 1;
+      b(r,0) = -2*g;
+    }
+    b(nf,0) = rreturn;
+    b(nf+1,0) = budget;
+    mat z;
+    if(!solve(z, a, b)) continue;
+    bool feasible = true;
+    for(int r=0; r<nf; r++)
+    {
+      w[free[r]] = z(r,0);
+      if(z(r,0)<lower[free[r]]-1e-12 || z(r,0)>upper[free[r]]+1e-12) feasible = false;
+    }
+    if(!feasible) continue;
+    double v = as_scalar(w.t()*s*w);
+    if(v<variance) { variance = v; best = w; }
+  }
+  return best;
+}
+
+static void check(const mat& s, const mat& mu, const vec& lower, const vec& upper,
+                  const vector<double>& targets)
+{
+  int np = s.n_rows;
+  ActiveSetSolver qp;
+  qp.setProblem(s, mu, lower, upper);
+  int nsolved = 0;
+  int nbound = 0;
+  for(size_t tIdx=0; tIdx<targets.size(); tIdx++)
+  {
+    vec expected = enumerate(s, mu, lower, upper, targets[tIdx]);
+    if(expected.is_empty())
+    {
+      // not attainable within the bounds
+      BOOST_CHECK_THROW(qp.solve(targets[tIdx]), runtime_error);
+      continue;
+    }
+    vec w = qp.solve(targets[tIdx]);
+    BOOST_CHECK_SMALL(arma::abs(w-expected).max(), 1e-8);
+    BOOST_CHECK_SMALL(accu(w)-1, 1e-10);
+    BOOST_CHECK_SMALL(as_scalar(mu*w)-targets[tIdx], 1e-12);
+    for(int idx=0; idx<np; idx++)
+    {
+      BOOST_CHECK(w[idx]>=lower[idx]-1e-12);
+      BOOST_CHECK(w[idx]<=upper[idx]+1e-12);
+      if(w[idx]<=lower[idx]+1e-12 || w[idx]>=upper[idx]-1e-12) nbound++;
+    }
+    nsolved++;
+  }
+  // some targets are attainable, with active bounds
+  BOOST_CHECK(nsolved>0);
+  BOOST_CHECK(nbound>0);
+}
+
+// daily targets across the range of mean returns
+static vector<double> targets(const mat& mu)
+{
+  vector<double> t;
+  double lo = mu.min();
+  double hi = mu.max();
+  for(int idx=1; idx<10; idx++) t.push_back(lo+(hi-lo)*idx/10);
+  return t;
+}
+
+BOOST_AUTO_TEST_CASE(longonly)
+{
+  const int np = 6;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  vec lower(np);
+  vec upper(np);
+  lower.fill(0);
+  upper.fill(numeric_limits<double>::infinity());
+  check(s, mu, lower, upper, targets(mu));
+}
+
+BOOST_AUTO_TEST_CASE(box)
+{
+  const int np = 6;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  vec lower(np);
+  vec upper(np);
+  lower.fill(-0.1);
+  upper.fill(0.4);
+  // a per-name limit
+  upper[np-1] = 0.25;
+  check(s, mu, lower, upper, targets(mu));
+}
+
+BOOST_AUTO_TEST_CASE(infeasible)
+{
+  const int np = 4;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  vec lower(np);
+  vec upper(np);
+  lower.fill(0);
+  upper.fill(1);
+  ActiveSetSolver qp;
+  qp.setProblem(s, mu, lower, upper);
+  BOOST_CHECK_THROW(qp.solve(mu.max()*1.5), runtime_error);
+  BOOST_CHECK_THROW(qp.solve(mu.min()*0.5), runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(warm)
+{
+  const int np = 40;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  vec lower(np);
+  vec upper(np);
+  lower.fill(0);
+  upper.fill(0.1);
+  double lo = mu.min();
+  double hi = mu.max();
+  ActiveSetSolver qp;
+  qp.setProblem(s, mu, lower, upper);
+  qp.solve(lo+0.60*(hi-lo));
+  for(int idx=1; idx<=5; idx++)
+  {
+    double target = lo+(0.60+0.002*idx)*(hi-lo);
+    // warm started from the previous target
+    vec w = qp.solve(target);
+    int warm = qp.getIterations();
+    // cold start
+    qp.reset();
+    vec v = qp.solve(target);
+    int cold = qp.getIterations();
+    BOOST_CHECK_SMALL(arma::abs(w-v).max(), 1e-10);
+    BOOST_CHECK_LT(warm, cold);
+  }
+}
+
+// *EOF*
@@ -0,0 +1,147 @@
+// testAlignment.cxx
+// Mac Radigan
+//
+// Description:  Checks the date alignment of series with different
+//               trading calendars under each missing data policy.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testAlignment
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include "Alignment.hxx"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <unistd.h>
+
+USING_QUANT
+using namespace std;
+
+// a series quoted on the given days of January 2013 (newest first),
+// with closing price 100+day
+static void writeSeries(const boost::filesystem::path& file, const vector<int>& days)
+{
+  std::ofstream ofs(file.string().c_str());
+  ofs << "Date,Open,High,Low,Close,Volume,Adj Close" << endl;
+  for(size_t dIdx=0; dIdx<days.size(); dIdx++)
+  {
+    char line[128];
+    double price = 100+days[dIdx];
+    snprintf(line, sizeof(line), "2013-01-%02d,%.2f,%.2f,%.2f,%.2f,1000,%.2f",
+             days[dIdx], price, price, price, price, price);
+    ofs << line << endl;
+  }
+}
+
+struct Calendars
+{
+  boost::filesystem::path path;
+  Series a, b, c;
+  vector<const Series*> series;
+  Calendars()
+  {
+    Series::setSidecarEnabled(false);
+    stringstream ss;
+    ss << "testAlignment." << getpid();
+    path = boost::filesystem::temp_directory_path() / ss.str();
+    boost::filesystem::create_directories(path);
+    int da[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };   // every day
+    int db[] = { 10, 9, 8, 6, 5, 4, 3, 2, 1 };      // halted on the 7th
+    int dc[] = { 10, 9, 8, 7, 6, 5 };               // listed on the 5th
+    writeSeries(path / "A.csv", vector<int>(da, da+10));
+    writeSeries(path / "B.csv", vector<int>(db, db+9));
+    writeSeries(path / "C.csv", vector<int>(dc, dc+6));
+    a.load("A", (path / "A.csv").string());
+    b.load("B", (path / "B.csv").string());
+    c.load("C", (path / "C.csv").string());
+    series.push_back(&a);
+    series.push_back(&b);
+    series.push_back(&c);
+  }
+  ~Calendars()
+  {
+    boost::filesystem::remove_all(path);
+  }
+};
+
+static int day(time_t t)
+{
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  return tm.tm_mday;
+}
+
+// return of a series on the given day, over its previous quote
+static double rreturn(int today, int previous)
+{
+  return (100.0+today-(100.0+previous))/(100.0+previous);
+}
+
+BOOST_FIXTURE_TEST_SUITE(alignment, Calendars)
+
+BOOST_AUTO_TEST_CASE(drop) {
+  Alignment alignment;
+  mat x;
+  vector<time_t> dates;
+  alignment.align(series, MISSING_DROP, 0, x, dates);
+  // the 7th is missing from B, and C's first return is on the 6th
+  int expected[] = { 10, 9, 8, 6 };
+  BOOST_REQUIRE_EQUAL(x.n_rows, 4u);
+  BOOST_REQUIRE_EQUAL(dates.size(), 4u);
+  for(int r=0; r<4; r++) BOOST_CHECK_EQUAL(day(dates[r]), expected[r]);
+  // the returns on the 8th span the 7th, for every series
+  BOOST_CHECK_CLOSE(x(2,0), rreturn(8,6), 1e-9);
+  BOOST_CHECK_CLOSE(x(2,1), rreturn(8,6), 1e-9);
+  BOOST_CHECK_CLOSE(x(2,2), rreturn(8,6), 1e-9);
+  BOOST_CHECK_CLOSE(x(1,0), rreturn(9,8), 1e-9);
+  BOOST_CHECK_CLOSE(x(3,2), rreturn(6,5), 1e-9);
+  BOOST_CHECK_EQUAL(alignment.getMissing(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ffill) {
+  Alignment alignment;
+  mat x;
+  vector<time_t> dates;
+  alignment.align(series, MISSING_FFILL, 0, x, dates);
+  // every date back to C's first return (the 6th);  B is flat on the 7th
+  int expected[] = { 10, 9, 8, 7, 6 };
+  BOOST_REQUIRE_EQUAL(x.n_rows, 5u);
+  for(int r=0; r<5; r++) BOOST_CHECK_EQUAL(day(dates[r]), expected[r]);
+  BOOST_CHECK_EQUAL(x(3,1), 0.0);
+  BOOST_CHECK_CLOSE(x(2,1), rreturn(8,6), 1e-9);
+  BOOST_CHECK_CLOSE(x(3,0), rreturn(7,6), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(pairwise) {
+  Alignment alignment;
+  mat x;
+  vector<time_t> dates;
+  alignment.align(series, MISSING_PAIRWISE, 0, x, dates);
+  // every date with any return:  the 10th to the 2nd
+  BOOST_REQUIRE_EQUAL(x.n_rows, 9u);
+  BOOST_CHECK_EQUAL(day(dates.front()), 10);
+  BOOST_CHECK_EQUAL(day(dates.back()), 2);
+  BOOST_CHECK(std::isnan(x(3,1)));                // B on the 7th
+  BOOST_CHECK(std::isnan(x(2,1)));                // B on the 8th (since the 6th)
+  BOOST_CHECK_CLOSE(x(2,0), rreturn(8,7), 1e-9);
+  BOOST_CHECK_CLOSE(x(4,1), rreturn(6,5), 1e-9);
+  for(int r=5; r<9; r++) BOOST_CHECK(std::isnan(x(r,2)));   // C before the 6th
+  BOOST_CHECK_EQUAL(alignment.getMissing(), 6u);
+}
+
+BOOST_AUTO_TEST_CASE(window) {
+  Alignment alignment;
+  mat x;
+  vector<time_t> dates;
+  // only the newest rows are merged
+  alignment.align(series, MISSING_PAIRWISE, 3, x, dates);
+  BOOST_REQUIRE_EQUAL(x.n_rows, 3u);
+  BOOST_CHECK_EQUAL(day(dates.back()), 8);
+  BOOST_CHECK_EQUAL(Alignment::parsePolicy("FFill"), MISSING_FFILL);
+  BOOST_CHECK_THROW(Alignment::parsePolicy("zero"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
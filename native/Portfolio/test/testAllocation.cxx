@@ -0,0 +1,127 @@
+// testAllocation.cxx
+// Mac Radigan
+//
+// Description:  Verifies that repeated optimization of the same
+//               portfolio does not allocate on the heap once the
+//               workspace has been sized by the first call.
+//               Heap allocations are counted by interposing the
+//               glibc allocator entry points.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testAllocation
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include "Portfolio.hxx"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <stdlib.h>
+#include <unistd.h>
+
+USING_QUANT
+using namespace std;
+
+static bool counting = false;
+static long allocations = 0;
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* p, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+
+  void* malloc(size_t size)
+  {
+    if(counting) allocations++;
+    return __libc_malloc(size);
+  }
+  void* calloc(size_t n, size_t size)
+  {
+    if(counting) allocations++;
+    return __libc_calloc(n, size);
+  }
+  void* realloc(void* p, size_t size)
+  {
+    if(counting) allocations++;
+    return __libc_realloc(p, size);
+  }
+  void* memalign(size_t alignment, size_t size)
+  {
+    if(counting) allocations++;
+    return __libc_memalign(alignment, size);
+  }
+  void* aligned_alloc(size_t alignment, size_t size)
+  {
+    if(counting) allocations++;
+    return __libc_memalign(alignment, size);
+  }
+  int posix_memalign(void** p, size_t alignment, size_t size)
+  {
+    if(counting) allocations++;
+    *p = __libc_memalign(alignment, size);
+    return NULL==*p ? ENOMEM : 0;
+  }
+}
+
+// synthetic price history, newest first, in the Yahoo format
+static void writeSeries(const boost::filesystem::path& path,
+                        const string& symbol, int rows, int seed)
+{
+  boost::filesystem::path dir = path / symbol;
+  boost::filesystem::create_directories(dir);
+  std::ofstream ofs((dir / (symbol + ".csv")).string().c_str());
+  ofs << "Date,Open,High,Low,Close,Volume,Adj Close" << endl;
+  double price = 50+seed;
+  for(int rIdx=0; rIdx<rows; rIdx++)
+  {
+    int day = 28-(rIdx%28);
+    int month = 12-((rIdx/28)%12);
+    int year = 2013-rIdx/(28*12);
+    price *= 1+0.01*sin(0.37*rIdx*(seed+1)+seed)+0.0005*seed;
+    char line[128];
+    snprintf(line, sizeof(line),
+             "%04d-%02d-%02d,%.2f,%.2f,%.2f,%.2f,%d,%.2f",
+             year, month, day, price, price*1.01, price*0.99, price,
+             1000+rIdx, price);
+    ofs << line << endl;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(allocation)
+
+BOOST_AUTO_TEST_CASE(optimize) {
+  Series::setSidecarEnabled(false);
+  stringstream ss;
+  ss << "testAllocation." << getpid();
+  boost::filesystem::path path =
+    boost::filesystem::temp_directory_path() / ss.str();
+  const char* symbols[] = { "AAA", "BBB", "CCC", "DDD", "EEE", "FFF" };
+  int nsymbols = sizeof(symbols)/sizeof(symbols[0]);
+  for(int sIdx=0; sIdx<nsymbols; sIdx++)
+  {
+    writeSeries(path, symbols[sIdx], 400, sIdx);
+  }
+  {
+    Portfolio portfolio(path.string());
+    for(int sIdx=0; sIdx<nsymbols; sIdx++)
+    {
+      portfolio.addSeries(symbols[sIdx]);
+    }
+    portfolio.optimize(20);   // sizes the workspace
+    allocations = 0;
+    counting = true;
+    for(int tIdx=0; tIdx<10; tIdx++)
+    {
+      portfolio.optimize(10+tIdx);
+    }
+    counting = false;
+    BOOST_CHECK_EQUAL(allocations, 0);
+    BOOST_CHECK(portfolio.getPortfolioVolatility()>0);
+  }
+  boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
@@ -0,0 +1,116 @@
+// testBacktest.cxx
+// Mac Radigan
+//
+// Description:  Checks the walk-forward backtest:  the weights of every
+//               rebalance (from the moment index) match a portfolio
+//               estimated directly over the window before it, the
+//               realized returns are those of the held weights, and the
+//               realized statistics are those of the realized returns
+//               (unconstrained and with position limits).
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testBacktest
+#include <boost/test/unit_test.hpp>
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <vector>
+#include <string>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+
+static const int WINDOW = 120;
+static const int REBALANCE = 20;
+
+struct Database : SyntheticDatabase
+{
+  Database() : SyntheticDatabase("testBacktest", 5, 500) {}
+};
+
+static void check(const string& root, const vector<string>& symbols, bool bounded)
+{
+  double target = 12;
+  Portfolio portfolio(root);
+  Portfolio direct(root);
+  Portfolio daily(root);
+  for(size_t idx=0; idx<symbols.size(); idx++)
+  {
+    portfolio.addSeries(symbols[idx]);
+    direct.addSeries(symbols[idx]);
+    daily.addSeries(symbols[idx]);
+  }
+  if(bounded)
+  {
+    // position limits, binding at some rebalances
+    portfolio.setBounds(-0.3, 0.8);
+    direct.setBounds(-0.3, 0.8);
+  }
+  portfolio.setWindow(WINDOW);
+  Backtest result = portfolio.backtest(target, REBALANCE);
+  int nt = result.date.size();
+  int nr = result.rebalance.size();
+  BOOST_REQUIRE_EQUAL(result.rreturn.size(), (size_t)nt);
+  BOOST_REQUIRE_EQUAL(nr, (nt+REBALANCE-1)/REBALANCE);
+  BOOST_REQUIRE_EQUAL(result.weights.n_rows, (size_t)nr);
+  for(int rIdx=0; rIdx<nr; rIdx++)
+  {
+    // rebalanced on the first date of its period
+    BOOST_CHECK_EQUAL(result.rebalance[rIdx], result.date[rIdx*REBALANCE]);
+    // estimated over the window ending on the date before
+    direct.setWindow(WINDOW, result.rebalance[rIdx]-1);
+    direct.optimize(target);
+    BOOST_CHECK_SMALL(arma::abs(result.weights.row(rIdx)-direct.getWeights()).max(), 1e-8);
+  }
+  if(bounded)
+  {
+    int nbound = 0;
+    for(uword idx=0; idx<result.weights.n_elem; idx++)
+    {
+      if(result.weights[idx]<-0.3+1e-9 || result.weights[idx]>0.8-1e-9) nbound++;
+    }
+    BOOST_CHECK(nbound>0);
+  }
+  // the realized return of each date, at the held weights (the 
+  // returns of the date are the newest of a window ending on it)
+  for(int tIdx=0; tIdx<nt; tIdx++)
+  {
+    daily.setWindow(2, result.date[tIdx]);
+    daily.optimize(target);
+    mat w = result.weights.row(tIdx/REBALANCE);
+    double r = accu(w%daily.getReturnWindow().row(0));
+    BOOST_CHECK_SMALL(result.rreturn[tIdx]-r, 1e-14);
+  }
+  // annualized realized statistics
+  double mean = 0;
+  for(int tIdx=0; tIdx<nt; tIdx++) mean += result.rreturn[tIdx];
+  mean /= nt;
+  double var = 0;
+  for(int tIdx=0; tIdx<nt; tIdx++) var += pow(result.rreturn[tIdx]-mean, 2);
+  var /= nt-1;
+  int horizon = Portfolio::getTimeHorizon();
+  BOOST_CHECK_CLOSE(result.portfolio_rreturn, (pow(1+mean, horizon)-1)*100, 1e-8);
+  BOOST_CHECK_CLOSE(result.portfolio_volatility, sqrt(var*horizon)*100, 1e-8);
+}
+
+BOOST_FIXTURE_TEST_CASE(unconstrained, Database)
+{
+  check(root.string(), market.getSymbols(), false);
+}
+
+BOOST_FIXTURE_TEST_CASE(bounded, Database)
+{
+  check(root.string(), market.getSymbols(), true);
+}
+
+BOOST_FIXTURE_TEST_CASE(invalid, Database)
+{
+  Portfolio portfolio(root.string());
+  for(size_t idx=0; idx<market.getSymbols().size(); idx++) portfolio.addSeries(market.getSymbols()[idx]);
+  portfolio.setWindow(600);
+  BOOST_CHECK_THROW(portfolio.backtest(12, REBALANCE), runtime_error);
+  BOOST_CHECK_THROW(portfolio.backtest(12, 0), runtime_error);
+}
+
+// *EOF*
@@ -0,0 +1,117 @@
+// testBatch.cxx
+// Mac Radigan
+//
+// Description:  Checks batch optimization:  portfolios of overlapping
+//               stocks optimized concurrently on a thread pool, from a
+//               shared series cache, load each stock once and match the
+//               same portfolios optimized one at a time (collected in
+//               input order).
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testBatch
+#include <boost/test/unit_test.hpp>
+#include "Portfolio.hxx"
+#include "SeriesCache.hxx"
+#include "ThreadPool.hxx"
+#include "Instrumentation.hxx"
+#include "SyntheticDatabase.hxx"
+#include <future>
+#include <memory>
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+static const int NSYMBOLS = 8;
+static const int NPORTFOLIOS = 24;
+
+struct Database : SyntheticDatabase
+{
+  Database() : SyntheticDatabase("testBatch", NSYMBOLS, 400) {}
+  // the stocks of portfolio idx (every stock is in several portfolios)
+  vector<string> getPortfolio(int idx) const
+  {
+    const vector<string>& symbols = market.getSymbols();
+    vector<string> stocks;
+    for(int sIdx=0; sIdx<3+idx%3; sIdx++) stocks.push_back(symbols[(idx+2*sIdx)%NSYMBOLS]);
+    return stocks;
+  }
+};
+
+// optimized weights and volatility of a portfolio
+struct Result
+{
+  mat weights;
+  double volatility;
+};
+
+static Result optimize(Portfolio& portfolio, const vector<string>& stocks)
+{
+  for(size_t sIdx=0; sIdx<stocks.size(); sIdx++) portfolio.addSeries(stocks[sIdx]);
+  portfolio.optimize(15);
+  Result result;
+  result.weights = portfolio.getWeights();
+  result.volatility = portfolio.getPortfolioVolatility();
+  return result;
+}
+
+BOOST_FIXTURE_TEST_CASE(shared, Database)
+{
+  // one at a time, each portfolio loading its own series
+  vector<Result> expected;
+  for(int pIdx=0; pIdx<NPORTFOLIOS; pIdx++)
+  {
+    Portfolio portfolio(root.string());
+    expected.push_back(optimize(portfolio, getPortfolio(pIdx)));
+  }
+  // concurrently, from a shared cache
+  Metric* loads = Instrumentation::get("series.load", Metric::TIMER);
+  loads->reset();
+  SeriesCache cache;
+  vector< shared_ptr< packaged_task<Result()> > > jobs;
+  vector< future<Result> > results;
+  for(int pIdx=0; pIdx<NPORTFOLIOS; pIdx++)
+  {
+    vector<string> stocks = getPortfolio(pIdx);
+    string path = root.string();
+    shared_ptr< packaged_task<Result()> > job(
+      new packaged_task<Result()>([path,stocks,&cache]() {
+        Portfolio portfolio(path, cache);
+        return optimize(portfolio, stocks);
+      }));
+    results.push_back(job->get_future());
+    jobs.push_back(job);
+  }
+  {
+    ThreadPool pool(4);
+    for(size_t idx=0; idx<jobs.size(); idx++)
+    {
+      shared_ptr< packaged_task<Result()> > job = jobs[idx];
+      pool.submit([job]() { (*job)(); });
+    }
+  }
+  // each stock is loaded once, and shared
+  BOOST_CHECK_EQUAL(cache.size(), (size_t)NSYMBOLS);
+#ifdef QUANT_INSTRUMENT
+  BOOST_CHECK_EQUAL(loads->getCount(), (uint64_t)NSYMBOLS);
+#endif
+  const vector<string>& symbols = market.getSymbols();
+  for(int sIdx=0; sIdx<NSYMBOLS; sIdx++)
+  {
+    string filename = (root / symbols[sIdx] / (symbols[sIdx]+".csv")).string();
+    BOOST_CHECK(cache.get(symbols[sIdx], filename)==cache.get(symbols[sIdx], filename));
+  }
+  BOOST_CHECK_EQUAL(cache.size(), (size_t)NSYMBOLS);
+  // the results, in input order
+  for(int pIdx=0; pIdx<NPORTFOLIOS; pIdx++)
+  {
+    Result result = results[pIdx].get();
+    BOOST_REQUIRE_EQUAL(result.weights.n_cols, expected[pIdx].weights.n_cols);
+    BOOST_CHECK_SMALL(arma::abs(result.weights-expected[pIdx].weights).max(), 1e-12);
+    BOOST_CHECK_CLOSE(result.volatility, expected[pIdx].volatility, 1e-10);
+  }
+}
+
+// *EOF*
@@ -0,0 +1,128 @@
+// testCholesky.cxx
+// Mac Radigan
+//
+// Description:  Checks the structured KKT solve:  the Cholesky factor
+//               of a covariance and its solves match a dense solve, the
+//               frontier basis from the 2 x 2 Schur complement matches
+//               a dense solve of the bordered system, and a singular
+//               covariance is factored with a ridge.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testCholesky
+#include <boost/test/unit_test.hpp>
+#include "Cholesky.hxx"
+#include "Portfolio.hxx"
+#include <random>
+
+USING_QUANT
+using namespace std;
+
+// (n x n) covariance of correlated daily returns, and their means
+static void moments(int n, mat& s, mat& mu)
+{
+  mt19937 engine(n);
+  normal_distribution<double> normal(0, 1);
+  mat x(250, n);
+  for(int t=0; t<250; t++)
+  {
+    double market = 0.01*normal(engine);
+    for(int c=0; c<n; c++) x(t,c) = 0.0002*(c+1) + (0.5+0.1*c)*market + 0.01*normal(engine);
+  }
+  mu = mean(x);
+  s = cov(x);
+}
+
+// largest element of |a-b|, relative to the largest of |b|
+static double error(const mat& a, const mat& b)
+{
+  return arma::abs(a-b).max()/arma::abs(b).max();
+}
+
+BOOST_AUTO_TEST_CASE(factor)
+{
+  const int np = 40;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  Cholesky cholesky(s);
+  BOOST_CHECK(!cholesky.isRegularized());
+  const mat& r = cholesky.getFactor();
+  for(int c=0; c<np; c++) for(int i=c+1; i<np; i++) BOOST_CHECK_EQUAL(r(i,c), 0.0);
+  BOOST_CHECK_SMALL(error(r.t()*r, s), 1e-12);
+  // solves against the factor
+  mat v(np, 2);
+  for(int idx=0; idx<np; idx++) { v(idx,0) = mu(0,idx); v(idx,1) = 1; }
+  mat y = solve(s, v);
+  BOOST_CHECK_SMALL(error(cholesky.solve(v), y), 1e-9);
+  mat x;
+  cholesky.solve(v, x);
+  BOOST_CHECK_SMALL(error(x, y), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(schur)
+{
+  const int np = 40;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  mat w1;
+  mat w0;
+  Portfolio::solveBasis(Cholesky(s), mu, w1, w0);
+  // the dense bordered system, at two targets
+  //
+  //     | 2S  mu 1v | * | w       | = | 0v     |
+  //     | mu' 0  0  |   | lambda1 |   | mu_opt |
+  //     | 1'  0  0  |   | lambda2 |   | 1      |
+  //
+  mat a(np+2, np+2);
+  a.fill(0);
+  for(int r=0; r<np; r++)
+  {
+    for(int c=0; c<np; c++) a(r,c) = 2*s(r,c);
+    a(r,np) = a(np,r) = mu(0,r);
+    a(r,np+1) = a(np+1,r) = 1;
+  }
+  mat b(np+2, 2);
+  b.fill(0);
+  b(np,0) = 0.0004;
+  b(np+1,0) = 1;
+  b(np,1) = -0.0002;
+  b(np+1,1) = 1;
+  mat z = solve(a, b);
+  for(int k=0; k<2; k++)
+  {
+    mat w = b(np,k)*w1 + w0;
+    BOOST_CHECK_SMALL(error(w, z.submat(0,k,np-1,k).t()), 1e-8);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(singular)
+{
+  // a duplicated stock
+  const int np = 12;
+  mat s;
+  mat mu;
+  moments(np, s, mu);
+  s.col(np-1) = s.col(np-2);
+  s.row(np-1) = s.row(np-2);
+  s(np-1,np-1) = s(np-2,np-2);
+  mu(0,np-1) = mu(0,np-2);
+  Cholesky cholesky(s);
+  BOOST_CHECK(cholesky.isRegularized());
+  const mat& r = cholesky.getFactor();
+  mat regularized = s;
+  for(int idx=0; idx<np; idx++) regularized(idx,idx) += cholesky.getRidge();
+  BOOST_CHECK_SMALL(error(r.t()*r, regularized), 1e-12);
+  // the regularized basis is still fully invested, and on target
+  mat w1;
+  mat w0;
+  Portfolio::solveBasis(cholesky, mu, w1, w0);
+  BOOST_CHECK_SMALL(accu(w0)-1, 1e-8);
+  BOOST_CHECK_SMALL(accu(w1), 1e-6);
+  BOOST_CHECK_CLOSE(accu(mu%w1), 1.0, 1e-6);
+  // the duplicates share their weight
+  BOOST_CHECK_CLOSE(w0(0,np-1), w0(0,np-2), 0.01);
+}
+
+// *EOF*
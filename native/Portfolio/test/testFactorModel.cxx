@@ -0,0 +1,117 @@
+// testFactorModel.cxx
+// Mac Radigan
+//
+// Description:  Checks the factor-model covariance:  products and
+//               solves through the low-rank-plus-diagonal structure
+//               (Woodbury identity) match those of the dense covariance,
+//               a model of every factor reproduces the sample
+//               covariance, and a portfolio in factor mode matches the
+//               dense solve of its model (and the sample covariance
+//               path when every factor is kept).
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testFactorModel
+#include <boost/test/unit_test.hpp>
+#include "FactorModel.hxx"
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <random>
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+// (M x N) daily returns driven by nk common factors
+static mat returns(int ns, int np, int nk)
+{
+  mt19937 engine(np);
+  normal_distribution<double> normal(0, 1);
+  mat b(np, nk);
+  for(int c=0; c<np; c++) for(int k=0; k<nk; k++) b(c,k) = 0.005*normal(engine);
+  mat x(ns, np);
+  for(int t=0; t<ns; t++)
+  {
+    mat f(nk, 1);
+    for(int k=0; k<nk; k++) f(k,0) = normal(engine);
+    mat common = b*f;
+    for(int c=0; c<np; c++) x(t,c) = 0.0003 + common(c,0) + 0.01*normal(engine);
+  }
+  return x;
+}
+
+// largest element of |a-b|, relative to the largest of |b|
+static double error(const mat& a, const mat& b)
+{
+  return arma::abs(a-b).max()/arma::abs(b).max();
+}
+
+BOOST_AUTO_TEST_CASE(woodbury)
+{
+  const int np = 40;
+  mat x = returns(250, np, 3);
+  FactorModel model;
+  model.estimate(x, 3);
+  BOOST_REQUIRE_EQUAL(model.getFactors(), 3);
+  mat s = model.getCovariance();
+  mat v(np, 2);
+  for(int r=0; r<np; r++) { v(r,0) = 0.001*(r+1); v(r,1) = 1; }
+  BOOST_CHECK_SMALL(error(model.multiply(v), s*v), 1e-12);
+  BOOST_CHECK_SMALL(error(model.solve(v), solve(s, v)), 1e-9);
+  BOOST_CHECK_SMALL(error(s*model.solve(v), v), 1e-9);
+  mat variance = model.getVariance();
+  for(int r=0; r<np; r++) BOOST_CHECK_CLOSE(variance(0,r), s(r,r), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(complete)
+{
+  // every factor:  the model is the sample covariance (but for the
+  // floor on specific variance)
+  const int np = 6;
+  mat x = returns(250, np, 2);
+  FactorModel model;
+  model.estimate(x, np);
+  BOOST_CHECK_SMALL(error(model.getCovariance(), cov(x)), 1e-5);
+}
+
+struct Database : SyntheticDatabase
+{
+  Database() : SyntheticDatabase("testFactorModel", 6, 400) {}
+};
+
+BOOST_FIXTURE_TEST_CASE(portfolio, Database)
+{
+  const vector<string>& symbols = market.getSymbols();
+  int np = symbols.size();
+  Portfolio factor(root.string());
+  Portfolio sample(root.string());
+  for(int idx=0; idx<np; idx++)
+  {
+    factor.addSeries(symbols[idx]);
+    sample.addSeries(symbols[idx]);
+  }
+  // the dense solve of the model of the same window
+  factor.setFactorModel(3);
+  factor.optimize(15);
+  const mat& x = factor.getReturnWindow();
+  FactorModel model;
+  model.estimate(x, 3);
+  mat s = model.getCovariance();
+  mat w1;
+  mat w0;
+  Portfolio::solveBasis(s, mean(x), w1, w0);
+  mat w = (15.0/(Portfolio::getTimeHorizon()*100))*w1 + w0;
+  BOOST_CHECK_SMALL(error(factor.getWeights(), w), 1e-8);
+  double sig = sqrt(as_scalar(w*s*w.t()));
+  BOOST_CHECK_CLOSE(factor.getPortfolioVolatility(),
+                    sig*sqrt(static_cast<double>(Portfolio::getTimeHorizon()))*100, 1e-8);
+  // every factor:  the sample covariance path
+  factor.setFactorModel(np);
+  factor.optimize(15);
+  sample.optimize(15);
+  BOOST_CHECK_SMALL(error(factor.getWeights(), sample.getWeights()), 1e-4);
+  BOOST_CHECK_CLOSE(factor.getPortfolioVolatility(), sample.getPortfolioVolatility(), 1e-3);
+}
+
+// *EOF*
@@ -0,0 +1,112 @@
+// testFrontier.cxx
+// Mac Radigan
+//
+// Description:  Checks the efficient-frontier sweep:  every point of
+//               the frontier (from the two basis solutions of a single
+//               factorization) matches a separate optimization at its
+//               target return, and a dense solve of the bordered KKT
+//               system, for small and larger portfolios.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testFrontier
+#include <boost/test/unit_test.hpp>
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+struct Database : SyntheticDatabase
+{
+  Database(int nsymbols) : SyntheticDatabase("testFrontier", nsymbols, 400) {}
+};
+
+// minimum-variance weights (1 x N) at a daily target return, from a
+// dense solve of the bordered system
+//
+//     | 2S  mu 1v | * | w       | = | 0v     |
+//     | mu' 0  0  |   | lambda1 |   | mu_opt |
+//     | 1'  0  0  |   | lambda2 |   | 1      |
+//
+static mat kkt(const mat& x, double mu_opt)
+{
+  int np = x.n_cols;
+  mat s = cov(x);
+  mat mu = mean(x);
+  mat a(np+2, np+2);
+  mat b(np+2, 1);
+  a.fill(0);
+  b.fill(0);
+  for(int r=0; r<np; r++)
+  {
+    for(int c=0; c<np; c++) a(r,c) = 2*s(r,c);
+    a(r,np) = a(np,r) = mu(0,r);
+    a(r,np+1) = a(np+1,r) = 1;
+  }
+  b(np,0) = mu_opt;
+  b(np+1,0) = 1;
+  mat z = solve(a, b);
+  return z.rows(0,np-1).t();
+}
+
+static vector<double> targets()
+{
+  vector<double> t;
+  for(int idx=-4; idx<=12; idx++) t.push_back(5.0*idx);
+  return t;
+}
+
+static void check(int nsymbols)
+{
+  Database database(nsymbols);
+  const vector<string>& symbols = database.market.getSymbols();
+  Portfolio portfolio(database.root.string());
+  for(int idx=0; idx<nsymbols; idx++) portfolio.addSeries(symbols[idx]);
+  vector<double> t = targets();
+  Frontier f = portfolio.frontier(t);
+  BOOST_REQUIRE_EQUAL(f.rreturn.size(), t.size());
+  BOOST_REQUIRE_EQUAL(f.volatility.size(), t.size());
+  BOOST_REQUIRE_EQUAL(f.weights.n_rows, t.size());
+  BOOST_REQUIRE_EQUAL(f.weights.n_cols, (size_t)nsymbols);
+  for(size_t tIdx=0; tIdx<t.size(); tIdx++)
+  {
+    // a separate optimization at the target
+    portfolio.optimize(t[tIdx]);
+    const mat& w = portfolio.getWeights();
+    BOOST_CHECK_EQUAL(f.rreturn[tIdx], t[tIdx]);
+    BOOST_CHECK_CLOSE(f.volatility[tIdx], portfolio.getPortfolioVolatility(), 1e-8);
+    BOOST_CHECK_SMALL(arma::abs(f.weights.row(tIdx)-w).max(), 1e-10);
+    // the dense solve
+    double mu_opt = t[tIdx]/(Portfolio::getTimeHorizon()*100);
+    mat v = kkt(portfolio.getReturnWindow(), mu_opt);
+    BOOST_CHECK_SMALL(arma::abs(f.weights.row(tIdx)-v).max(), 1e-8);
+    // fully invested, and on target
+    BOOST_CHECK_SMALL(accu(f.weights.row(tIdx))-1, 1e-10);
+    BOOST_CHECK_SMALL(accu(f.weights.row(tIdx)%mean(portfolio.getReturnWindow()))-mu_opt, 1e-12);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(small)
+{
+  // the fixed-size basis
+  check(4);
+}
+
+BOOST_AUTO_TEST_CASE(large)
+{
+  // the Cholesky factor and 2 x 2 Schur complement
+  check(24);
+}
+
+BOOST_AUTO_TEST_CASE(degenerate)
+{
+  Database database(1);
+  Portfolio portfolio(database.root.string());
+  portfolio.addSeries(database.market.getSymbols()[0]);
+  BOOST_CHECK_THROW(portfolio.frontier(targets()), runtime_error);
+}
+
+// *EOF*
@@ -0,0 +1,94 @@
+// testInstrumentation.cxx
+// Mac Radigan
+//
+// Description:  Checks that timers and counters accumulate (from
+//               concurrent threads), and the JSON summary of a run.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testInstrumentation
+#include <boost/test/unit_test.hpp>
+#include "Instrumentation.hxx"
+#include <string>
+#include <vector>
+#include <thread>
+
+USING_QUANT
+using namespace std;
+
+BOOST_AUTO_TEST_CASE(counters)
+{
+  Metric* metric = Instrumentation::get("test.counter", Metric::COUNTER);
+  BOOST_CHECK(metric==Instrumentation::get("test.counter", Metric::COUNTER));
+  metric->reset();
+  vector<thread> threads;
+  for(int tIdx=0; tIdx<4; tIdx++)
+  {
+    threads.push_back(thread([metric,tIdx]() {
+      for(int idx=0; idx<1000; idx++) metric->add(tIdx+1);
+    }));
+  }
+  for(size_t tIdx=0; tIdx<threads.size(); tIdx++) threads[tIdx].join();
+  BOOST_CHECK_EQUAL(metric->getCount(), 4000u);
+  BOOST_CHECK_EQUAL(metric->getTotal(), 10000u);
+  BOOST_CHECK_EQUAL(metric->getMax(), 4u);
+  Instrumentation::reset();
+  BOOST_CHECK_EQUAL(metric->getCount(), 0u);
+  BOOST_CHECK_EQUAL(metric->getMax(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(timers)
+{
+  Metric* metric = Instrumentation::get("test.timer", Metric::TIMER);
+  metric->reset();
+  for(int idx=0; idx<3; idx++)
+  {
+    ScopedTimer timer(metric);
+    this_thread::sleep_for(chrono::milliseconds(2));
+  }
+  BOOST_CHECK_EQUAL(metric->getCount(), 3u);
+  BOOST_CHECK(metric->getTotal()>=6000000u);
+  BOOST_CHECK(metric->getMax()>=2000000u);
+  BOOST_CHECK(metric->getMax()<=metric->getTotal());
+}
+
+BOOST_AUTO_TEST_CASE(macros)
+{
+  Instrumentation::reset();
+  for(int idx=0; idx<5; idx++)
+  {
+    QUANT_TIMER("test.macro.timer");
+    QUANT_COUNT("test.macro.rows", 10);
+  }
+  QUANT_DURATION("test.macro.duration", chrono::milliseconds(3));
+  Metric* timer = Instrumentation::get("test.macro.timer", Metric::TIMER);
+  Metric* rows = Instrumentation::get("test.macro.rows", Metric::COUNTER);
+  Metric* duration = Instrumentation::get("test.macro.duration", Metric::TIMER);
+  if(Instrumentation::isEnabled())
+  {
+    BOOST_CHECK_EQUAL(timer->getCount(), 5u);
+    BOOST_CHECK_EQUAL(rows->getTotal(), 50u);
+    BOOST_CHECK_EQUAL(duration->getTotal(), 3000000u);
+  } else {
+    // compiled out:  nothing is recorded
+    BOOST_CHECK_EQUAL(timer->getCount(), 0u);
+    BOOST_CHECK_EQUAL(rows->getCount(), 0u);
+    BOOST_CHECK_EQUAL(duration->getCount(), 0u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(json)
+{
+  Instrumentation::reset();
+  Instrumentation::get("test.json.timer", Metric::TIMER)->add(1500000000);
+  Instrumentation::get("test.json.counter", Metric::COUNTER)->add(42);
+  string json = Instrumentation::toJson();
+  BOOST_CHECK(string::npos!=json.find("\"timers\""));
+  BOOST_CHECK(string::npos!=json.find("\"counters\""));
+  BOOST_CHECK(string::npos!=json.find("\"test.json.timer\": {\"count\": 1, \"total_s\": 1.5, \"max_s\": 1.5}"));
+  BOOST_CHECK(string::npos!=json.find("\"test.json.counter\": {\"count\": 1, \"total\": 42, \"max\": 42}"));
+  // metrics without events are omitted
+  BOOST_CHECK(string::npos==json.find("test.macro"));
+}
+
+// *EOF*
@@ -0,0 +1,162 @@
+// testKernels.cxx
+// Mac Radigan
+//
+// Description:  Checks the vector kernels of the time series math
+//               (time series math and portfolio statistics) against
+//               the scalar implementation and against a direct
+//               evaluation of each definition.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testKernels
+#include <boost/test/unit_test.hpp>
+#include "Kernels.hxx"
+#include <vector>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+
+// synthetic closing prices, newest first
+static vector<double> prices(size_t n)
+{
+  vector<double> c(n);
+  double price = 100;
+  for(size_t idx=n; idx-->0; )
+  {
+    price *= 1+0.02*sin(0.7*idx)+0.001;
+    c[idx] = price;
+  }
+  return c;
+}
+
+BOOST_AUTO_TEST_SUITE(kernels)
+
+BOOST_AUTO_TEST_CASE(returns) {
+  // odd lengths exercise the scalar tails
+  const size_t lengths[] = { 0, 1, 2, 5, 8, 1001 };
+  for(size_t lIdx=0; lIdx<sizeof(lengths)/sizeof(lengths[0]); lIdx++)
+  {
+    size_t n = lengths[lIdx];
+    vector<double> c = prices(n);
+    vector<double> rv(n+1), rs(n+1), lv(n+1), ls(n+1);
+    bool vectorized = Kernels::setVectorized(true);
+    Kernels::simpleReturns(c.empty() ? NULL : &c[0], n, &rv[0]);
+    Kernels::logReturns(c.empty() ? NULL : &c[0], n, &lv[0]);
+    Kernels::setVectorized(false);
+    BOOST_CHECK_EQUAL(string(Kernels::getIsa()), "scalar");
+    Kernels::simpleReturns(c.empty() ? NULL : &c[0], n, &rs[0]);
+    Kernels::logReturns(c.empty() ? NULL : &c[0], n, &ls[0]);
+    Kernels::setVectorized(vectorized);
+    for(size_t idx=0; idx+1<n; idx++)
+    {
+      BOOST_CHECK_EQUAL(rv[idx], rs[idx]);
+      BOOST_CHECK_EQUAL(rs[idx], (c[idx]-c[idx+1])/c[idx+1]);
+      BOOST_CHECK_CLOSE(lv[idx], log(c[idx]/c[idx+1]), 1e-9);
+      BOOST_CHECK_EQUAL(lv[idx], ls[idx]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rolling) {
+  const size_t n = 1000;
+  const size_t windows[] = { 2, 3, 20, 257, n };
+  vector<double> x = prices(n);
+  for(size_t wIdx=0; wIdx<sizeof(windows)/sizeof(windows[0]); wIdx++)
+  {
+    size_t w = windows[wIdx];
+    size_t ny = n-w+1;
+    vector<double> mv(ny), vv(ny), ms(ny), vs(ny);
+    bool vectorized = Kernels::setVectorized(true);
+    Kernels::rollingMean(&x[0], n, w, &mv[0]);
+    Kernels::rollingVolatility(&x[0], n, w, &vv[0]);
+    Kernels::setVectorized(false);
+    Kernels::rollingMean(&x[0], n, w, &ms[0]);
+    Kernels::rollingVolatility(&x[0], n, w, &vs[0]);
+    Kernels::setVectorized(vectorized);
+    for(size_t idx=0; idx<ny; idx++)
+    {
+      double mean = 0;
+      for(size_t k=idx; k<idx+w; k++) mean += x[k];
+      mean /= w;
+      double var = 0;
+      for(size_t k=idx; k<idx+w; k++) var += (x[k]-mean)*(x[k]-mean);
+      double std = sqrt(var/(w-1));
+      BOOST_CHECK_CLOSE(mv[idx], mean, 1e-8);
+      BOOST_CHECK_CLOSE(ms[idx], mean, 1e-8);
+      BOOST_CHECK_CLOSE(vv[idx], std, 1e-4);
+      BOOST_CHECK_CLOSE(vs[idx], std, 1e-4);
+      BOOST_CHECK_EQUAL(vv[idx], vs[idx]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(moments) {
+  // sizes not a multiple of the vector width or the row block
+  const size_t ns = 301;
+  const size_t nps[] = { 1, 3, 4, 9 };
+  for(size_t pIdx=0; pIdx<sizeof(nps)/sizeof(nps[0]); pIdx++)
+  {
+    size_t np = nps[pIdx];
+    vector<double> x(ns*np);
+    for(size_t j=0; j<np; j++)
+    {
+      for(size_t t=0; t<ns; t++)
+      {
+        x[t+j*ns] = 0.01*sin(0.3*t*(j+1)+j)+0.0005*(j+1)+0.002*sin(1.7*t);
+      }
+    }
+    for(int vectorized=0; vectorized<2; vectorized++)
+    {
+      bool previous = Kernels::setVectorized(vectorized);
+      vector<double> mean(np), cov(np*np), vol(np);
+      Kernels::moments(&x[0], ns, np, &mean[0], &cov[0], &vol[0]);
+      Kernels::setVectorized(previous);
+      for(size_t j=0; j<np; j++)
+      {
+        double m = 0;
+        for(size_t t=0; t<ns; t++) m += x[t+j*ns];
+        m /= ns;
+        BOOST_CHECK_CLOSE(mean[j], m, 1e-9);
+      }
+      for(size_t j=0; j<np; j++)
+      {
+        for(size_t i=0; i<np; i++)
+        {
+          double c = 0;
+          for(size_t t=0; t<ns; t++) c += (x[t+i*ns]-mean[i])*(x[t+j*ns]-mean[j]);
+          c /= ns-1;
+          BOOST_CHECK_SMALL(cov[i+j*np]-c, 1e-15);
+          BOOST_CHECK_EQUAL(cov[i+j*np], cov[j+i*np]);
+        }
+        BOOST_CHECK_EQUAL(vol[j], sqrt(cov[j+j*np]));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rates) {
+  const double t = 250;
+  vector<double> daily;
+  for(int idx=-50; idx<=50; idx++) daily.push_back(idx*1e-4);
+  daily.push_back(0.5);
+  size_t n = daily.size();
+  for(int vectorized=0; vectorized<2; vectorized++)
+  {
+    bool previous = Kernels::setVectorized(vectorized);
+    vector<double> annual(n), back(n);
+    Kernels::annualizeRate(&daily[0], n, t, &annual[0]);
+    Kernels::dailyRate(&annual[0], n, t, &back[0]);
+    Kernels::setVectorized(previous);
+    for(size_t idx=0; idx<n; idx++)
+    {
+      long double a = (powl(1.0L+daily[idx], t)-1)*100;
+      BOOST_CHECK_SMALL(static_cast<double>(annual[idx]-a), 1e-10*std::max(1.0,fabs((double)a)));
+      BOOST_CHECK_SMALL(back[idx]-daily[idx], 1e-14);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
@@ -0,0 +1,181 @@
+// testLazy.cxx
+// Mac Radigan
+//
+// Description:  Checks lazy loading:  a partial load holds the newest
+//               records of a file, estimates from partial series match
+//               those of full loads (the series are loaded in full when
+//               the window needs older records), and backtests load
+//               the full history.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testLazy
+#include <boost/test/unit_test.hpp>
+#include "Portfolio.hxx"
+#include "SeriesCache.hxx"
+#include "SyntheticDatabase.hxx"
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+struct Database : SyntheticDatabase
+{
+  Database() : SyntheticDatabase("testLazy", 4, 400)
+  {
+    Series::setSidecarEnabled(false);
+  }
+  ~Database()
+  {
+    Portfolio::setLazyLoading(false);
+  }
+  string getFilename(int idx) const
+  {
+    const string& symbol = market.getSymbols()[idx];
+    return (root / symbol / (symbol+".csv")).string();
+  }
+  vector<string> readLines(int idx) const
+  {
+    vector<string> lines;
+    std::ifstream ifs(getFilename(idx).c_str());
+    string line;
+    while(getline(ifs, line)) lines.push_back(line);
+    return lines;
+  }
+  void writeLines(int idx, const vector<string>& lines) const
+  {
+    std::ofstream ofs(getFilename(idx).c_str(), ios::trunc);
+    for(size_t lIdx=0; lIdx<lines.size(); lIdx++) ofs << lines[lIdx] << "\n";
+  }
+  // optimized weights of the first four stocks
+  mat optimize(MissingData policy, bool lazy, SeriesCache& cache) const
+  {
+    Portfolio::setLazyLoading(lazy);
+    Portfolio portfolio(root.string(), cache);
+    for(int idx=0; idx<4; idx++) portfolio.addSeries(market.getSymbols()[idx]);
+    portfolio.setMissingData(policy);
+    portfolio.optimize(15);
+    return portfolio.getWeights();
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(lazy, Database)
+
+BOOST_AUTO_TEST_CASE(partial)
+{
+  Series full;
+  full.load("S", getFilename(0));
+  BOOST_CHECK(full.isComplete());
+  Series head;
+  head.load("S", getFilename(0), 251);
+  BOOST_CHECK(!head.isComplete());
+  BOOST_CHECK(head.covers(251));
+  BOOST_CHECK(head.covers(100));
+  BOOST_CHECK(!head.covers(252));
+  BOOST_CHECK(!head.covers(0));
+  BOOST_REQUIRE_EQUAL(head.getDate().size(), 251u);
+  BOOST_REQUIRE_EQUAL(head.getRreturn().size(), 250u);
+  for(size_t idx=0; idx<head.getRreturn().size(); idx++)
+  {
+    BOOST_CHECK_EQUAL(head.getDate()[idx], full.getDate()[idx]);
+    BOOST_CHECK_EQUAL(head.getRreturn()[idx], full.getRreturn()[idx]);
+  }
+  BOOST_CHECK(!head.isStale(getFilename(0)));
+  // more records than the file holds
+  Series all;
+  all.load("S", getFilename(0), 1000);
+  BOOST_CHECK(all.isComplete());
+  BOOST_CHECK_EQUAL(all.getDate().size(), full.getDate().size());
+}
+
+BOOST_AUTO_TEST_CASE(oldest)
+{
+  // an oldest first file is loaded in full
+  vector<string> lines = readLines(0);
+  std::reverse(lines.begin()+1, lines.end());
+  writeLines(0, lines);
+  Series series;
+  series.load("S", getFilename(0), 251);
+  BOOST_CHECK(series.isComplete());
+  BOOST_CHECK_EQUAL(series.getDate().size(), 400u);
+}
+
+BOOST_AUTO_TEST_CASE(update)
+{
+  Series series;
+  series.load("S", getFilename(0), 251);
+  time_t newest = series.getDate()[0];
+  // a newer record written at the head of the file
+  vector<string> lines = readLines(0);
+  lines.insert(lines.begin()+1, "2014-01-02,10.00,10.00,10.00,10.00,1000,10.00");
+  writeLines(0, lines);
+  BOOST_CHECK(series.isStale(getFilename(0)));
+  BOOST_CHECK_EQUAL(series.update(getFilename(0)), 1u);
+  BOOST_CHECK(!series.isComplete());
+  BOOST_CHECK_EQUAL(series.getDate().size(), 251u);
+  BOOST_CHECK_EQUAL(series.getDate()[1], newest);
+}
+
+BOOST_AUTO_TEST_CASE(cache)
+{
+  SeriesCache cache;
+  SeriesPtr head = cache.get("S", getFilename(0), 251);
+  BOOST_CHECK(!head->isComplete());
+  // fewer records are served by the partial series
+  BOOST_CHECK(cache.get("S", getFilename(0), 100)==head);
+  // more records replace it
+  SeriesPtr full = cache.get("S", getFilename(0));
+  BOOST_CHECK(full->isComplete());
+  BOOST_CHECK_EQUAL(full->getDate().size(), 400u);
+  BOOST_CHECK(cache.get("S", getFilename(0), 251)==full);
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(estimate)
+{
+  // a common calendar:  the window is in the partial series
+  SeriesCache lazy;
+  SeriesCache full;
+  mat w = optimize(MISSING_DROP, true, lazy);
+  BOOST_CHECK(!lazy.get(market.getSymbols()[0], getFilename(0), 251)->isComplete());
+  mat v = optimize(MISSING_DROP, false, full);
+  BOOST_CHECK_SMALL(arma::abs(w-v).max(), 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(calendar)
+{
+  // a stock not quoted on a date of the window:  the window extends
+  // past the partial series, which are loaded in full
+  vector<string> lines = readLines(1);
+  lines.erase(lines.begin()+20);
+  writeLines(1, lines);
+  MissingData policies[] = { MISSING_DROP, MISSING_FFILL, MISSING_PAIRWISE };
+  BOOST_FOREACH(MissingData policy, policies)
+  {
+    SeriesCache lazy;
+    SeriesCache full;
+    mat w = optimize(policy, true, lazy);
+    mat v = optimize(policy, false, full);
+    BOOST_CHECK_SMALL(arma::abs(w-v).max(), 1e-12);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(backtest)
+{
+  SeriesCache cache;
+  Portfolio::setLazyLoading(true);
+  Portfolio portfolio(root.string(), cache);
+  for(int idx=0; idx<4; idx++) portfolio.addSeries(market.getSymbols()[idx]);
+  Backtest result = portfolio.backtest(15, 50);
+  // the history beyond the window is loaded
+  BOOST_CHECK_EQUAL(result.rreturn.size(), 399u-250u);
+  BOOST_CHECK(cache.get(market.getSymbols()[0], getFilename(0), 251)->isComplete());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
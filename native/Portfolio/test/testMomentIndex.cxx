@@ -0,0 +1,169 @@
+// testMomentIndex.cxx
+// Mac Radigan
+//
+// Description:  Checks the moment index:  the mean and covariance of
+//               any window match a direct sweep of its rows (for plain
+//               prefix sums and blocked checkpoints), stay accurate over
+//               long histories of returns far from zero, and back the
+//               configurable estimate window of a portfolio.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testMomentIndex
+#include <boost/test/unit_test.hpp>
+#include "MomentIndex.hxx"
+#include "Kernels.hxx"
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <vector>
+#include <string>
+#include <cmath>
+#include <stdint.h>
+
+USING_QUANT
+using namespace std;
+
+// (N x T) returns, one column per date, from a fixed sequence
+static void history(int np, int ns, double offset, mat& x, vector<time_t>& dates)
+{
+  uint64_t state = 1;
+  x.set_size(np, ns);
+  dates.resize(ns);
+  for(int t=0; t<ns; t++)
+  {
+    dates[t] = 1356998400+86400*static_cast<time_t>(t);
+    for(int i=0; i<np; i++)
+    {
+      state = state*6364136223846793005ULL+1442695040888963407ULL;
+      double u = (state>>11)*(1.0/9007199254740992.0)-0.5;
+      // correlated through the first stock
+      x(i,t) = offset + 0.02*u + (i>0 ? 0.5*(x(0,t)-offset) : 0);
+    }
+  }
+}
+
+// moments of rows [start,end) by a direct sweep
+static void direct(const mat& x, int start, int end, mat& mean, mat& covariance)
+{
+  int np = x.n_rows;
+  int ns = end-start;
+  mat panel(ns, np);
+  for(int t=0; t<ns; t++) for(int i=0; i<np; i++) panel(t,i) = x(i,start+t);
+  mean.set_size(1, np);
+  covariance.set_size(np, np);
+  mat sigma(1, np);
+  Kernels::moments(panel.memptr(), ns, np, mean.memptr(), covariance.memptr(), sigma.memptr());
+}
+
+static double largest(const mat& a, const mat& b)
+{
+  return arma::abs(a-b).max();
+}
+
+BOOST_AUTO_TEST_CASE(windows)
+{
+  mat x;
+  vector<time_t> dates;
+  history(5, 300, 0, x, dates);
+  int strides[] = { 1, 7, 32, 1000 };
+  for(int sIdx=0; sIdx<4; sIdx++)
+  {
+    MomentIndex index;
+    index.build(x, dates, strides[sIdx]);
+    BOOST_CHECK_EQUAL(index.getRows(), 300);
+    BOOST_CHECK_EQUAL(index.getDimension(), 5);
+    // windows across checkpoints, inside a block, and the whole history
+    int windows[][2] = { {0,300}, {0,2}, {3,10}, {31,33}, {5,290}, {64,128}, {100,161}, {298,300} };
+    for(int wIdx=0; wIdx<8; wIdx++)
+    {
+      mat mean, covariance, m, s;
+      index.moments(windows[wIdx][0], windows[wIdx][1], mean, covariance);
+      direct(x, windows[wIdx][0], windows[wIdx][1], m, s);
+      BOOST_CHECK_SMALL(largest(mean, m), 1e-15);
+      BOOST_CHECK_SMALL(largest(covariance, s), 1e-15);
+      BOOST_CHECK_EQUAL(covariance(1,3), covariance(3,1));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(dates)
+{
+  mat x;
+  vector<time_t> d;
+  history(2, 10, 0, x, d);
+  MomentIndex index;
+  index.build(x, d);
+  BOOST_CHECK_EQUAL(index.find(d[0]-1), 0);
+  BOOST_CHECK_EQUAL(index.find(d[0]), 1);
+  BOOST_CHECK_EQUAL(index.find(d[4]+3600), 5);
+  BOOST_CHECK_EQUAL(index.find(d[9]), 10);
+  BOOST_CHECK_EQUAL(index.find(numeric_limits<time_t>::max()), 10);
+  mat mean, covariance;
+  BOOST_CHECK_THROW(index.moments(3, 4, mean, covariance), runtime_error);
+  BOOST_CHECK_THROW(index.moments(-1, 4, mean, covariance), runtime_error);
+  BOOST_CHECK_THROW(index.moments(0, 11, mean, covariance), runtime_error);
+  BOOST_CHECK_THROW(index.build(x, vector<time_t>(3)), runtime_error);
+  BOOST_CHECK_THROW(index.build(x, d, 0), runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(accuracy)
+{
+  // a long history far from zero:  the window sums do not cancel
+  mat x;
+  vector<time_t> dates;
+  history(3, 200000, 1000, x, dates);
+  MomentIndex index;
+  index.build(x, dates);
+  mat mean, covariance, m, s;
+  index.moments(199000, 199060, mean, covariance);
+  direct(x, 199000, 199060, m, s);
+  BOOST_CHECK_SMALL(largest(mean, m), 1e-9);
+  for(int i=0; i<3; i++)
+  {
+    for(int j=0; j<3; j++) BOOST_CHECK_SMALL(covariance(i,j)-s(i,j), 1e-9*s(0,0));
+  }
+}
+
+struct Database : SyntheticDatabase
+{
+  Database() : SyntheticDatabase("testMomentIndex", 3, 600) {}
+};
+
+BOOST_FIXTURE_TEST_CASE(window, Database)
+{
+  const vector<string>& symbols = market.getSymbols();
+  Portfolio portfolio(root.string());
+  for(size_t idx=0; idx<symbols.size(); idx++) portfolio.addSeries(symbols[idx]);
+  BOOST_CHECK_EQUAL(portfolio.getWindowLength(), Portfolio::getDefaultWindowLength());
+  BOOST_CHECK_THROW(portfolio.setWindow(1), runtime_error);
+  portfolio.optimize(15);
+  mat all;
+  mat covariance;
+  BOOST_CHECK_EQUAL(portfolio.moments(10000, numeric_limits<time_t>::max(), all, covariance), 599);
+  mat mean;
+  BOOST_CHECK_EQUAL(portfolio.moments(250, numeric_limits<time_t>::max(), mean, covariance), 250);
+  // the default window is the newest 250 days
+  const mat& window = portfolio.getReturnWindow();
+  BOOST_REQUIRE_EQUAL(window.n_rows, 250u);
+  mat m(1, 3), s(3, 3), sigma(1, 3);
+  Kernels::moments(window.memptr(), window.n_rows, 3, m.memptr(), s.memptr(), sigma.memptr());
+  BOOST_CHECK_SMALL(largest(mean, m), 1e-15);
+  BOOST_CHECK_SMALL(largest(covariance, s), 1e-15);
+  // a shorter window, ending 20 weeks before the newest date
+  time_t end = 1388448000-140*86400;
+  portfolio.setWindow(120, end);
+  portfolio.optimize(15);
+  BOOST_CHECK_EQUAL(portfolio.getWindowLength(), 120);
+  BOOST_CHECK_EQUAL(portfolio.getWindowEnd(), end);
+  const mat& shorter = portfolio.getReturnWindow();
+  BOOST_REQUIRE_EQUAL(shorter.n_rows, 120u);
+  BOOST_CHECK_EQUAL(portfolio.moments(120, end, mean, covariance), 120);
+  Kernels::moments(shorter.memptr(), shorter.n_rows, 3, m.memptr(), s.memptr(), sigma.memptr());
+  BOOST_CHECK_SMALL(largest(mean, m), 1e-15);
+  BOOST_CHECK_SMALL(largest(covariance, s), 1e-15);
+  // the backtest walks the history with the window length
+  Backtest bt = portfolio.backtest(15, 20);
+  BOOST_CHECK_EQUAL(bt.rreturn.size(), 599u-120u);
+}
+
+// *EOF*
@@ -0,0 +1,112 @@
+// testPanelStore.cxx
+// Mac Radigan
+//
+// Description:  Checks the HDF5 panel store:  the quotes of a stock
+//               read from an imported store are those of its CSV file
+//               (over a date range, and for a stock with a shorter
+//               history), and a portfolio optimized from the store
+//               matches one optimized from the CSV files.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testPanelStore
+#include <boost/test/unit_test.hpp>
+#include "PanelStore.hxx"
+#include "Portfolio.hxx"
+#include "SeriesCache.hxx"
+#include "SyntheticDatabase.hxx"
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+// a CSV quote database of five stocks (one with a shorter history),
+// and its panel store
+struct Database : SyntheticDatabase
+{
+  string csv;
+  string store;
+  vector<string> symbols;
+  Database()
+    : SyntheticDatabase("testPanelStore", 4, 300, "db"),
+      csv(database.string()), store((root / "market.h5").string())
+  {
+    SyntheticMarket recent(vector<string>(1, "NEW"), 120, 2);
+    recent.write(csv);
+    symbols = market.getSymbols();
+    symbols.push_back("NEW");
+    PanelStore::import(csv, vector<string>(), store);
+  }
+};
+
+static void checkEqual(const Series& a, const Series& b)
+{
+  BOOST_REQUIRE_EQUAL(a.getDate().size(), b.getDate().size());
+  for(size_t r=0; r<a.getDate().size(); r++)
+  {
+    BOOST_CHECK_EQUAL(a.getDate()[r], b.getDate()[r]);
+    BOOST_CHECK_EQUAL(a.getOpen()[r], b.getOpen()[r]);
+    BOOST_CHECK_EQUAL(a.getHigh()[r], b.getHigh()[r]);
+    BOOST_CHECK_EQUAL(a.getLow()[r], b.getLow()[r]);
+    BOOST_CHECK_EQUAL(a.getClose()[r], b.getClose()[r]);
+    BOOST_CHECK_EQUAL(a.getVolume()[r], b.getVolume()[r]);
+    BOOST_CHECK_EQUAL(a.getAdjClose()[r], b.getAdjClose()[r]);
+  }
+  BOOST_CHECK(a.getRreturn()==b.getRreturn());
+}
+
+BOOST_AUTO_TEST_CASE(quotes)
+{
+  Database database;
+  PanelStore store(database.store);
+  BOOST_CHECK(PanelStore::isStore(database.store));
+  BOOST_CHECK(!PanelStore::isStore(database.csv));
+  BOOST_REQUIRE_EQUAL(store.getSymbols().size(), 5u);
+  BOOST_CHECK_EQUAL(store.getDates().size(), 300u);
+  for(size_t sIdx=0; sIdx<database.symbols.size(); sIdx++)
+  {
+    const string& symbol = database.symbols[sIdx];
+    BOOST_REQUIRE(store.contains(symbol));
+    Series csv;
+    csv.load(symbol, database.csv+"/"+symbol+"/"+symbol+".csv");
+    Series panel;
+    store.read(symbol, store.getDates().front(), store.getDates().back(), panel);
+    checkEqual(csv, panel);
+  }
+  // a date range:  the quotes dated within it only
+  const vector<time_t>& dates = store.getDates();
+  Series range;
+  store.read("SYN0001", dates[100], dates[199], range);
+  BOOST_REQUIRE_EQUAL(range.getDate().size(), 100u);
+  BOOST_CHECK_EQUAL(range.getDate().front(), dates[199]);
+  BOOST_CHECK_EQUAL(range.getDate().back(), dates[100]);
+  BOOST_CHECK_THROW(store.read("NEW", dates[0], dates[100], range), runtime_error);
+  BOOST_CHECK_THROW(store.read("XYZ", dates[0], dates[299], range), runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(portfolio)
+{
+  Database database;
+  SeriesCache cache;
+  Portfolio csv(database.csv);
+  Portfolio panel(database.store, cache);
+  for(size_t sIdx=0; sIdx<database.symbols.size(); sIdx++)
+  {
+    csv.addSeries(database.symbols[sIdx]);
+    panel.addSeries(database.symbols[sIdx]);
+  }
+  csv.optimize(15);
+  panel.optimize(15);
+  BOOST_CHECK_EQUAL(csv.getPortfolioVolatility(), panel.getPortfolioVolatility());
+  BOOST_CHECK(accu(abs(csv.getWeights()-panel.getWeights()))==0);
+  BOOST_CHECK(!panel.refresh());
+  // a date range reads the stocks again
+  const vector<time_t>& dates = cache.getStore(database.store)->getDates();
+  panel.setDateRange(dates[50], dates[249]);
+  panel.optimize(15);
+  BOOST_CHECK(panel.getPortfolioVolatility()!=csv.getPortfolioVolatility());
+  BOOST_CHECK_THROW(csv.setDateRange(dates[50], dates[249]), runtime_error);
+}
+
+// *EOF*
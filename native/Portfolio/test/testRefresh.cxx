@@ -0,0 +1,220 @@
+// testRefresh.cxx
+// Mac Radigan
+//
+// Description:  Checks that records appended to a loaded series file
+//               are picked up incrementally (by the series and the
+//               shared cache), and the request server round trip.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testRefresh
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include "Series.hxx"
+#include "SeriesCache.hxx"
+#include "Server.hxx"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+USING_QUANT
+using namespace std;
+
+static const char* HEADER = "Date,Open,High,Low,Close,Volume,Adj Close";
+
+// one record of January 2013, with closing price 100+day
+static string record(int day)
+{
+  char line[128];
+  double price = 100+day;
+  snprintf(line, sizeof(line), "2013-01-%02d,%.2f,%.2f,%.2f,%.2f,1000,%.2f\n",
+           day, price, price, price, price, price);
+  return line;
+}
+
+static void write(const string& filename, const string& text, bool append)
+{
+  std::ofstream ofs(filename.c_str(), append ? ios::app : ios::trunc);
+  ofs << text;
+}
+
+static int day(time_t t)
+{
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  return tm.tm_mday;
+}
+
+struct Database
+{
+  boost::filesystem::path path;
+  string filename;
+  Database()
+  {
+    Series::setSidecarEnabled(false);
+    stringstream ss;
+    ss << "testRefresh." << getpid();
+    path = boost::filesystem::temp_directory_path() / ss.str();
+    boost::filesystem::create_directories(path);
+    filename = (path / "T.csv").string();
+    // the 10th back to the 6th, newest first
+    string text = string(HEADER)+"\n";
+    for(int d=10; d>=6; d--) text += record(d);
+    write(filename, text, false);
+  }
+  ~Database()
+  {
+    boost::filesystem::remove_all(path);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(refresh, Database)
+
+BOOST_AUTO_TEST_CASE(append) {
+  Series series;
+  series.load("T", filename);
+  BOOST_CHECK(!series.isStale(filename));
+  BOOST_CHECK_EQUAL(series.update(filename), 0u);
+  // a feed appends newer records oldest first, the last one incomplete
+  write(filename, record(11)+record(12)+"2013-01-13,1", true);
+  BOOST_CHECK(series.isStale(filename));
+  BOOST_CHECK_EQUAL(series.update(filename), 2u);
+  BOOST_REQUIRE_EQUAL(series.getDate().size(), 7u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 12);
+  BOOST_CHECK_EQUAL(day(series.getDate()[1]), 11);
+  BOOST_CHECK_EQUAL(day(series.getDate()[6]), 6);
+  BOOST_CHECK_CLOSE(series.getRreturn()[0], (112.0-111.0)/111.0, 1e-9);
+  BOOST_CHECK_CLOSE(series.getRreturn()[1], (111.0-110.0)/110.0, 1e-9);
+  // the incomplete record is completed
+  write(filename, "13.00,113.00,113.00,113.00,1000,113.00\n", true);
+  BOOST_CHECK_EQUAL(series.update(filename), 1u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 13);
+  BOOST_CHECK_EQUAL(series.getClose()[0], 113.0);
+  // older history, newest first
+  write(filename, record(5)+record(4), true);
+  BOOST_CHECK_EQUAL(series.update(filename), 2u);
+  BOOST_CHECK_EQUAL(day(series.getDate().back()), 4);
+  BOOST_CHECK_EQUAL(series.getRreturn().size(), 9u);
+  // the same as a load of the file
+  Series reloaded;
+  reloaded.load("T", filename);
+  BOOST_CHECK(series.getDate()==reloaded.getDate());
+  BOOST_CHECK(series.getRreturn()==reloaded.getRreturn());
+}
+
+BOOST_AUTO_TEST_CASE(oldest) {
+  // the 6th to the 10th, oldest first:  held newest first
+  string text = string(HEADER)+"\n";
+  for(int d=6; d<=10; d++) text += record(d);
+  write(filename, text, false);
+  Series series;
+  series.load("T", filename);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 10);
+  BOOST_CHECK_CLOSE(series.getRreturn()[0], (110.0-109.0)/109.0, 1e-9);
+  write(filename, record(11)+record(12), true);
+  BOOST_CHECK_EQUAL(series.update(filename), 2u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 12);
+  Series reloaded;
+  reloaded.load("T", filename);
+  BOOST_CHECK(series.getDate()==reloaded.getDate());
+  BOOST_CHECK(series.getRreturn()==reloaded.getRreturn());
+}
+
+BOOST_AUTO_TEST_CASE(unordered) {
+  // out of order records are sorted, a date quoted twice keeps its first
+  write(filename, string(HEADER)+"\n"+record(8)+record(10)+record(6)+record(10), false);
+  Series series;
+  series.load("T", filename);
+  BOOST_REQUIRE_EQUAL(series.getDate().size(), 3u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 10);
+  BOOST_CHECK_EQUAL(day(series.getDate()[2]), 6);
+  BOOST_CHECK_CLOSE(series.getRreturn()[0], (110.0-108.0)/108.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(replace) {
+  Series series;
+  series.load("T", filename);
+  // a rewritten file (new inode, or out of order) is reloaded
+  string replacement = (path / "T.new").string();
+  write(replacement, string(HEADER)+"\n"+record(3)+record(2)+record(1), false);
+  boost::filesystem::rename(replacement, filename);
+  BOOST_CHECK_EQUAL(series.update(filename), 3u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 3);
+  write(filename, record(2), true);
+  series.update(filename);
+  Series reloaded;
+  reloaded.load("T", filename);
+  BOOST_CHECK(series.getDate()==reloaded.getDate());
+  BOOST_CHECK_EQUAL(series.getDate().size(), 3u);
+  // rewritten in place and grown, the parsed bytes ending mid-line
+  std::ofstream ofs(filename.c_str(), ios::in | ios::out);
+  ofs << HEADER << "\n" << "2013-01-01,1.00,1.00,1.00,1.00,1000,1.00\n" 
+      << record(2) << record(3) << record(4) << record(5);
+  ofs.close();
+  series.update(filename);
+  BOOST_REQUIRE_EQUAL(series.getDate().size(), 5u);
+  BOOST_CHECK_EQUAL(day(series.getDate()[0]), 5);
+  BOOST_CHECK_EQUAL(series.getClose()[4], 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(cache) {
+  SeriesCache cache;
+  SeriesPtr before = cache.get("T", filename);
+  BOOST_CHECK(cache.refresh("T", filename)==before);
+  write(filename, record(11), true);
+  SeriesPtr after = cache.refresh("T", filename);
+  // the holders of the previous series are unaffected
+  BOOST_CHECK(after!=before);
+  BOOST_CHECK_EQUAL(before->getDate().size(), 5u);
+  BOOST_CHECK_EQUAL(after->getDate().size(), 6u);
+  BOOST_CHECK(cache.get("T", filename)==after);
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+  // a missing file is loaded again once it exists
+  string missing = (path / "M.csv").string();
+  BOOST_CHECK_THROW(cache.get("M", missing), runtime_error);
+  BOOST_CHECK_THROW(cache.refresh("M", missing), runtime_error);
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+  write(missing, string(HEADER)+"\n"+record(2)+record(1), false);
+  BOOST_CHECK_EQUAL(cache.refresh("M", missing)->getDate().size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(server) {
+  string socket = (path / "test.sock").string();
+  Server server(socket, [](const string& request) -> string {
+    if("fail"==request) throw runtime_error("failed");
+    return "reply to "+request;
+  }, 2);
+  thread listener(&Server::run, &server);
+  BOOST_CHECK_EQUAL(Server::query(socket, "ping"), "reply to ping");
+  BOOST_CHECK_EQUAL(Server::query(socket, "fail"), "error: failed\n");
+  BOOST_CHECK_THROW(Server(socket, [](const string& r) { return r; }, 1), runtime_error);
+  server.stop();
+  listener.join();
+}
+
+BOOST_AUTO_TEST_CASE(stalled) {
+  // a client that never finishes its request does not hold the worker
+  string socket = (path / "stalled.sock").string();
+  Server server(socket, [](const string& request) { return "reply to "+request; }, 1, 1);
+  thread listener(&Server::run, &server);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket.c_str(), sizeof(addr.sun_path)-1);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  BOOST_REQUIRE(fd>=0);
+  BOOST_REQUIRE_EQUAL(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  BOOST_CHECK_EQUAL(Server::query(socket, "ping"), "reply to ping");
+  close(fd);
+  server.stop();
+  listener.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
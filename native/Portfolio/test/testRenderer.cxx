@@ -0,0 +1,227 @@
+// testRenderer.cxx
+// Mac Radigan
+//
+// Description:  Checks the gnuplot sessions of the report renderer,
+//               against a stand-in gnuplot on the search path that
+//               logs its sessions:  a session that exits is replaced,
+//               outputs are tagged once gnuplot confirms them, 
+//               current outputs are skipped, and a report is built for
+//               stocks of fewer records than the window (or than the
+//               other stocks, when newly listed).
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testRenderer
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include "Renderer.hxx"
+#include "Figure.hxx"
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+USING_QUANT
+using namespace std;
+
+// a directory holding a stand-in gnuplot (first on the search path),
+// removed at the end of a test
+struct Gnuplot
+{
+  boost::filesystem::path root;
+  string log;
+  string path;
+  Gnuplot()
+    : root(boost::filesystem::temp_directory_path() /
+           ("testRenderer."+boost::lexical_cast<string>(getpid())))
+  {
+    boost::filesystem::create_directories(root);
+    log = (root / "sessions.log").string();
+    path = getenv("PATH") ? getenv("PATH") : "";
+    setenv("PATH", (root.string()+":"+path).c_str(), 1);
+  }
+  ~Gnuplot()
+  {
+    setenv("PATH", path.c_str(), 1);
+    boost::filesystem::remove_all(root);
+  }
+  // install a gnuplot running the shell commands body (a new file, 
+  // not one rewritten in place)
+  void install(const string& body) const
+  {
+    string filename = (root / "gnuplot.new").string();
+    std::ofstream ofs(filename.c_str());
+    ofs << "#!/bin/sh" << endl << body << endl;
+    ofs.close();
+    chmod(filename.c_str(), 0755);
+    boost::filesystem::rename(filename, root / "gnuplot");
+  }
+  // lines of the session log
+  vector<string> sessions() const
+  {
+    vector<string> lines;
+    std::ifstream ifs(log.c_str());
+    string line;
+    while(getline(ifs, line)) lines.push_back(line);
+    return lines;
+  }
+  // wait (at most 10 s) for the session log to hold n lines
+  bool wait(size_t n) const
+  {
+    for(int idx=0; idx<1000 && sessions().size()<n; idx++)
+    {
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return sessions().size()>=n;
+  }
+};
+
+// a gnuplot that writes its outputs, and confirms figures with the
+// given error number (after running the shell commands exit)
+static string writer(int error, const string& exit="")
+{
+  return "while IFS= read -r line; do\n"
+         "  case \"$line\" in\n"
+         "    'set output \"'*) f=${line#set output \\\"}; echo data > \"${f%\\\"}\" ;;\n"
+         "    'print sprintf(\"rendered'*) " + exit + 
+         " echo \"rendered " + boost::lexical_cast<string>(error) + "\" >&2 ;;\n"
+         "  esac\n"
+         "done";
+}
+
+// render a figure with the given comment to filename, and return the
+// number of outputs skipped
+static size_t render(const string& filename, const string& text)
+{
+  Figure figure;
+  figure.comment(text);
+  Renderer renderer(1);
+  renderer.render(figure, filename);
+  // the destructor waits for the output
+  return renderer.getSkipped();
+}
+
+BOOST_FIXTURE_TEST_SUITE(renderer, Gnuplot)
+
+BOOST_AUTO_TEST_CASE(incremental)
+{
+  install(writer(0));
+  string output = (root / "figure.png").string();
+  string tag = (root / ".figure.png.fingerprint").string();
+  BOOST_CHECK_EQUAL(render(output, "first"), 0u);
+  BOOST_CHECK(boost::filesystem::exists(output));
+  BOOST_CHECK(boost::filesystem::exists(tag));
+  // an output that is current is skipped, until its figure changes
+  BOOST_CHECK_EQUAL(render(output, "first"), 1u);
+  BOOST_CHECK_EQUAL(render(output, "second"), 0u);
+  BOOST_CHECK_EQUAL(render(output, "second"), 1u);
+  // or the output is removed
+  boost::filesystem::remove(output);
+  BOOST_CHECK_EQUAL(render(output, "second"), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(failed)
+{
+  // gnuplot reports an error:  the output is not tagged
+  install(writer(1));
+  string output = (root / "figure.png").string();
+  string tag = (root / ".figure.png.fingerprint").string();
+  BOOST_CHECK_EQUAL(render(output, "first"), 0u);
+  BOOST_CHECK(boost::filesystem::exists(output));
+  BOOST_CHECK(!boost::filesystem::exists(tag));
+  BOOST_CHECK_EQUAL(render(output, "first"), 0u);
+  // gnuplot exits before confirming:  the output is not tagged
+  install(writer(0, "exit 1;"));
+  BOOST_CHECK_EQUAL(render(output, "first"), 0u);
+  BOOST_CHECK(!boost::filesystem::exists(tag));
+  install(writer(0));
+  BOOST_CHECK_EQUAL(render(output, "first"), 0u);
+  BOOST_CHECK_EQUAL(render(output, "first"), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(restart)
+{
+  // a session that exits after its first command
+  install("echo start >> "+log+"\nread line\necho exit >> "+log);
+  Renderer renderer(1);
+  renderer.submit("plot x\n");
+  BOOST_REQUIRE(wait(2));
+  // the next figure fails on the exited session (without a SIGPIPE
+  // ending the test), and is sent to a new one
+  renderer.submit("plot x\n");
+  BOOST_REQUIRE(wait(4));
+  for(int idx=0; idx<1000 && renderer.getRendered()<2; idx++)
+  {
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  BOOST_CHECK_EQUAL(renderer.getRendered(), 2u);
+  vector<string> lines = sessions();
+  BOOST_CHECK_EQUAL(count(lines.begin(), lines.end(), "start"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(history)
+{
+  // a window longer than the histories:  the estimate and the candle
+  // plots cover the records held
+  install(writer(0));
+  SyntheticDatabase database("testRenderer.db", 3, 300);
+  const vector<string>& symbols = database.market.getSymbols();
+  Portfolio portfolio(database.root.string());
+  for(size_t idx=0; idx<symbols.size(); idx++) portfolio.addSeries(symbols[idx]);
+  portfolio.setWindow(500);
+  portfolio.optimize(15);
+  vector<string> formats(1, "png");
+  portfolio.setFormats(formats);
+  BOOST_REQUIRE_NO_THROW(portfolio.createReport(root.string()));
+  boost::filesystem::path report = root / 
+    (symbols[0]+"_"+symbols[1]+"_"+symbols[2]);
+  for(size_t idx=0; idx<symbols.size(); idx++)
+  {
+    BOOST_CHECK(boost::filesystem::exists(report / (symbols[idx]+".png")));
+  }
+  BOOST_CHECK(boost::filesystem::exists(report / "Portfolio.png"));
+}
+
+BOOST_AUTO_TEST_CASE(listing)
+{
+  // a stock listed 100 days ago, within the default window:  the
+  // estimate shrinks to its history, and every figure is plotted
+  install(writer(0));
+  SyntheticDatabase database("testRenderer.db", 3, 400);
+  const vector<string>& symbols = database.market.getSymbols();
+  string filename = (database.root / symbols[2] / (symbols[2]+".csv")).string();
+  vector<string> lines;
+  std::ifstream ifs(filename.c_str());
+  string line;
+  while(lines.size()<101 && getline(ifs, line)) lines.push_back(line);
+  ifs.close();
+  std::ofstream ofs(filename.c_str(), ios::trunc);
+  for(size_t lIdx=0; lIdx<lines.size(); lIdx++) ofs << lines[lIdx] << "\n";
+  ofs.close();
+  BOOST_REQUIRE_LT(100, Portfolio::getDefaultWindowLength());
+  Portfolio portfolio(database.root.string());
+  for(size_t idx=0; idx<symbols.size(); idx++) portfolio.addSeries(symbols[idx]);
+  portfolio.optimize(15);
+  vector<string> formats(1, "png");
+  portfolio.setFormats(formats);
+  BOOST_REQUIRE_NO_THROW(portfolio.createReport(root.string()));
+  boost::filesystem::path report = root / 
+    (symbols[0]+"_"+symbols[1]+"_"+symbols[2]);
+  for(size_t idx=0; idx<symbols.size(); idx++)
+  {
+    BOOST_CHECK(boost::filesystem::exists(report / (symbols[idx]+".png")));
+  }
+  BOOST_CHECK(boost::filesystem::exists(report / "Portfolio.png"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
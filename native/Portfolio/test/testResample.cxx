@@ -0,0 +1,113 @@
+// testResample.cxx
+// Mac Radigan
+//
+// Description:  Checks the resampled efficient portfolios:  averaged
+//               weights are fully invested (and within the bounds of
+//               bounded problems), and do not depend on the number of
+//               threads.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testResample
+#include <boost/test/unit_test.hpp>
+#include "Resampler.hxx"
+#include <vector>
+#include <random>
+#include <limits>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+
+// (ns x np) correlated daily returns
+static mat returns(int ns, int np)
+{
+  mt19937 engine(7);
+  normal_distribution<double> normal(0, 1);
+  mat x(ns, np);
+  for(int t=0; t<ns; t++)
+  {
+    double market = 0.01*normal(engine);
+    for(int c=0; c<np; c++) x(t,c) = 0.0003*(c+1) + (0.5+0.1*c)*market + 0.01*normal(engine);
+  }
+  return x;
+}
+
+static vector<double> targets()
+{
+  vector<double> t;
+  t.push_back(0.0004);
+  t.push_back(0.0008);
+  t.push_back(0.0012);
+  return t;
+}
+
+BOOST_AUTO_TEST_CASE(unbounded)
+{
+  mat x = returns(250, 8);
+  Resampler resampler(x);
+  resampler.setResamples(200);
+  resampler.setThreads(1);
+  vector<size_t> count;
+  mat w = resampler.run(targets(), count);
+  BOOST_REQUIRE_EQUAL(w.n_rows, 3u);
+  BOOST_REQUIRE_EQUAL(w.n_cols, 8u);
+  for(int t=0; t<3; t++)
+  {
+    BOOST_CHECK_EQUAL(count[t], 200u);
+    BOOST_CHECK_CLOSE(accu(w.row(t)), 1.0, 1e-9);
+  }
+  // the same resamples on any number of threads
+  resampler.setThreads(3);
+  vector<size_t> count3;
+  mat w3 = resampler.run(targets(), count3);
+  BOOST_CHECK_EQUAL(accu(abs(w-w3)), 0.0);
+  // another seed, or blocks of days, are other resamples
+  resampler.setSeed(2);
+  BOOST_CHECK(accu(abs(w-resampler.run(targets(), count3)))>0);
+  resampler.setSeed(1);
+  resampler.setBlockLength(10);
+  mat wb = resampler.run(targets(), count3);
+  BOOST_CHECK(accu(abs(w-wb))>0);
+  BOOST_CHECK_CLOSE(accu(wb.row(1)), 1.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(bounded)
+{
+  mat x = returns(250, 6);
+  Resampler resampler(x);
+  resampler.setResamples(100);
+  vec lower(6);
+  vec upper(6);
+  lower.fill(0);
+  upper.fill(0.4);
+  resampler.setBounds(lower, upper);
+  vector<size_t> count;
+  mat w = resampler.run(targets(), count);
+  for(int t=0; t<3; t++)
+  {
+    if(0==count[t]) continue;
+    BOOST_CHECK_CLOSE(accu(w.row(t)), 1.0, 1e-6);
+    for(int c=0; c<6; c++)
+    {
+      BOOST_CHECK(w(t,c)>=-1e-9);
+      BOOST_CHECK(w(t,c)<=0.4+1e-9);
+    }
+  }
+  BOOST_CHECK(count[0]>0);
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+  mat x = returns(50, 3);
+  x(10,1) = numeric_limits<double>::quiet_NaN();
+  Resampler resampler(x);
+  vector<size_t> count;
+  BOOST_CHECK_THROW(resampler.run(targets(), count), runtime_error);
+  mat y = returns(50, 3);
+  Resampler none(y);
+  none.setResamples(0);
+  BOOST_CHECK_THROW(none.run(targets(), count), runtime_error);
+}
+
+// *EOF*
@@ -0,0 +1,144 @@
+// testRisk.cxx
+// Mac Radigan
+//
+// Description:  Checks the Monte Carlo VaR and CVaR against their
+//               closed forms for normal one-day returns (sample and
+//               factor covariance), and that the results do not
+//               depend on the number of threads.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testRisk
+#include <boost/test/unit_test.hpp>
+#include "MonteCarlo.hxx"
+#include <vector>
+#include <cmath>
+
+USING_QUANT
+using namespace std;
+
+// a definite (N x N) covariance of daily returns
+static mat covariance(int np)
+{
+  mat s(np, np);
+  for(int i=0; i<np; i++)
+  {
+    for(int j=0; j<np; j++)
+    {
+      double si = 0.01+0.002*i;
+      double sj = 0.01+0.002*j;
+      s(i,j) = (i==j ? 1.0 : 0.3)*si*sj;
+    }
+  }
+  return s;
+}
+
+// closed form (percent) of a normal loss with mean m and deviation s
+static double normalVar(double m, double s, double z) { return 100*(m+s*z); }
+static double normalCvar(double m, double s, double z, double level)
+{
+  return 100*(m+s*exp(-0.5*z*z)/sqrt(2*M_PI)/(1-level));
+}
+
+BOOST_AUTO_TEST_CASE(sample)
+{
+  const int np = 5;
+  mat s = covariance(np);
+  Cholesky cholesky(s);
+  mat mu(1, np);
+  mat w(1, np);
+  for(int i=0; i<np; i++) { mu(0,i) = 0.0004*(i+1); w(0,i) = 0.1+0.05*i; }
+  MonteCarlo mc(mu, w, cholesky);
+  mc.setPaths(200000);
+  vector<int> horizons(1, 1);
+  vector<double> levels;
+  levels.push_back(0.95);
+  levels.push_back(0.99);
+  Risk risk = mc.run(horizons, levels);
+  double m = -as_scalar(w*mu.t());
+  double sd = sqrt(as_scalar(w*s*w.t()));
+  BOOST_CHECK_CLOSE(risk.var(0,0), normalVar(m, sd, 1.6448536), 2.0);
+  BOOST_CHECK_CLOSE(risk.var(0,1), normalVar(m, sd, 2.3263479), 2.0);
+  BOOST_CHECK_CLOSE(risk.cvar(0,0), normalCvar(m, sd, 1.6448536, 0.95), 2.0);
+  BOOST_CHECK_CLOSE(risk.cvar(0,1), normalCvar(m, sd, 2.3263479, 0.99), 3.0);
+  BOOST_CHECK_SMALL(risk.mean[0]-100*m, 0.01);
+  BOOST_CHECK(risk.cvar(0,1)>risk.var(0,1));
+}
+
+BOOST_AUTO_TEST_CASE(factor)
+{
+  // returns with a common factor, and the model fit to them
+  const int np = 6;
+  const int ns = 500;
+  mat x(ns, np);
+  for(int t=0; t<ns; t++)
+  {
+    double f = 0.01*sin(0.37*t*t);
+    for(int i=0; i<np; i++) x(t,i) = (0.5+0.2*i)*f + 0.005*cos(1.3*t*(i+1)+i);
+  }
+  FactorModel model;
+  model.estimate(x, 2);
+  mat s = model.getCovariance();
+  mat mu(1, np, fill::zeros);
+  mat w(1, np);
+  w.fill(1.0/np);
+  MonteCarlo mc(mu, w, model);
+  mc.setPaths(200000);
+  Risk risk = mc.run(vector<int>(1, 1), vector<double>(1, 0.99));
+  double sd = sqrt(as_scalar(w*s*w.t()));
+  BOOST_CHECK_CLOSE(risk.var(0,0), normalVar(0, sd, 2.3263479), 2.0);
+  BOOST_CHECK_CLOSE(risk.cvar(0,0), normalCvar(0, sd, 2.3263479, 0.99), 3.0);
+}
+
+BOOST_AUTO_TEST_CASE(reproducible)
+{
+  const int np = 4;
+  Cholesky cholesky(covariance(np));
+  mat mu(1, np, fill::zeros);
+  mat w(1, np);
+  w.fill(0.25);
+  vector<int> horizons;
+  horizons.push_back(10);
+  horizons.push_back(1);
+  horizons.push_back(10);
+  vector<double> levels(1, 0.975);
+  MonteCarlo mc(mu, w, cholesky);
+  mc.setPaths(20000+17);
+  mc.setThreads(1);
+  Risk one = mc.run(horizons, levels);
+  mc.setThreads(4);
+  Risk four = mc.run(horizons, levels);
+  // horizons are sorted and distinct
+  BOOST_REQUIRE_EQUAL(one.horizon.size(), 2u);
+  BOOST_CHECK_EQUAL(one.horizon[0], 1);
+  BOOST_CHECK_EQUAL(one.horizon[1], 10);
+  for(int hIdx=0; hIdx<2; hIdx++)
+  {
+    BOOST_CHECK_EQUAL(one.var(hIdx,0), four.var(hIdx,0));
+    BOOST_CHECK_EQUAL(one.cvar(hIdx,0), four.cvar(hIdx,0));
+    BOOST_CHECK_EQUAL(one.mean[hIdx], four.mean[hIdx]);
+  }
+  // risk grows with the horizon (about as its square root)
+  BOOST_CHECK_CLOSE(one.var(1,0)/one.var(0,0), sqrt(10.0), 10.0);
+  mc.setSeed(2);
+  Risk other = mc.run(horizons, levels);
+  BOOST_CHECK(other.var(0,0)!=one.var(0,0));
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+  const int np = 3;
+  Cholesky cholesky(covariance(np));
+  mat mu(1, np, fill::zeros);
+  mat w(1, np);
+  w.fill(1.0/3);
+  MonteCarlo mc(mu, w, cholesky);
+  mc.setPaths(100);
+  BOOST_CHECK_THROW(mc.run(vector<int>(1, 1), vector<double>(1, 1.0)), runtime_error);
+  BOOST_CHECK_THROW(mc.run(vector<int>(1, 0), vector<double>(1, 0.95)), runtime_error);
+  mat unoptimized;
+  MonteCarlo none(mu, unoptimized, cholesky);
+  BOOST_CHECK_THROW(none.run(vector<int>(1, 1), vector<double>(1, 0.95)), runtime_error);
+}
+
+// *EOF*
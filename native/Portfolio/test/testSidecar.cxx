@@ -0,0 +1,159 @@
+// testSidecar.cxx
+// Mac Radigan
+//
+// Description:  Checks the binary sidecar of a quote file:  a series
+//               loaded from the sidecar matches the parse of its CSV
+//               file, and a sidecar is rebuilt when the mtime or the
+//               size of its CSV file changes.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testSidecar
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include "Series.hxx"
+#include "Instrumentation.hxx"
+#include "SyntheticDatabase.hxx"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+USING_QUANT
+using namespace std;
+
+struct Database : SyntheticDatabase
+{
+  string symbol;
+  string filename;
+  string sidecar;
+  Database() : SyntheticDatabase("testSidecar", 1, 300)
+  {
+    Series::setSidecarEnabled(true);
+    symbol = market.getSymbols()[0];
+    filename = (root / symbol / (symbol+".csv")).string();
+    sidecar = (root / symbol / (symbol+".qbin")).string();
+  }
+  ~Database()
+  {
+    Series::setSidecarEnabled(true);
+  }
+  // replace the volume of the newest record (the second line)
+  void setVolume(const string& volume) const
+  {
+    std::ifstream ifs(filename.c_str());
+    stringstream text;
+    text << ifs.rdbuf();
+    ifs.close();
+    string s = text.str();
+    size_t begin = s.find('\n')+1;
+    for(int idx=0; idx<5; idx++) begin = s.find(',', begin)+1;
+    size_t end = s.find(',', begin);
+    s.replace(begin, end-begin, volume);
+    std::ofstream ofs(filename.c_str(), ios::trunc);
+    ofs << s;
+  }
+  // the volume of the newest record, with the digits of the original
+  // replaced (the same size) or one digit more
+  string getVolume(bool grow) const
+  {
+    Series series;
+    series.load(symbol, filename);
+    string volume = boost::lexical_cast<string>(series.getVolume()[0]);
+    return string(volume.size(), '1') + (grow ? "1" : "");
+  }
+  void setMtime(const struct timespec& mtime) const
+  {
+    struct timespec times[2] = { mtime, mtime };
+    BOOST_REQUIRE_EQUAL(utimensat(AT_FDCWD, filename.c_str(), times, 0), 0);
+  }
+  struct stat getStat() const
+  {
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(stat(filename.c_str(), &st), 0);
+    return st;
+  }
+};
+
+// sidecar loads since the last reset
+static uint64_t sidecarLoads()
+{
+  return Instrumentation::get("series.load.sidecar", Metric::COUNTER)->getTotal();
+}
+
+BOOST_FIXTURE_TEST_SUITE(sidecar, Database)
+
+BOOST_AUTO_TEST_CASE(equal)
+{
+  // the CSV parse
+  Series::setSidecarEnabled(false);
+  Series csv;
+  csv.load(symbol, filename);
+  BOOST_CHECK(!boost::filesystem::exists(sidecar));
+  // the first load builds the sidecar, the next reads it
+  Series::setSidecarEnabled(true);
+  Series first;
+  first.load(symbol, filename);
+  BOOST_CHECK(boost::filesystem::exists(sidecar));
+  Instrumentation::reset();
+  Series series;
+  series.load(symbol, filename);
+#ifdef QUANT_INSTRUMENT
+  BOOST_CHECK_EQUAL(sidecarLoads(), 1u);
+#endif
+  BOOST_REQUIRE_EQUAL(series.getDate().size(), csv.getDate().size());
+  BOOST_CHECK(series.getDate()==csv.getDate());
+  BOOST_CHECK(series.getOpen()==csv.getOpen());
+  BOOST_CHECK(series.getHigh()==csv.getHigh());
+  BOOST_CHECK(series.getLow()==csv.getLow());
+  BOOST_CHECK(series.getClose()==csv.getClose());
+  BOOST_CHECK(series.getVolume()==csv.getVolume());
+  BOOST_CHECK(series.getAdjClose()==csv.getAdjClose());
+  BOOST_CHECK(series.getRreturn()==csv.getRreturn());
+}
+
+BOOST_AUTO_TEST_CASE(mtime)
+{
+  string volume = getVolume(false);
+  BOOST_REQUIRE(boost::filesystem::exists(sidecar));
+  // the same size, a later mtime
+  struct stat st = getStat();
+  setVolume(volume);
+  struct timespec mtime = st.st_mtim;
+  mtime.tv_sec += 10;
+  setMtime(mtime);
+  BOOST_REQUIRE_EQUAL(getStat().st_size, st.st_size);
+  Instrumentation::reset();
+  Series series;
+  series.load(symbol, filename);
+  BOOST_CHECK_EQUAL(series.getVolume()[0], boost::lexical_cast<int>(volume));
+  // the sidecar is rebuilt, and read by the next load
+  Series next;
+  next.load(symbol, filename);
+  BOOST_CHECK_EQUAL(next.getVolume()[0], boost::lexical_cast<int>(volume));
+#ifdef QUANT_INSTRUMENT
+  BOOST_CHECK_EQUAL(sidecarLoads(), 1u);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(size)
+{
+  string volume = getVolume(true);
+  BOOST_REQUIRE(boost::filesystem::exists(sidecar));
+  // the same mtime, a larger size
+  struct stat st = getStat();
+  setVolume(volume);
+  setMtime(st.st_mtim);
+  BOOST_REQUIRE_EQUAL(getStat().st_mtim.tv_sec, st.st_mtim.tv_sec);
+  BOOST_REQUIRE_EQUAL(getStat().st_mtim.tv_nsec, st.st_mtim.tv_nsec);
+  BOOST_REQUIRE_EQUAL(getStat().st_size, st.st_size+1);
+  Series series;
+  series.load(symbol, filename);
+  BOOST_CHECK_EQUAL(series.getVolume()[0], boost::lexical_cast<int>(volume));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// *EOF*
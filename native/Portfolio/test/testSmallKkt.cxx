@@ -0,0 +1,85 @@
+// testSmallKkt.cxx
+// Mac Radigan
+//
+// Description:  Checks the fixed-size frontier basis of small 
+//               portfolios against the dynamic (Cholesky) solve, and
+//               its fallback for singular and larger problems.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testSmallKkt
+#include <boost/test/unit_test.hpp>
+#include "SmallKkt.hxx"
+#include "Cholesky.hxx"
+#include "Portfolio.hxx"
+#include <random>
+
+USING_QUANT
+using namespace std;
+
+// (n x n) covariance of correlated daily returns, and their means
+static void moments(int n, mat& s, mat& mu)
+{
+  mt19937 engine(n);
+  normal_distribution<double> normal(0, 1);
+  mat x(250, n);
+  for(int t=0; t<250; t++)
+  {
+    double market = 0.01*normal(engine);
+    for(int c=0; c<n; c++) x(t,c) = 0.0002*(c+1) + (0.5+0.1*c)*market + 0.01*normal(engine);
+  }
+  mu = mean(x);
+  s = cov(x);
+}
+
+BOOST_AUTO_TEST_CASE(dynamic)
+{
+  for(int n=2; n<=SmallKkt::MAX_STOCKS; n++)
+  {
+    mat s;
+    mat mu;
+    moments(n, s, mu);
+    mat w1, w0;
+    BOOST_REQUIRE(SmallKkt::basis(s, mu, w1, w0));
+    // the dynamic solve
+    mat m(n, 2);
+    for(int c=0; c<n; c++) { m(c,0) = mu(0,c); m(c,1) = 1; }
+    mat y = Cholesky(s).solve(m);
+    mat v1, v0;
+    Portfolio::schurBasis(m, y, v1, v0);
+    double a = 0;
+    for(int c=0; c<n; c++) a += y(c,1);
+    double minimum = 0;
+    BOOST_REQUIRE(SmallKkt::basis(n, s.memptr(), mu.memptr(), w1.memptr(), w0.memptr(), &minimum));
+    BOOST_CHECK_CLOSE(minimum, 1/a, 1e-8);
+    for(int c=0; c<n; c++)
+    {
+      BOOST_CHECK_CLOSE(w1(0,c), v1(0,c), 1e-8);
+      BOOST_CHECK_CLOSE(w0(0,c), v0(0,c), 1e-8);
+    }
+    // fully invested, and on target
+    BOOST_CHECK_SMALL(accu(w0)-1, 1e-12);
+    BOOST_CHECK_SMALL(accu(w1), 1e-9);
+    BOOST_CHECK_CLOSE(accu(mu%w1), 1.0, 1e-8);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(fallback)
+{
+  mat s;
+  mat mu;
+  mat w1, w0;
+  // too large for a specialization
+  moments(SmallKkt::MAX_STOCKS+1, s, mu);
+  BOOST_CHECK(!SmallKkt::basis(s, mu, w1, w0));
+  // a duplicated stock:  singular, left to the regularized solve
+  moments(4, s, mu);
+  s.col(3) = s.col(2);
+  s.row(3) = s.row(2);
+  mu(0,3) = mu(0,2);
+  BOOST_CHECK(!SmallKkt::basis(s, mu, w1, w0));
+  Portfolio::solveBasis(s, mu, w1, w0);
+  BOOST_CHECK_SMALL(accu(w0)-1, 1e-6);
+}
+
+// *EOF*
@@ -0,0 +1,97 @@
+// testUniverse.cxx
+// Mac Radigan
+//
+// Description:  Checks the universe subset search:  a subset evaluated
+//               from sub-blocks of the universe estimate matches a
+//               portfolio of its stocks, every subset is enumerated,
+//               and rankings do not depend on the number of threads.
+//
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testUniverse
+#include <boost/test/unit_test.hpp>
+#include "Universe.hxx"
+#include "Portfolio.hxx"
+#include "SyntheticDatabase.hxx"
+#include <vector>
+#include <string>
+
+USING_QUANT
+using namespace std;
+
+struct Database : SyntheticDatabase
+{
+  Database(int nsymbols) : SyntheticDatabase("testUniverse", nsymbols, 400) {}
+};
+
+BOOST_AUTO_TEST_CASE(subsets)
+{
+  BOOST_CHECK_EQUAL(Universe::choose(10, 0), 1u);
+  BOOST_CHECK_EQUAL(Universe::choose(10, 3), 120u);
+  BOOST_CHECK_EQUAL(Universe::choose(50, 4), 230300u);
+  BOOST_CHECK_EQUAL(Universe::choose(3, 4), 0u);
+  BOOST_CHECK_EQUAL(Universe::choose(5000, 10), 0u);   // exceeds 2^63
+}
+
+BOOST_AUTO_TEST_CASE(subset)
+{
+  Database database(8);
+  const vector<string>& symbols = database.market.getSymbols();
+  Universe universe(database.root.string());
+  for(size_t idx=0; idx<symbols.size(); idx++) universe.addSeries(symbols[idx]);
+  universe.estimate();
+  BOOST_REQUIRE_EQUAL(universe.size(), 8);
+  vector<int> members;
+  members.push_back(1);
+  members.push_back(4);
+  members.push_back(6);
+  Candidate candidate = universe.evaluate(members, 15);
+  // the same stocks, estimated and optimized on their own
+  Portfolio portfolio(database.root.string());
+  for(size_t idx=0; idx<members.size(); idx++) portfolio.addSeries(symbols[members[idx]]);
+  portfolio.optimize(15);
+  BOOST_CHECK_CLOSE(candidate.volatility, portfolio.getPortfolioVolatility(), 1e-6);
+  const mat& weights = portfolio.getWeights();
+  for(size_t idx=0; idx<members.size(); idx++)
+  {
+    BOOST_CHECK_CLOSE(candidate.weights(0,idx), weights(0,idx), 1e-6);
+    BOOST_CHECK_EQUAL(candidate.symbols[idx], symbols[members[idx]]);
+  }
+  BOOST_CHECK(candidate.minimum<=candidate.volatility);
+}
+
+BOOST_AUTO_TEST_CASE(ranking)
+{
+  Database database(12);
+  const vector<string>& symbols = database.market.getSymbols();
+  Universe universe(database.root.string());
+  for(size_t idx=0; idx<symbols.size(); idx++) universe.addSeries(symbols[idx]);
+  universe.estimate();
+  // every subset ranked, best first
+  vector<Candidate> all = universe.search(3, 15, 1000, 0, 1, 1);
+  BOOST_REQUIRE_EQUAL(all.size(), Universe::choose(12, 3));
+  for(size_t idx=1; idx<all.size(); idx++)
+  {
+    BOOST_CHECK(all[idx-1].volatility<=all[idx].volatility);
+  }
+  // the same ranking on any number of threads
+  vector<Candidate> best = universe.search(3, 15, 10, 0, 1, 3);
+  BOOST_REQUIRE_EQUAL(best.size(), 10u);
+  for(size_t idx=0; idx<best.size(); idx++)
+  {
+    BOOST_CHECK(best[idx].members==all[idx].members);
+    BOOST_CHECK_EQUAL(best[idx].volatility, all[idx].volatility);
+  }
+  // samples are distinct, and depend only on the seed
+  vector<Candidate> sampled = universe.search(3, 15, 5, 50, 7, 1);
+  vector<Candidate> sampled3 = universe.search(3, 15, 5, 50, 7, 3);
+  BOOST_REQUIRE_EQUAL(sampled.size(), sampled3.size());
+  for(size_t idx=0; idx<sampled.size(); idx++)
+  {
+    BOOST_CHECK(sampled[idx].members==sampled3[idx].members);
+    if(idx>0) BOOST_CHECK(sampled[idx].members!=sampled[idx-1].members);
+    BOOST_CHECK(sampled[idx].volatility>=all[0].volatility);
+  }
+}
+
+// *EOF*
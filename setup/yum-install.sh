@@ -25,5 +25,6 @@ yum -y install gnuplot gnuplot-common gnuplot-doc* gnuplot-latex*
 yum -y install curl
 yum -y install armadillo
 yum -y install liblog4cxx liblog4cxx-devel
+yum -y install hdf5 hdf5-devel
 
 ## *EOF*